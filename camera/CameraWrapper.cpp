@@ -26,8 +26,11 @@
 #define LOG_TAG "CameraWrapper"
 #include <cutils/log.h>
 
+#include <inttypes.h>
+
 #include <utils/threads.h>
 #include <utils/String8.h>
+#include <utils/Timers.h>
 #include <hardware/hardware.h>
 #include <hardware/camera.h>
 #include <camera/Camera.h>
@@ -71,19 +74,127 @@ camera_module_t HAL_MODULE_INFO_SYM = {
     .reserved = {0}, /* remove compilation warnings */
 };
 
+/* every vendor op we forward, plus our own parameter fixups */
+#define CAMERA_VENDOR_OPS(OP) \
+    OP(set_preview_window) \
+    OP(set_callbacks) \
+    OP(enable_msg_type) \
+    OP(disable_msg_type) \
+    OP(msg_type_enabled) \
+    OP(start_preview) \
+    OP(stop_preview) \
+    OP(preview_enabled) \
+    OP(store_meta_data_in_buffers) \
+    OP(start_recording) \
+    OP(stop_recording) \
+    OP(recording_enabled) \
+    OP(release_recording_frame) \
+    OP(auto_focus) \
+    OP(cancel_auto_focus) \
+    OP(take_picture) \
+    OP(cancel_picture) \
+    OP(set_parameters) \
+    OP(get_parameters) \
+    OP(put_parameters) \
+    OP(send_command) \
+    OP(release) \
+    OP(dump)
+
+#define CAMERA_OP_ENUM(op) CAMERA_OP_##op,
+#define CAMERA_OP_NAME(op) #op,
+
+enum {
+    CAMERA_VENDOR_OPS(CAMERA_OP_ENUM)
+    CAMERA_OP_GET_PARAMS_FIXUP,
+    CAMERA_OP_SET_PARAMS_FIXUP,
+    CAMERA_OP_COUNT
+};
+
+static const char *camera_op_names[CAMERA_OP_COUNT] = {
+    CAMERA_VENDOR_OPS(CAMERA_OP_NAME)
+    "get_parameters fixup",
+    "set_parameters fixup",
+};
+
+/* bucket 0 counts calls under 1us, bucket n those in [2^(n-1), 2^n) us,
+   and the last one everything from 16ms up */
+#define CAMERA_OP_BUCKETS 16
+
+struct camera_op_stats {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint32_t histogram[CAMERA_OP_BUCKETS];
+};
+
 typedef struct wrapper_camera_device {
     camera_device_t base;
     int id;
     camera_device_t *vendor;
+    /* last vendor get_parameters string and its fixed up form */
+    char *vendor_get_params;
+    size_t vendor_get_params_len;
+    char *fixed_get_params;
+    uint32_t get_params_hits;
+    uint32_t get_params_misses;
+    /* whether the vendor holds fixed_set_params[id] as its current set */
+    bool set_params_synced;
+    uint32_t set_params_forwarded;
+    uint32_t set_params_skipped;
+    /* keys added, removed or changed over all forwarded sets */
+    uint32_t set_params_keys_changed;
+    /* call latencies, reported by camera_dump */
+    struct camera_op_stats op_stats[CAMERA_OP_COUNT];
 } wrapper_camera_device_t;
 
+/* ops may come in from several threads at once, hence the atomics */
+static void camera_op_record(struct camera_op_stats *stats, nsecs_t elapsed)
+{
+    uint64_t ns = elapsed > 0 ? elapsed : 0;
+    uint64_t us = ns / 1000;
+    int bucket = us ? 64 - __builtin_clzll(us) : 0;
+    if (bucket >= CAMERA_OP_BUCKETS)
+        bucket = CAMERA_OP_BUCKETS - 1;
+
+    __atomic_fetch_add(&stats->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->total_ns, ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->histogram[bucket], 1, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&stats->max_ns, __ATOMIC_RELAXED);
+    while (ns > max && !__atomic_compare_exchange_n(&stats->max_ns, &max, ns,
+            true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+/* times the enclosing scope */
+class CameraOpTimer {
+public:
+    CameraOpTimer(struct camera_op_stats *stats) :
+            mStats(stats), mStart(systemTime(SYSTEM_TIME_MONOTONIC)) {}
+    ~CameraOpTimer() {
+        camera_op_record(mStats, systemTime(SYSTEM_TIME_MONOTONIC) - mStart);
+    }
+private:
+    struct camera_op_stats *mStats;
+    nsecs_t mStart;
+};
+
 #define VENDOR_CALL(device, func, ...) ({ \
     wrapper_camera_device_t *__wrapper_dev = (wrapper_camera_device_t*) device; \
+    CameraOpTimer __timer(&__wrapper_dev->op_stats[CAMERA_OP_##func]); \
     __wrapper_dev->vendor->ops->func(__wrapper_dev->vendor, ##__VA_ARGS__); \
 })
 
 #define CAMERA_ID(device) (((wrapper_camera_device_t *)(device))->id)
 
+/* the vendor may adjust its own parameters while handling these calls,
+   so the next set_parameters has to reach it even if nothing changed.
+   That includes auto focus, which moves the focus position and areas it
+   reports, and preview window and message changes, which QCamera2 can
+   answer by reconfiguring the stream. */
+#define CAMERA_PARAMS_DIRTY(device) \
+    (((wrapper_camera_device_t *)(device))->set_params_synced = false)
+
 static int check_vendor_module()
 {
     int rv = 0;
@@ -145,7 +256,43 @@ static char *camera_fixup_getparams(int id __unused, const char *settings)
     return ret;
 }
 
-static char *camera_fixup_setparams(int id, const char *settings)
+/*
+ * The fixups above only depend on the vendor string, which stays the same
+ * until something is set, while apps poll getParameters constantly. Keep
+ * the last result and hand out copies of it as long as the vendor string
+ * is unchanged. Comparing the strings costs a single memcmp, well below
+ * a parse, and unlike a hash it can't be fooled.
+ */
+static char *camera_cached_getparams(wrapper_camera_device_t *dev,
+        const char *settings)
+{
+    size_t len = strlen(settings);
+
+    if (dev->fixed_get_params && len == dev->vendor_get_params_len &&
+            !memcmp(settings, dev->vendor_get_params, len)) {
+        dev->get_params_hits++;
+        return strdup(dev->fixed_get_params);
+    }
+
+    char *ret = camera_fixup_getparams(dev->id, settings);
+    dev->get_params_misses++;
+
+    free(dev->vendor_get_params);
+    free(dev->fixed_get_params);
+    dev->vendor_get_params = strdup(settings);
+    dev->fixed_get_params = ret ? strdup(ret) : NULL;
+    if (!dev->vendor_get_params || !dev->fixed_get_params) {
+        free(dev->vendor_get_params);
+        free(dev->fixed_get_params);
+        dev->vendor_get_params = NULL;
+        dev->fixed_get_params = NULL;
+    }
+    dev->vendor_get_params_len = len;
+
+    return ret;
+}
+
+static char *camera_fixup_setparams(int id __unused, const char *settings)
 {
     CameraParameters params;
     params.unflatten(String8(settings));
@@ -168,14 +315,58 @@ static char *camera_fixup_setparams(int id, const char *settings)
 #endif
 
     String8 strParams = params.flatten();
-    if (fixed_set_params[id])
-        free(fixed_set_params[id]);
-    fixed_set_params[id] = strdup(strParams.string());
-    char *ret = fixed_set_params[id];
+    char *ret = strdup(strParams.string());
 
     return ret;
 }
 
+/*
+ * Walk two flattened parameter sets side by side and count the keys that
+ * were added, removed or given a new value. flatten() emits keys in
+ * sorted order, so a single merge pass does it without parsing either
+ * string.
+ */
+static int camera_diff_params(const char *from, const char *to)
+{
+    int changed = 0;
+
+    while (*from || *to) {
+        const char *fromEnd = from + strcspn(from, ";");
+        const char *toEnd = to + strcspn(to, ";");
+        size_t fromKey = strcspn(from, "=");
+        size_t toKey = strcspn(to, "=");
+        int cmp;
+
+        if (!*from) {
+            cmp = 1;
+        } else if (!*to) {
+            cmp = -1;
+        } else {
+            cmp = strncmp(from, to, fromKey < toKey ? fromKey : toKey);
+            if (!cmp)
+                cmp = (int)fromKey - (int)toKey;
+        }
+
+        if (cmp < 0) {
+            ALOGV("%s: removed %.*s", __FUNCTION__, (int)fromKey, from);
+            changed++;
+        } else if (cmp > 0) {
+            ALOGV("%s: added %.*s", __FUNCTION__, (int)(toEnd - to), to);
+            changed++;
+        } else if (fromEnd - from != toEnd - to || memcmp(from, to, toEnd - to)) {
+            ALOGV("%s: changed %.*s", __FUNCTION__, (int)(toEnd - to), to);
+            changed++;
+        }
+
+        if (cmp <= 0)
+            from = *fromEnd ? fromEnd + 1 : fromEnd;
+        if (cmp >= 0)
+            to = *toEnd ? toEnd + 1 : toEnd;
+    }
+
+    return changed;
+}
+
 /*******************************************************************
  * implementation of camera_device_ops functions
  *******************************************************************/
@@ -189,6 +380,7 @@ static int camera_set_preview_window(struct camera_device *device,
     if (!device)
         return -EINVAL;
 
+    CAMERA_PARAMS_DIRTY(device);
     return VENDOR_CALL(device, set_preview_window, window);
 }
 
@@ -218,6 +410,7 @@ static void camera_enable_msg_type(struct camera_device *device,
     if (!device)
         return;
 
+    CAMERA_PARAMS_DIRTY(device);
     VENDOR_CALL(device, enable_msg_type, msg_type);
 }
 
@@ -253,6 +446,7 @@ static int camera_start_preview(struct camera_device *device)
     if (!device)
         return -EINVAL;
 
+    CAMERA_PARAMS_DIRTY(device);
     return VENDOR_CALL(device, start_preview);
 }
 
@@ -264,6 +458,7 @@ static void camera_stop_preview(struct camera_device *device)
     if (!device)
         return;
 
+    CAMERA_PARAMS_DIRTY(device);
     VENDOR_CALL(device, stop_preview);
 }
 
@@ -287,6 +482,7 @@ static int camera_store_meta_data_in_buffers(struct camera_device *device,
     if (!device)
         return -EINVAL;
 
+    CAMERA_PARAMS_DIRTY(device);
     return VENDOR_CALL(device, store_meta_data_in_buffers, enable);
 }
 
@@ -298,6 +494,7 @@ static int camera_start_recording(struct camera_device *device)
     if (!device)
         return EINVAL;
 
+    CAMERA_PARAMS_DIRTY(device);
     return VENDOR_CALL(device, start_recording);
 }
 
@@ -309,6 +506,7 @@ static void camera_stop_recording(struct camera_device *device)
     if (!device)
         return;
 
+    CAMERA_PARAMS_DIRTY(device);
     VENDOR_CALL(device, stop_recording);
 }
 
@@ -343,7 +541,7 @@ static int camera_auto_focus(struct camera_device *device)
     if (!device)
         return -EINVAL;
 
-
+    CAMERA_PARAMS_DIRTY(device);
     return VENDOR_CALL(device, auto_focus);
 }
 
@@ -355,6 +553,7 @@ static int camera_cancel_auto_focus(struct camera_device *device)
     if (!device)
         return -EINVAL;
 
+    CAMERA_PARAMS_DIRTY(device);
     return VENDOR_CALL(device, cancel_auto_focus);
 }
 
@@ -366,6 +565,7 @@ static int camera_take_picture(struct camera_device *device)
     if (!device)
         return -EINVAL;
 
+    CAMERA_PARAMS_DIRTY(device);
     return VENDOR_CALL(device, take_picture);
 }
 
@@ -377,6 +577,7 @@ static int camera_cancel_picture(struct camera_device *device)
     if (!device)
         return -EINVAL;
 
+    CAMERA_PARAMS_DIRTY(device);
     return VENDOR_CALL(device, cancel_picture);
 }
 
@@ -389,10 +590,38 @@ static int camera_set_parameters(struct camera_device *device,
     if (!device)
         return -EINVAL;
 
-    char *tmp = NULL;
-    tmp = camera_fixup_setparams(CAMERA_ID(device), params);
+    wrapper_camera_device_t *wrapper_dev = (wrapper_camera_device_t*) device;
+    int id = CAMERA_ID(device);
+    char *tmp;
+    {
+        CameraOpTimer timer(&wrapper_dev->op_stats[CAMERA_OP_SET_PARAMS_FIXUP]);
+
+        tmp = camera_fixup_setparams(id, params);
+        if (!tmp)
+            return -ENOMEM;
+
+        /* the vendor HAL reparses and reapplies every key it is given, so
+           don't hand it a set it already holds */
+        if (wrapper_dev->set_params_synced && fixed_set_params[id] &&
+                !strcmp(tmp, fixed_set_params[id])) {
+            ALOGV("%s: parameters unchanged, not forwarded", __FUNCTION__);
+            wrapper_dev->set_params_skipped++;
+            free(tmp);
+            return 0;
+        }
+
+        if (fixed_set_params[id]) {
+            int changed = camera_diff_params(fixed_set_params[id], tmp);
+            ALOGD("%s: forwarding, %d keys changed", __FUNCTION__, changed);
+            wrapper_dev->set_params_keys_changed += changed;
+            free(fixed_set_params[id]);
+        }
+        fixed_set_params[id] = tmp;
+    }
 
     int ret = VENDOR_CALL(device, set_parameters, tmp);
+    wrapper_dev->set_params_synced = (ret == 0);
+    wrapper_dev->set_params_forwarded++;
     return ret;
 }
 
@@ -405,8 +634,15 @@ static char *camera_get_parameters(struct camera_device *device)
         return NULL;
 
     char *params = VENDOR_CALL(device, get_parameters);
+    if (!params)
+        return NULL;
 
-    char *tmp = camera_fixup_getparams(CAMERA_ID(device), params);
+    wrapper_camera_device_t *wrapper_dev = (wrapper_camera_device_t*) device;
+    char *tmp;
+    {
+        CameraOpTimer timer(&wrapper_dev->op_stats[CAMERA_OP_GET_PARAMS_FIXUP]);
+        tmp = camera_cached_getparams(wrapper_dev, params);
+    }
     VENDOR_CALL(device, put_parameters, params);
     params = tmp;
 
@@ -431,6 +667,7 @@ static int camera_send_command(struct camera_device *device,
     if (!device)
         return -EINVAL;
 
+    CAMERA_PARAMS_DIRTY(device);
     return VENDOR_CALL(device, send_command, cmd, arg1, arg2);
 }
 
@@ -442,6 +679,7 @@ static void camera_release(struct camera_device *device)
     if (!device)
         return;
 
+    CAMERA_PARAMS_DIRTY(device);
     VENDOR_CALL(device, release);
 }
 
@@ -453,6 +691,36 @@ static int camera_dump(struct camera_device *device, int fd)
     if (!device)
         return -EINVAL;
 
+    wrapper_camera_device_t *wrapper_dev = (wrapper_camera_device_t*) device;
+    dprintf(fd, "CameraWrapper: camera %d get_parameters fixups cached %u, parsed %u\n",
+            wrapper_dev->id, wrapper_dev->get_params_hits,
+            wrapper_dev->get_params_misses);
+    dprintf(fd, "CameraWrapper: camera %d set_parameters forwarded %u, unchanged %u, "
+            "keys changed %u\n",
+            wrapper_dev->id, wrapper_dev->set_params_forwarded,
+            wrapper_dev->set_params_skipped, wrapper_dev->set_params_keys_changed);
+
+    dprintf(fd, "CameraWrapper: camera %d call latencies (histogram buckets: "
+            "<1us, then doubling from 1us, last >=16ms):\n", wrapper_dev->id);
+    for (int op = 0; op < CAMERA_OP_COUNT; op++) {
+        const struct camera_op_stats *stats = &wrapper_dev->op_stats[op];
+        uint64_t count = __atomic_load_n(&stats->count, __ATOMIC_RELAXED);
+        if (!count)
+            continue;
+
+        int last = CAMERA_OP_BUCKETS - 1;
+        while (last > 0 && !stats->histogram[last])
+            last--;
+
+        dprintf(fd, "  %-28s %8" PRIu64 " calls, avg %.1fus, max %.1fus,",
+                camera_op_names[op], count,
+                __atomic_load_n(&stats->total_ns, __ATOMIC_RELAXED) / 1000.0 / count,
+                __atomic_load_n(&stats->max_ns, __ATOMIC_RELAXED) / 1000.0);
+        for (int b = 0; b <= last; b++)
+            dprintf(fd, " %u", __atomic_load_n(&stats->histogram[b], __ATOMIC_RELAXED));
+        dprintf(fd, "\n");
+    }
+
     return VENDOR_CALL(device, dump, fd);
 }
 
@@ -482,6 +750,8 @@ static int camera_device_close(hw_device_t *device)
     wrapper_dev->vendor->common.close((hw_device_t*)wrapper_dev->vendor);
     if (wrapper_dev->base.ops)
         free(wrapper_dev->base.ops);
+    free(wrapper_dev->vendor_get_params);
+    free(wrapper_dev->fixed_get_params);
     free(wrapper_dev);
 done:
 #ifdef HEAPTRACKER
@@ -30,6 +30,10 @@ LOCAL_SRC_FILES += \
     LocAdapterBase.cpp \
     ContextBase.cpp \
     LocDualContext.cpp \
+    LocApiTrace.cpp \
+    LocApiSynthetic.cpp \
+    LocBackendLibs.cpp \
+    LocFixLatency.cpp \
     loc_core_log.cpp
 
 LOCAL_CFLAGS += \
@@ -46,6 +50,10 @@ LOCAL_COPY_HEADERS:= \
     LocAdapterBase.h \
     ContextBase.h \
     LocDualContext.h \
+    LocApiTrace.h \
+    LocApiSynthetic.h \
+    LocBackendLibs.h \
+    LocFixLatency.h \
     LBSProxyBase.h \
     UlpProxyBase.h \
     gps_extended_c.h \
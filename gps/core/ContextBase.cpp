@@ -32,7 +32,12 @@
 #include <dlfcn.h>
 #include <cutils/sched_policy.h>
 #include <unistd.h>
+#include <string.h>
+#include <time.h>
 #include <ContextBase.h>
+#include <LocApiTrace.h>
+#include <LocApiSynthetic.h>
+#include <LocBackendLibs.h>
 #include <msg_q.h>
 #include <loc_target.h>
 #include <log_util.h>
@@ -40,37 +45,62 @@
 
 namespace loc_core {
 
+static int64_t getMonotonicMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 LBSProxyBase* ContextBase::getLBSProxy(const char* libName)
 {
     LBSProxyBase* proxy = NULL;
+    int64_t start = getMonotonicMs();
     LOC_LOGD("%s:%d]: getLBSProxy libname: %s\n", __func__, __LINE__, libName);
-    void* lib = dlopen(libName, RTLD_NOW);
+    getLBSProxy_t* getter = NULL;
 
-    if ((void*)NULL != lib) {
-        getLBSProxy_t* getter = (getLBSProxy_t*)dlsym(lib, "getLBSProxy");
-        if (NULL != getter) {
-            proxy = (*getter)();
+    if (0 == strcmp(libName, LocBackendLibs::name(LocBackendLibs::LBS_CORE))) {
+        getter = (getLBSProxy_t*)LocBackendLibs::getEntry(LocBackendLibs::LBS_CORE);
+    } else {
+        void* lib = dlopen(libName, RTLD_NOW);
+        if ((void*)NULL != lib) {
+            getter = (getLBSProxy_t*)dlsym(lib, "getLBSProxy");
         }
     }
+    if (NULL != getter) {
+        proxy = (*getter)();
+    }
     if (NULL == proxy) {
         proxy = new LBSProxyBase();
     }
-    LOC_LOGD("%s:%d]: Exiting\n", __func__, __LINE__);
+    LOC_LOGD("%s:%d]: Exiting after %lld ms\n", __func__, __LINE__,
+             (long long)(getMonotonicMs() - start));
     return proxy;
 }
 
 LocApiBase* ContextBase::createLocApi(LOC_API_ADAPTER_EVENT_MASK_T exMask)
 {
     LocApiBase* locApi = NULL;
+    int64_t start = getMonotonicMs();
+
+    // a recorded trace or the synthetic receiver replace the modem altogether
+    if (LocApiTracePlayer::isSelected()) {
+        LOC_LOGD("%s:%d]: replaying a LocApi trace", __func__, __LINE__);
+        return new LocApiTracePlayer(mMsgTask, exMask, this);
+    }
+    if (LocApiSynthetic::isSelected()) {
+        LOC_LOGD("%s:%d]: using the synthetic LocApi", __func__, __LINE__);
+        return new LocApiSynthetic(mMsgTask, exMask, this);
+    }
 
     // first if can not be MPQ
     if (TARGET_MPQ != loc_get_target()) {
         if (NULL == (locApi = mLBSProxy->getLocApi(mMsgTask, exMask, this))) {
-            void *handle = NULL;
             //try to see if LocApiV02 is present
-            if((handle = dlopen("libloc_api_v02.so", RTLD_NOW)) != NULL) {
+            if(LocBackendLibs::get(LocBackendLibs::LOC_API_V02) != NULL) {
                 LOC_LOGD("%s:%d]: libloc_api_v02.so is present", __func__, __LINE__);
-                getLocApi_t* getter = (getLocApi_t*)dlsym(handle, "getLocApi");
+                getLocApi_t* getter =
+                    (getLocApi_t*)LocBackendLibs::getEntry(LocBackendLibs::LOC_API_V02);
                 if(getter != NULL) {
                     LOC_LOGD("%s:%d]: getter is not NULL for LocApiV02", __func__, __LINE__);
                     locApi = (*getter)(mMsgTask, exMask, this);
@@ -80,13 +110,11 @@ LocApiBase* ContextBase::createLocApi(LOC_API_ADAPTER_EVENT_MASK_T exMask)
             else {
                 LOC_LOGD("%s:%d]: libloc_api_v02.so is NOT present. Trying RPC",
                          __func__, __LINE__);
-                handle = dlopen("libloc_api-rpc-qc.so", RTLD_NOW);
-                if (NULL != handle) {
-                    getLocApi_t* getter = (getLocApi_t*)dlsym(handle, "getLocApi");
-                    if (NULL != getter) {
-                        LOC_LOGD("%s:%d]: getter is not NULL in RPC", __func__, __LINE__);
-                        locApi = (*getter)(mMsgTask, exMask, this);
-                    }
+                getLocApi_t* getter =
+                    (getLocApi_t*)LocBackendLibs::getEntry(LocBackendLibs::LOC_API_RPC);
+                if (NULL != getter) {
+                    LOC_LOGD("%s:%d]: getter is not NULL in RPC", __func__, __LINE__);
+                    locApi = (*getter)(mMsgTask, exMask, this);
                 }
             }
         }
@@ -98,6 +126,8 @@ LocApiBase* ContextBase::createLocApi(LOC_API_ADAPTER_EVENT_MASK_T exMask)
         locApi = new LocApiBase(mMsgTask, exMask, this);
     }
 
+    LOC_LOGD("%s:%d]: LocApi created in %lld ms", __func__, __LINE__,
+             (long long)(getMonotonicMs() - start));
     return locApi;
 }
 
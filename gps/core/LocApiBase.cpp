@@ -34,6 +34,8 @@
 #include <LocAdapterBase.h>
 #include <log_util.h>
 #include <LocDualContext.h>
+#include <LocApiTrace.h>
+#include <LocFixLatency.h>
 
 namespace loc_core {
 
@@ -243,7 +245,12 @@ void LocApiBase::reportPosition(UlpLocation &location,
              location.gpsLocation.bearing, location.gpsLocation.accuracy,
              location.gpsLocation.timestamp, location.rawDataSize,
              location.rawData, status, loc_technology_mask);
+    if (LocApiTraceRecorder::isRecording()) {
+        LocApiTraceRecorder::recordPosition(location, locationExtended,
+                                            status, loc_technology_mask);
+    }
     // loop through adapters, and deliver to all adapters.
+    LocFixLatency::beginReport(LocFixLatency::now());
     TO_ALL_LOCADAPTERS(
         mLocAdapters[i]->reportPosition(location,
                                         locationExtended,
@@ -251,6 +258,7 @@ void LocApiBase::reportPosition(UlpLocation &location,
                                         status,
                                         loc_technology_mask)
     );
+    LocFixLatency::endReport();
 }
 
 void LocApiBase::reportSv(QcomSvStatus &svStatus,
@@ -271,6 +279,9 @@ void LocApiBase::reportSv(QcomSvStatus &svStatus,
                  svStatus.sv_list[i].elevation,
                  svStatus.sv_list[i].azimuth);
     }
+    if (LocApiTraceRecorder::isRecording()) {
+        LocApiTraceRecorder::recordSv(svStatus, locationExtended);
+    }
     // loop through adapters, and deliver to all adapters.
     TO_ALL_LOCADAPTERS(
         mLocAdapters[i]->reportSv(svStatus,
@@ -281,12 +292,18 @@ void LocApiBase::reportSv(QcomSvStatus &svStatus,
 
 void LocApiBase::reportStatus(GpsStatusValue status)
 {
+    if (LocApiTraceRecorder::isRecording()) {
+        LocApiTraceRecorder::recordStatus(status);
+    }
     // loop through adapters, and deliver to all adapters.
     TO_ALL_LOCADAPTERS(mLocAdapters[i]->reportStatus(status));
 }
 
 void LocApiBase::reportNmea(const char* nmea, int length)
 {
+    if (LocApiTraceRecorder::isRecording()) {
+        LocApiTraceRecorder::recordNmea(nmea, length);
+    }
     // loop through adapters, and deliver to all adapters.
     TO_ALL_LOCADAPTERS(mLocAdapters[i]->reportNmea(nmea, length));
 }
@@ -301,6 +318,9 @@ void LocApiBase::reportXtraServer(const char* url1, const char* url2,
 
 void LocApiBase::requestXtraData()
 {
+    if (LocApiTraceRecorder::isRecording()) {
+        LocApiTraceRecorder::recordRequestXtraData();
+    }
     // loop through adapters, and deliver to the first handling adapter.
     TO_1ST_HANDLING_LOCADAPTERS(mLocAdapters[i]->requestXtraData());
 }
@@ -319,12 +339,18 @@ void LocApiBase::requestLocation()
 
 void LocApiBase::requestATL(int connHandle, AGpsType agps_type)
 {
+    if (LocApiTraceRecorder::isRecording()) {
+        LocApiTraceRecorder::recordRequestATL(connHandle, agps_type);
+    }
     // loop through adapters, and deliver to the first handling adapter.
     TO_1ST_HANDLING_LOCADAPTERS(mLocAdapters[i]->requestATL(connHandle, agps_type));
 }
 
 void LocApiBase::releaseATL(int connHandle)
 {
+    if (LocApiTraceRecorder::isRecording()) {
+        LocApiTraceRecorder::recordReleaseATL(connHandle);
+    }
     // loop through adapters, and deliver to the first handling adapter.
     TO_1ST_HANDLING_LOCADAPTERS(mLocAdapters[i]->releaseATL(connHandle));
 }
@@ -0,0 +1,390 @@
+/*
+ * Copyright (C) 2016, The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_ApiSynthetic"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <LocApiSynthetic.h>
+#include <log_util.h>
+
+namespace loc_core {
+
+#define SYNTHETIC_CENTER_LAT    37.4220
+#define SYNTHETIC_CENTER_LON    -122.0841
+#define SYNTHETIC_RADIUS_M      200.0
+#define SYNTHETIC_SPEED_MPS     10.0f
+#define SYNTHETIC_M_PER_DEG     111320.0
+#define SYNTHETIC_GLO_PRN_MIN   65
+#define SYNTHETIC_BDS_PRN_MIN   201
+
+static LocApiSyntheticConfig sConfig;
+static bool sSelected = false;
+
+// produces the fixes and SV reports on the synthetic receiver thread
+class LocApiSyntheticRunnable : public LocRunnable {
+    LocApiSynthetic* mLocApi;
+    const LocApiSyntheticConfig mConfig;
+    const volatile int* mAtlOpenHandle;
+    struct timespec mNext;
+    long mPeriodNs;
+    uint32_t mTick;
+    uint32_t mLate;
+    int mAtlHandle;
+    unsigned int mSeed;
+    UlpLocation mLocation;
+    GpsLocationExtended mLocationExtended;
+    QcomSvStatus mSvStatus;
+    GpsData mGpsData;
+
+    void makeSv(uint32_t tick);
+    void makeMeasurements(uint32_t tick);
+    void makeLocation(uint32_t tick);
+    void simulateAtl(uint32_t tick);
+public:
+    LocApiSyntheticRunnable(LocApiSynthetic* locApi,
+                            const LocApiSyntheticConfig& config,
+                            const volatile int* atlOpenHandle);
+    virtual ~LocApiSyntheticRunnable();
+    virtual void prerun();
+    virtual bool run();
+};
+
+LocApiSyntheticRunnable::LocApiSyntheticRunnable(LocApiSynthetic* locApi,
+                                                 const LocApiSyntheticConfig& config,
+                                                 const volatile int* atlOpenHandle) :
+    LocRunnable(), mLocApi(locApi), mConfig(config),
+    mAtlOpenHandle(atlOpenHandle), mPeriodNs(1000000000L / config.rateHz),
+    mTick(0), mLate(0), mAtlHandle(0), mSeed(config.rateHz)
+{
+    memset(&mLocation, 0, sizeof(mLocation));
+    mLocation.size = sizeof(mLocation);
+    mLocation.gpsLocation.size = sizeof(mLocation.gpsLocation);
+    mLocation.position_source = ULP_LOCATION_IS_FROM_GNSS;
+    memset(&mLocationExtended, 0, sizeof(mLocationExtended));
+    mLocationExtended.size = sizeof(mLocationExtended);
+    memset(&mSvStatus, 0, sizeof(mSvStatus));
+    mSvStatus.size = sizeof(mSvStatus);
+    memset(&mGpsData, 0, sizeof(mGpsData));
+    mGpsData.size = sizeof(mGpsData);
+}
+
+LocApiSyntheticRunnable::~LocApiSyntheticRunnable()
+{
+    LOC_LOGI("%s: %u ticks at %u Hz, %u late", __func__,
+             mTick, mConfig.rateHz, mLate);
+}
+
+void LocApiSyntheticRunnable::prerun()
+{
+    mLocApi->reportStatus(GPS_STATUS_ENGINE_ON);
+    mLocApi->reportStatus(GPS_STATUS_SESSION_BEGIN);
+    clock_gettime(CLOCK_MONOTONIC, &mNext);
+}
+
+void LocApiSyntheticRunnable::makeSv(uint32_t tick)
+{
+    // SVs drift slowly across the sky, one degree of azimuth a second
+    float drift = (float)tick / mConfig.rateHz;
+
+    mSvStatus.num_svs = 0;
+    mSvStatus.gps_used_in_fix_mask = 0;
+    mSvStatus.glo_used_in_fix_mask = 0;
+    mSvStatus.bds_used_in_fix_mask = 0;
+    mSvStatus.ephemeris_mask = 0;
+    mSvStatus.almanac_mask = 0;
+
+    for (uint32_t i = 0; i < mConfig.numSvs && i < GPS_MAX_SVS; i++) {
+        GpsSvInfo &sv = mSvStatus.sv_list[mSvStatus.num_svs++];
+        uint32_t n = i / 3;
+        bool used = (i % 4) != 3;
+
+        sv.size = sizeof(sv);
+        sv.snr = 20.0f + (i * 7) % 25;
+        sv.elevation = 10.0f + (i * 13) % 80;
+        sv.azimuth = fmodf(i * 37.0f + drift, 360.0f);
+
+        switch (i % 3) {
+        case 0:
+            sv.prn = n + 1;
+            mSvStatus.ephemeris_mask |= 1 << n;
+            mSvStatus.almanac_mask |= 1 << n;
+            if (used) {
+                mSvStatus.gps_used_in_fix_mask |= 1 << n;
+            }
+            break;
+        case 1:
+            sv.prn = SYNTHETIC_GLO_PRN_MIN + n;
+            if (used) {
+                mSvStatus.glo_used_in_fix_mask |= 1 << n;
+            }
+            break;
+        default:
+            sv.prn = SYNTHETIC_BDS_PRN_MIN + n;
+            if (used) {
+                mSvStatus.bds_used_in_fix_mask |= 1ULL << n;
+            }
+            break;
+        }
+    }
+}
+
+void LocApiSyntheticRunnable::makeMeasurements(uint32_t tick)
+{
+    struct timespec now;
+    uint32_t count = 0;
+
+    for (int i = 0; i < mSvStatus.num_svs && count < GPS_MAX_MEASUREMENT; i++) {
+        const GpsSvInfo &sv = mSvStatus.sv_list[i];
+        if (sv.prn > 32) {
+            // measurements are GPS only
+            continue;
+        }
+        GpsMeasurement &m = mGpsData.measurements[count++];
+        m.size = sizeof(m);
+        m.flags = 0;
+        m.prn = sv.prn;
+        m.state = GPS_MEASUREMENT_STATE_CODE_LOCK | GPS_MEASUREMENT_STATE_TOW_DECODED;
+        m.c_n0_dbhz = sv.snr;
+        m.received_gps_tow_ns = (int64_t)tick * 1000000000LL / mConfig.rateHz;
+        m.received_gps_tow_uncertainty_ns = 10;
+        m.pseudorange_rate_mps = 100.0 * (sv.prn % 7) - 300.0;
+        m.pseudorange_rate_uncertainty_mps = 0.1;
+        m.accumulated_delta_range_state = GPS_ADR_STATE_UNKNOWN;
+    }
+    mGpsData.measurement_count = count;
+
+    // the receiver clock is CLOCK_MONOTONIC, which lets consumers
+    // tell how long the report took to reach them
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    mGpsData.clock.size = sizeof(mGpsData.clock);
+    mGpsData.clock.type = GPS_CLOCK_TYPE_LOCAL_HW_TIME;
+    mGpsData.clock.time_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+void LocApiSyntheticRunnable::makeLocation(uint32_t tick)
+{
+    double t = (double)tick / mConfig.rateHz;
+    double angle = SYNTHETIC_SPEED_MPS * t / SYNTHETIC_RADIUS_M;
+    double lat0 = SYNTHETIC_CENTER_LAT * M_PI / 180.0;
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    GpsLocation &loc = mLocation.gpsLocation;
+    loc.flags = GPS_LOCATION_HAS_LAT_LONG | GPS_LOCATION_HAS_ALTITUDE |
+                GPS_LOCATION_HAS_SPEED | GPS_LOCATION_HAS_BEARING |
+                GPS_LOCATION_HAS_ACCURACY;
+    loc.latitude = SYNTHETIC_CENTER_LAT +
+        SYNTHETIC_RADIUS_M * cos(angle) / SYNTHETIC_M_PER_DEG;
+    loc.longitude = SYNTHETIC_CENTER_LON +
+        SYNTHETIC_RADIUS_M * sin(angle) / (SYNTHETIC_M_PER_DEG * cos(lat0));
+    loc.altitude = 30.0 + 2.0 * sin(t / 10.0);
+    loc.speed = SYNTHETIC_SPEED_MPS;
+    loc.bearing = fmod(angle * 180.0 / M_PI + 90.0, 360.0);
+    loc.accuracy = 3.0f + (rand_r(&mSeed) % 100) / 50.0f;
+    loc.timestamp = (GpsUtcTime)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+
+    mLocationExtended.flags = GPS_LOCATION_EXTENDED_HAS_DOP |
+                              GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL;
+    mLocationExtended.altitudeMeanSeaLevel = loc.altitude + 32.0f;
+    mLocationExtended.pdop = 1.8f;
+    mLocationExtended.hdop = 1.0f;
+    mLocationExtended.vdop = 1.5f;
+}
+
+void LocApiSyntheticRunnable::simulateAtl(uint32_t tick)
+{
+    uint32_t ticksPerAtl = mConfig.atlIntervalSec * mConfig.rateHz;
+
+    // the data call the framework opened for the previous request
+    // is done with one tick later
+    if (mAtlHandle != 0 && *mAtlOpenHandle == mAtlHandle) {
+        mLocApi->releaseATL(mAtlHandle);
+        mAtlHandle = 0;
+    }
+    if (ticksPerAtl && tick % ticksPerAtl == ticksPerAtl - 1) {
+        if (mAtlHandle != 0) {
+            // never opened, give up on it
+            mLocApi->releaseATL(mAtlHandle);
+        }
+        mAtlHandle = tick + 1;
+        mLocApi->requestATL(mAtlHandle, AGPS_TYPE_SUPL);
+    }
+}
+
+bool LocApiSyntheticRunnable::run()
+{
+    uint32_t ticksPerXtra = mConfig.xtraIntervalSec * mConfig.rateHz;
+    struct timespec now;
+
+    mNext.tv_nsec += mPeriodNs;
+    if (mNext.tv_nsec >= 1000000000L) {
+        mNext.tv_nsec -= 1000000000L;
+        mNext.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &mNext, NULL);
+
+    // when we fall more than a period behind, count it and resync
+    // instead of bursting to catch up
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((now.tv_sec - mNext.tv_sec) * 1000000000LL +
+        (now.tv_nsec - mNext.tv_nsec) > mPeriodNs) {
+        mLate++;
+        mNext = now;
+    }
+
+    makeSv(mTick);
+    mLocApi->reportSv(mSvStatus, mLocationExtended, NULL);
+
+    if (mLocApi->isMeasurementEnabled()) {
+        makeMeasurements(mTick);
+        mLocApi->reportGpsMeasurementData(mGpsData);
+    }
+
+    makeLocation(mTick);
+    if (mConfig.failurePercent &&
+        (uint32_t)(rand_r(&mSeed) % 100) < mConfig.failurePercent) {
+        mLocation.gpsLocation.flags = 0;
+        mLocApi->reportPosition(mLocation, mLocationExtended, NULL,
+                                LOC_SESS_FAILURE);
+    } else {
+        mLocApi->reportPosition(mLocation, mLocationExtended, NULL,
+                                LOC_SESS_SUCCESS, LOC_POS_TECH_MASK_SATELLITE);
+    }
+
+    simulateAtl(mTick);
+    if (ticksPerXtra && mTick % ticksPerXtra == ticksPerXtra - 1) {
+        mLocApi->requestXtraData();
+    }
+
+    mTick++;
+    return true;
+}
+
+void LocApiSynthetic::select(const LocApiSyntheticConfig& config)
+{
+    sConfig = config;
+    if (sConfig.rateHz > LOC_API_SYNTHETIC_MAX_RATE) {
+        sConfig.rateHz = LOC_API_SYNTHETIC_MAX_RATE;
+    }
+    if (sConfig.failurePercent > 100) {
+        sConfig.failurePercent = 100;
+    }
+    sSelected = (sConfig.rateHz > 0);
+}
+
+bool LocApiSynthetic::isSelected()
+{
+    return sSelected;
+}
+
+LocApiSynthetic::LocApiSynthetic(const MsgTask* msgTask,
+                                 LOC_API_ADAPTER_EVENT_MASK_T exMask,
+                                 ContextBase* context) :
+    LocApiBase(msgTask, exMask, context),
+    mConfig(sConfig), mSeed(sConfig.rateHz), mAtlOpenHandle(0)
+{
+    LOC_LOGD("%s: %u Hz, %u SVs, ATL every %us, XTRA every %us, %u%% failures",
+             __func__, mConfig.rateHz, mConfig.numSvs, mConfig.atlIntervalSec,
+             mConfig.xtraIntervalSec, mConfig.failurePercent);
+}
+
+bool LocApiSynthetic::shouldFail()
+{
+    return mConfig.failurePercent &&
+        (uint32_t)(rand_r(&mSeed) % 100) < mConfig.failurePercent;
+}
+
+enum loc_api_adapter_err
+LocApiSynthetic::open(LOC_API_ADAPTER_EVENT_MASK_T mask)
+{
+    mMask = mask;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err
+LocApiSynthetic::startFix(const LocPosMode& posMode)
+{
+    if (mThread.isRunning()) {
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+    if (shouldFail()) {
+        return LOC_API_ADAPTER_ERR_GENERAL_FAILURE;
+    }
+
+    LocApiSyntheticRunnable* runnable =
+        new LocApiSyntheticRunnable(this, mConfig, &mAtlOpenHandle);
+    if (!mThread.start("LocApiSynth", runnable)) {
+        delete runnable;
+        return LOC_API_ADAPTER_ERR_GENERAL_FAILURE;
+    }
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err
+LocApiSynthetic::stopFix()
+{
+    if (mThread.isRunning()) {
+        mThread.stop();
+        reportStatus(GPS_STATUS_SESSION_END);
+        reportStatus(GPS_STATUS_ENGINE_OFF);
+    }
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err
+LocApiSynthetic::setXtraData(char* data, int length)
+{
+    return shouldFail() ?
+        LOC_API_ADAPTER_ERR_GENERAL_FAILURE : LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err
+LocApiSynthetic::atlOpenStatus(int handle, int is_succ, char* apn,
+                               AGpsBearerType bear, AGpsType agpsType)
+{
+    if (shouldFail()) {
+        return LOC_API_ADAPTER_ERR_GENERAL_FAILURE;
+    }
+    if (is_succ) {
+        mAtlOpenHandle = handle;
+    }
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err
+LocApiSynthetic::atlCloseStatus(int handle, int is_succ)
+{
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+int LocApiSynthetic::updateRegistrationMask(LOC_API_ADAPTER_EVENT_MASK_T event,
+                                            loc_registration_mask_status isEnabled)
+{
+    if (LOC_REGISTRATION_MASK_ENABLED == isEnabled) {
+        mMask |= event;
+    } else {
+        mMask &= ~event;
+    }
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+} // namespace loc_core
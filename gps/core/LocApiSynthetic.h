@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2016, The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LOC_API_SYNTHETIC_H
+#define LOC_API_SYNTHETIC_H
+
+#include <LocApiBase.h>
+#include <LocThread.h>
+
+namespace loc_core {
+
+#define LOC_API_SYNTHETIC_MAX_RATE 100
+
+struct LocApiSyntheticConfig {
+    // fixes per second, 1 to LOC_API_SYNTHETIC_MAX_RATE
+    uint32_t rateHz;
+    // SVs reported per fix, spread over GPS, GLONASS and BDS
+    uint32_t numSvs;
+    // seconds between simulated ATL and XTRA data requests, 0 for never
+    uint32_t atlIntervalSec;
+    uint32_t xtraIntervalSec;
+    // percentage of fixes reported as failed, and of startFix(),
+    // atlOpenStatus() and setXtraData() calls that fail
+    uint32_t failurePercent;
+};
+
+// LocApiBase backend that makes up a receiver moving on a circle and
+// reports fixes, SV status and, once registered for, GNSS measurements
+// at a fixed rate, so the AP side of the stack can be load tested
+// without a modem.
+class LocApiSynthetic : public LocApiBase {
+    LocThread mThread;
+    LocApiSyntheticConfig mConfig;
+    unsigned int mSeed;
+    // handle of the last ATL the framework opened for us
+    volatile int mAtlOpenHandle;
+    bool shouldFail();
+public:
+    static void select(const LocApiSyntheticConfig& config);
+    static bool isSelected();
+
+    inline bool isMeasurementEnabled() const {
+        return 0 != (mMask & LOC_API_ADAPTER_BIT_GNSS_MEASUREMENT);
+    }
+
+    LocApiSynthetic(const MsgTask* msgTask,
+                    LOC_API_ADAPTER_EVENT_MASK_T exMask,
+                    ContextBase* context);
+    inline virtual ~LocApiSynthetic() {}
+
+    virtual enum loc_api_adapter_err
+        open(LOC_API_ADAPTER_EVENT_MASK_T mask);
+    virtual enum loc_api_adapter_err
+        startFix(const LocPosMode& posMode);
+    virtual enum loc_api_adapter_err
+        stopFix();
+    virtual enum loc_api_adapter_err
+        setXtraData(char* data, int length);
+    virtual enum loc_api_adapter_err
+        atlOpenStatus(int handle, int is_succ, char* apn, AGpsBearerType bear, AGpsType agpsType);
+    virtual enum loc_api_adapter_err
+        atlCloseStatus(int handle, int is_succ);
+    virtual int updateRegistrationMask(LOC_API_ADAPTER_EVENT_MASK_T event,
+                                       loc_registration_mask_status isEnabled);
+};
+
+} // namespace loc_core
+
+#endif //LOC_API_SYNTHETIC_H
@@ -0,0 +1,497 @@
+/*
+ * Copyright (C) 2016, The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_ApiTrace"
+
+#include <limits.h>
+#include <time.h>
+#include <string.h>
+#include <LocApiTrace.h>
+#include <log_util.h>
+
+namespace loc_core {
+
+#define LOC_API_TRACE_MAX_PAYLOAD (LOC_API_TRACE_MAX_NMEA + 64)
+
+static int64_t getMonotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// fixed size field (de)serialization of a record payload
+class LocApiTraceBuffer {
+    uint8_t mData[LOC_API_TRACE_MAX_PAYLOAD];
+    uint32_t mLength;
+    uint32_t mPos;
+    bool mOk;
+public:
+    inline LocApiTraceBuffer() : mLength(0), mPos(0), mOk(true) {}
+    inline const uint8_t* data() const { return mData; }
+    inline uint8_t* data() { return mData; }
+    inline uint32_t length() const { return mLength; }
+    inline void setLength(uint32_t length) { mLength = length; mPos = 0; mOk = true; }
+    inline bool ok() const { return mOk; }
+
+    inline void put(const void* src, uint32_t len) {
+        if (mOk && mLength + len <= sizeof(mData)) {
+            memcpy(mData + mLength, src, len);
+            mLength += len;
+        } else {
+            mOk = false;
+        }
+    }
+    // a read past the end of the payload fails the whole buffer and
+    // leaves zeroes in dst, all later reads fail too
+    inline bool get(void* dst, uint32_t len) {
+        if (mOk && len <= mLength - mPos) {
+            memcpy(dst, mData + mPos, len);
+            mPos += len;
+        } else {
+            memset(dst, 0, len);
+            mOk = false;
+        }
+        return mOk;
+    }
+    inline void putU8(uint8_t v) { put(&v, sizeof(v)); }
+    inline void putU16(uint16_t v) { put(&v, sizeof(v)); }
+    inline void putU32(uint32_t v) { put(&v, sizeof(v)); }
+    inline void putU64(uint64_t v) { put(&v, sizeof(v)); }
+    inline void putF(float v) { put(&v, sizeof(v)); }
+    inline void putD(double v) { put(&v, sizeof(v)); }
+    inline uint8_t getU8() { uint8_t v; get(&v, sizeof(v)); return v; }
+    inline uint16_t getU16() { uint16_t v; get(&v, sizeof(v)); return v; }
+    inline uint32_t getU32() { uint32_t v; get(&v, sizeof(v)); return v; }
+    inline uint64_t getU64() { uint64_t v; get(&v, sizeof(v)); return v; }
+    inline float getF() { float v; get(&v, sizeof(v)); return v; }
+    inline double getD() { double v; get(&v, sizeof(v)); return v; }
+
+    void putLocationExtended(const GpsLocationExtended &ext);
+    void getLocationExtended(GpsLocationExtended &ext);
+};
+
+void LocApiTraceBuffer::putLocationExtended(const GpsLocationExtended &ext)
+{
+    putU16(ext.flags);
+    putF(ext.altitudeMeanSeaLevel);
+    putF(ext.pdop);
+    putF(ext.hdop);
+    putF(ext.vdop);
+    putF(ext.magneticDeviation);
+    putF(ext.vert_unc);
+    putF(ext.speed_unc);
+    putF(ext.bearing_unc);
+    putU8(ext.horizontal_reliability);
+    putU8(ext.vertical_reliability);
+}
+
+void LocApiTraceBuffer::getLocationExtended(GpsLocationExtended &ext)
+{
+    memset(&ext, 0, sizeof(ext));
+    ext.size = sizeof(ext);
+    ext.flags = getU16();
+    ext.altitudeMeanSeaLevel = getF();
+    ext.pdop = getF();
+    ext.hdop = getF();
+    ext.vdop = getF();
+    ext.magneticDeviation = getF();
+    ext.vert_unc = getF();
+    ext.speed_unc = getF();
+    ext.bearing_unc = getF();
+    ext.horizontal_reliability = (LocReliability)getU8();
+    ext.vertical_reliability = (LocReliability)getU8();
+}
+
+// record header, followed by length bytes of payload
+struct LocApiTraceRecordHeader {
+    uint16_t type;
+    uint16_t reserved;
+    uint32_t length;
+    int64_t timestampNs;
+};
+
+FILE* LocApiTraceRecorder::mFile = NULL;
+pthread_mutex_t LocApiTraceRecorder::mMutex = PTHREAD_MUTEX_INITIALIZER;
+
+bool LocApiTraceRecorder::start(const char* path)
+{
+    pthread_mutex_lock(&mMutex);
+    if (NULL == mFile) {
+        FILE* file = fopen(path, "we");
+        if (NULL == file) {
+            LOC_LOGE("%s: can not open %s", __func__, path);
+        } else {
+            uint32_t fileHeader[2] = {LOC_API_TRACE_MAGIC, LOC_API_TRACE_VERSION};
+            fwrite(fileHeader, sizeof(fileHeader), 1, file);
+            mFile = file;
+            LOC_LOGI("%s: recording LocApi events into %s", __func__, path);
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+    return NULL != mFile;
+}
+
+void LocApiTraceRecorder::stop()
+{
+    pthread_mutex_lock(&mMutex);
+    if (NULL != mFile) {
+        fclose(mFile);
+        mFile = NULL;
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocApiTraceRecorder::write(LocApiTraceEventType type,
+                                const void* payload, uint32_t length)
+{
+    LocApiTraceRecordHeader header;
+    header.type = type;
+    header.reserved = 0;
+    header.length = length;
+    header.timestampNs = getMonotonicNs();
+
+    pthread_mutex_lock(&mMutex);
+    if (NULL != mFile) {
+        fwrite(&header, sizeof(header), 1, mFile);
+        if (length > 0) {
+            fwrite(payload, length, 1, mFile);
+        }
+        // keep the trace usable if the process dies
+        fflush(mFile);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocApiTraceRecorder::recordPosition(const UlpLocation &location,
+                                         const GpsLocationExtended &locationExtended,
+                                         enum loc_sess_status status,
+                                         LocPosTechMask techMask)
+{
+    LocApiTraceBuffer buf;
+    buf.putU16(location.gpsLocation.flags);
+    buf.putD(location.gpsLocation.latitude);
+    buf.putD(location.gpsLocation.longitude);
+    buf.putD(location.gpsLocation.altitude);
+    buf.putF(location.gpsLocation.speed);
+    buf.putF(location.gpsLocation.bearing);
+    buf.putF(location.gpsLocation.accuracy);
+    buf.putU64(location.gpsLocation.timestamp);
+    buf.putU16(location.position_source);
+    buf.putU8(location.is_indoor);
+    buf.putF(location.floor_number);
+    buf.putLocationExtended(locationExtended);
+    buf.putU8(status);
+    buf.putU32(techMask);
+    write(LOC_API_TRACE_POSITION, buf.data(), buf.length());
+}
+
+void LocApiTraceRecorder::recordSv(const QcomSvStatus &svStatus,
+                                   const GpsLocationExtended &locationExtended)
+{
+    LocApiTraceBuffer buf;
+    int numSvs = svStatus.num_svs < GPS_MAX_SVS ? svStatus.num_svs : GPS_MAX_SVS;
+    buf.putU8(numSvs);
+    for (int i = 0; i < numSvs; i++) {
+        buf.putU16(svStatus.sv_list[i].prn);
+        buf.putF(svStatus.sv_list[i].snr);
+        buf.putF(svStatus.sv_list[i].elevation);
+        buf.putF(svStatus.sv_list[i].azimuth);
+    }
+    buf.putU32(svStatus.ephemeris_mask);
+    buf.putU32(svStatus.almanac_mask);
+    buf.putU32(svStatus.gps_used_in_fix_mask);
+    buf.putU32(svStatus.glo_used_in_fix_mask);
+    buf.putU64(svStatus.bds_used_in_fix_mask);
+    buf.putLocationExtended(locationExtended);
+    write(LOC_API_TRACE_SV, buf.data(), buf.length());
+}
+
+void LocApiTraceRecorder::recordStatus(GpsStatusValue status)
+{
+    uint16_t value = status;
+    write(LOC_API_TRACE_STATUS, &value, sizeof(value));
+}
+
+void LocApiTraceRecorder::recordNmea(const char* nmea, int length)
+{
+    if (length > LOC_API_TRACE_MAX_NMEA) {
+        length = LOC_API_TRACE_MAX_NMEA;
+    }
+    write(LOC_API_TRACE_NMEA, nmea, length > 0 ? length : 0);
+}
+
+void LocApiTraceRecorder::recordRequestATL(int connHandle, AGpsType agpsType)
+{
+    LocApiTraceBuffer buf;
+    buf.putU32(connHandle);
+    buf.putU16(agpsType);
+    write(LOC_API_TRACE_REQUEST_ATL, buf.data(), buf.length());
+}
+
+void LocApiTraceRecorder::recordReleaseATL(int connHandle)
+{
+    uint32_t value = connHandle;
+    write(LOC_API_TRACE_RELEASE_ATL, &value, sizeof(value));
+}
+
+void LocApiTraceRecorder::recordRequestXtraData()
+{
+    write(LOC_API_TRACE_REQUEST_XTRA_DATA, NULL, 0);
+}
+
+bool LocApiTraceReader::open(const char* path)
+{
+    uint32_t fileHeader[2];
+    mFile = fopen(path, "re");
+    if (NULL == mFile) {
+        LOC_LOGE("%s: can not open %s", __func__, path);
+        return false;
+    }
+    if (fread(fileHeader, sizeof(fileHeader), 1, mFile) != 1 ||
+        LOC_API_TRACE_MAGIC != fileHeader[0] ||
+        LOC_API_TRACE_VERSION != fileHeader[1]) {
+        LOC_LOGE("%s: %s is not a LocApi trace", __func__, path);
+        fclose(mFile);
+        mFile = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool LocApiTraceReader::next(LocApiTraceEvent &event)
+{
+    LocApiTraceRecordHeader header;
+    LocApiTraceBuffer buf;
+
+    for (;;) {
+        if (NULL == mFile ||
+            fread(&header, sizeof(header), 1, mFile) != 1 ||
+            header.length > LOC_API_TRACE_MAX_PAYLOAD ||
+            (header.length > 0 && fread(buf.data(), header.length, 1, mFile) != 1)) {
+            return false;
+        }
+        buf.setLength(header.length);
+
+        event.type = (LocApiTraceEventType)header.type;
+        event.timestampNs = header.timestampNs;
+
+        switch (event.type) {
+        case LOC_API_TRACE_POSITION:
+            memset(&event.location, 0, sizeof(event.location));
+            event.location.size = sizeof(event.location);
+            event.location.gpsLocation.size = sizeof(event.location.gpsLocation);
+            event.location.gpsLocation.flags = buf.getU16();
+            event.location.gpsLocation.latitude = buf.getD();
+            event.location.gpsLocation.longitude = buf.getD();
+            event.location.gpsLocation.altitude = buf.getD();
+            event.location.gpsLocation.speed = buf.getF();
+            event.location.gpsLocation.bearing = buf.getF();
+            event.location.gpsLocation.accuracy = buf.getF();
+            event.location.gpsLocation.timestamp = buf.getU64();
+            event.location.position_source = buf.getU16();
+            event.location.is_indoor = buf.getU8();
+            event.location.floor_number = buf.getF();
+            buf.getLocationExtended(event.locationExtended);
+            event.sessionStatus = (enum loc_sess_status)buf.getU8();
+            event.techMask = buf.getU32();
+            break;
+        case LOC_API_TRACE_SV:
+            memset(&event.svStatus, 0, sizeof(event.svStatus));
+            event.svStatus.size = sizeof(event.svStatus);
+            event.svStatus.num_svs = buf.getU8();
+            if (!buf.ok() || event.svStatus.num_svs > GPS_MAX_SVS) {
+                return false;
+            }
+            for (int i = 0; i < event.svStatus.num_svs && buf.ok(); i++) {
+                event.svStatus.sv_list[i].size = sizeof(GpsSvInfo);
+                event.svStatus.sv_list[i].prn = (int16_t)buf.getU16();
+                event.svStatus.sv_list[i].snr = buf.getF();
+                event.svStatus.sv_list[i].elevation = buf.getF();
+                event.svStatus.sv_list[i].azimuth = buf.getF();
+            }
+            event.svStatus.ephemeris_mask = buf.getU32();
+            event.svStatus.almanac_mask = buf.getU32();
+            event.svStatus.gps_used_in_fix_mask = buf.getU32();
+            event.svStatus.glo_used_in_fix_mask = buf.getU32();
+            event.svStatus.bds_used_in_fix_mask = buf.getU64();
+            buf.getLocationExtended(event.locationExtended);
+            break;
+        case LOC_API_TRACE_STATUS:
+            event.status = buf.getU16();
+            break;
+        case LOC_API_TRACE_NMEA:
+            // the payload limit leaves room for the other record types
+            if (header.length > LOC_API_TRACE_MAX_NMEA) {
+                return false;
+            }
+            event.nmeaLength = header.length;
+            buf.get(event.nmea, header.length);
+            break;
+        case LOC_API_TRACE_REQUEST_ATL:
+            event.connHandle = (int32_t)buf.getU32();
+            event.agpsType = buf.getU16();
+            break;
+        case LOC_API_TRACE_RELEASE_ATL:
+            event.connHandle = (int32_t)buf.getU32();
+            break;
+        case LOC_API_TRACE_REQUEST_XTRA_DATA:
+            break;
+        default:
+            // unknown record from a newer recorder, skip it
+            LOC_LOGW("%s: skipping record type %d", __func__, header.type);
+            continue;
+        }
+
+        // a record shorter than its type fails here
+        return buf.ok();
+    }
+}
+
+static void signalEnd();
+
+// runs a trace through a LocApiTracePlayer on the playback thread
+class LocApiTracePlayback : public LocRunnable {
+    LocApiTracePlayer* mPlayer;
+    LocApiTraceReader mReader;
+    LocApiTraceEvent mEvent;
+    float mSpeed;
+    int64_t mFirstEventNs;
+    int64_t mStartNs;
+    uint32_t mCount;
+public:
+    inline LocApiTracePlayback(LocApiTracePlayer* player, float speed) :
+        LocRunnable(), mPlayer(player), mSpeed(speed),
+        mFirstEventNs(-1), mStartNs(0), mCount(0) {}
+    inline bool open(const char* path) { return mReader.open(path); }
+    virtual void prerun() { mStartNs = getMonotonicNs(); }
+    virtual bool run() {
+        if (!mReader.next(mEvent)) {
+            return false;
+        }
+        if (mFirstEventNs < 0) {
+            mFirstEventNs = mEvent.timestampNs;
+        }
+        if (mSpeed > 0) {
+            int64_t due = mStartNs +
+                (int64_t)((mEvent.timestampNs - mFirstEventNs) / mSpeed);
+            int64_t wait = due - getMonotonicNs();
+            if (wait > 0) {
+                struct timespec ts;
+                ts.tv_sec = wait / 1000000000LL;
+                ts.tv_nsec = wait % 1000000000LL;
+                nanosleep(&ts, NULL);
+            }
+        }
+        mPlayer->play(mEvent);
+        mCount++;
+        return true;
+    }
+    virtual void postrun() {
+        LOC_LOGI("%s: replayed %u events in %lld ms", __func__, mCount,
+                 (long long)(getMonotonicNs() - mStartNs) / 1000000);
+        signalEnd();
+    }
+};
+
+static char sTracePath[PATH_MAX];
+static float sTraceSpeed = 1.0f;
+static bool sTraceEnded = false;
+static pthread_mutex_t sTraceEndMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sTraceEndCond = PTHREAD_COND_INITIALIZER;
+
+static void signalEnd()
+{
+    pthread_mutex_lock(&sTraceEndMutex);
+    sTraceEnded = true;
+    pthread_cond_broadcast(&sTraceEndCond);
+    pthread_mutex_unlock(&sTraceEndMutex);
+}
+
+void LocApiTracePlayer::select(const char* path, float speed)
+{
+    strlcpy(sTracePath, path ? path : "", sizeof(sTracePath));
+    sTraceSpeed = speed;
+}
+
+bool LocApiTracePlayer::isSelected()
+{
+    return '\0' != sTracePath[0];
+}
+
+void LocApiTracePlayer::waitForEnd()
+{
+    pthread_mutex_lock(&sTraceEndMutex);
+    while (!sTraceEnded) {
+        pthread_cond_wait(&sTraceEndCond, &sTraceEndMutex);
+    }
+    pthread_mutex_unlock(&sTraceEndMutex);
+}
+
+LocApiTracePlayer::LocApiTracePlayer(const MsgTask* msgTask,
+                                     LOC_API_ADAPTER_EVENT_MASK_T exMask,
+                                     ContextBase* context) :
+    LocApiBase(msgTask, exMask, context)
+{
+}
+
+void LocApiTracePlayer::play(const LocApiTraceEvent &event)
+{
+    // the upward calls take non const references
+    LocApiTraceEvent &e = const_cast<LocApiTraceEvent&>(event);
+
+    switch (e.type) {
+    case LOC_API_TRACE_POSITION:
+        reportPosition(e.location, e.locationExtended, NULL,
+                       e.sessionStatus, e.techMask);
+        break;
+    case LOC_API_TRACE_SV:
+        reportSv(e.svStatus, e.locationExtended, NULL);
+        break;
+    case LOC_API_TRACE_STATUS:
+        reportStatus(e.status);
+        break;
+    case LOC_API_TRACE_NMEA:
+        reportNmea(e.nmea, e.nmeaLength);
+        break;
+    case LOC_API_TRACE_REQUEST_ATL:
+        requestATL(e.connHandle, e.agpsType);
+        break;
+    case LOC_API_TRACE_RELEASE_ATL:
+        releaseATL(e.connHandle);
+        break;
+    case LOC_API_TRACE_REQUEST_XTRA_DATA:
+        requestXtraData();
+        break;
+    }
+}
+
+enum loc_api_adapter_err LocApiTracePlayer::startFix(const LocPosMode& posMode)
+{
+    if (!mThread.isRunning()) {
+        LocApiTracePlayback* playback = new LocApiTracePlayback(this, sTraceSpeed);
+        if (!playback->open(sTracePath) ||
+            !mThread.start("LocApiReplay", playback)) {
+            delete playback;
+            signalEnd();
+            return LOC_API_ADAPTER_ERR_GENERAL_FAILURE;
+        }
+    }
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+} // namespace loc_core
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2016, The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOC_API_TRACE_H
+#define LOC_API_TRACE_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <LocApiBase.h>
+#include <LocThread.h>
+
+namespace loc_core {
+
+#define LOC_API_TRACE_MAGIC      0x544f434c /* "LOCT" */
+#define LOC_API_TRACE_VERSION    1
+#define LOC_API_TRACE_MAX_NMEA   2048
+
+enum LocApiTraceEventType {
+    LOC_API_TRACE_POSITION = 1,
+    LOC_API_TRACE_SV,
+    LOC_API_TRACE_STATUS,
+    LOC_API_TRACE_NMEA,
+    LOC_API_TRACE_REQUEST_ATL,
+    LOC_API_TRACE_RELEASE_ATL,
+    LOC_API_TRACE_REQUEST_XTRA_DATA
+};
+
+// one decoded trace record, only the fields of its type are valid
+struct LocApiTraceEvent {
+    LocApiTraceEventType type;
+    // CLOCK_MONOTONIC at the time of the upward call
+    int64_t timestampNs;
+    UlpLocation location;
+    GpsLocationExtended locationExtended;
+    enum loc_sess_status sessionStatus;
+    LocPosTechMask techMask;
+    QcomSvStatus svStatus;
+    GpsStatusValue status;
+    char nmea[LOC_API_TRACE_MAX_NMEA];
+    int nmeaLength;
+    int connHandle;
+    AGpsType agpsType;
+};
+
+// Writes the upward calls of LocApiBase into a binary trace. Fields are
+// written one by one with fixed sizes, so a trace taken on the device
+// reads the same on a host of the same endianness. Opaque extension
+// pointers and raw data are not recorded.
+class LocApiTraceRecorder {
+    static FILE* mFile;
+    static pthread_mutex_t mMutex;
+    static void write(LocApiTraceEventType type, const void* payload, uint32_t length);
+public:
+    static bool start(const char* path);
+    static void stop();
+    static inline bool isRecording() { return NULL != mFile; }
+
+    static void recordPosition(const UlpLocation &location,
+                               const GpsLocationExtended &locationExtended,
+                               enum loc_sess_status status,
+                               LocPosTechMask techMask);
+    static void recordSv(const QcomSvStatus &svStatus,
+                         const GpsLocationExtended &locationExtended);
+    static void recordStatus(GpsStatusValue status);
+    static void recordNmea(const char* nmea, int length);
+    static void recordRequestATL(int connHandle, AGpsType agpsType);
+    static void recordReleaseATL(int connHandle);
+    static void recordRequestXtraData();
+};
+
+class LocApiTraceReader {
+    FILE* mFile;
+public:
+    inline LocApiTraceReader() : mFile(NULL) {}
+    inline ~LocApiTraceReader() { if (mFile) fclose(mFile); }
+    bool open(const char* path);
+    // false at the end of the trace or on a corrupted record
+    bool next(LocApiTraceEvent &event);
+};
+
+// LocApiBase backend that plays a recorded trace back through the upward
+// calls, as if the modem were sending it. Playback starts with the first
+// startFix() and runs on its own thread; speed 1 replays in real time,
+// N replays N times faster and 0 as fast as possible.
+class LocApiTracePlayer : public LocApiBase {
+    LocThread mThread;
+public:
+    static void select(const char* path, float speed);
+    static bool isSelected();
+    // blocks until the selected trace has been played to its end
+    static void waitForEnd();
+
+    LocApiTracePlayer(const MsgTask* msgTask,
+                      LOC_API_ADAPTER_EVENT_MASK_T exMask,
+                      ContextBase* context);
+    inline virtual ~LocApiTracePlayer() {}
+
+    void play(const LocApiTraceEvent &event);
+
+    virtual enum loc_api_adapter_err
+        startFix(const LocPosMode& posMode);
+};
+
+} // namespace loc_core
+
+#endif //LOC_API_TRACE_H
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2016, The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_BackendLibs"
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <time.h>
+#include <LocBackendLibs.h>
+#include <LocThread.h>
+#include <log_util.h>
+
+namespace loc_core {
+
+enum LibState {
+    LIB_UNLOADED = 0,
+    LIB_LOADING,
+    LIB_LOADED
+};
+
+struct LibEntry {
+    const char* const fileName;
+    const char* const entryName;
+    LibState state;
+    bool entryResolved;
+    void* handle;
+    void* entry;
+};
+
+static LibEntry sLibs[LocBackendLibs::LIB_COUNT] = {
+    {"liblbs_core.so",       "getLBSProxy",                LIB_UNLOADED, false, NULL, NULL},
+    {"libloc_api_v02.so",    "getLocApi",                  LIB_UNLOADED, false, NULL, NULL},
+    {"libloc_api-rpc-qc.so", "getLocApi",                  LIB_UNLOADED, false, NULL, NULL},
+    {"libgeofence.so",       "gps_geofence_get_interface", LIB_UNLOADED, false, NULL, NULL},
+};
+
+static pthread_mutex_t sMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sLoaded = PTHREAD_COND_INITIALIZER;
+static uint32_t sPrefetchMask = 0;
+static LocThread sPrefetchThread;
+
+static int64_t getMonotonicMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// loads the prefetched libraries one after the other; the dynamic
+// linker serializes dlopen() anyway, so one thread is all it takes.
+// Entry points are left for getEntry() to look up when first used.
+class LocBackendPrefetch : public LocRunnable {
+    int64_t mStartMs;
+public:
+    inline LocBackendPrefetch() : LocRunnable(), mStartMs(0) {}
+    virtual void prerun() { mStartMs = getMonotonicMs(); }
+    virtual bool run() {
+        uint32_t mask;
+        pthread_mutex_lock(&sMutex);
+        mask = sPrefetchMask;
+        pthread_mutex_unlock(&sMutex);
+
+        for (int i = 0; i < LocBackendLibs::LIB_COUNT; i++) {
+            if (mask & LocBackendLibs::bit((LocBackendLibs::Lib)i)) {
+                LocBackendLibs::get((LocBackendLibs::Lib)i);
+            }
+        }
+        return false;
+    }
+    virtual void postrun() {
+        LOC_LOGI("%s: prefetch done in %lld ms", __func__,
+                 (long long)(getMonotonicMs() - mStartMs));
+    }
+};
+
+void LocBackendLibs::prefetch(uint32_t mask)
+{
+    bool start;
+    pthread_mutex_lock(&sMutex);
+    start = (0 == sPrefetchMask);
+    sPrefetchMask |= mask;
+    pthread_mutex_unlock(&sMutex);
+
+    // libraries added after the thread has started are loaded on
+    // demand by their users
+    if (start && mask) {
+        LocBackendPrefetch* runnable = new LocBackendPrefetch();
+        if (!sPrefetchThread.start("LocLibPrefetch", runnable, false)) {
+            delete runnable;
+        }
+    }
+}
+
+const char* LocBackendLibs::name(Lib lib)
+{
+    return sLibs[lib].fileName;
+}
+
+void* LocBackendLibs::get(Lib lib)
+{
+    LibEntry &e = sLibs[lib];
+
+    pthread_mutex_lock(&sMutex);
+    if (LIB_UNLOADED == e.state) {
+        e.state = LIB_LOADING;
+        pthread_mutex_unlock(&sMutex);
+
+        int64_t start = getMonotonicMs();
+        void* handle = dlopen(e.fileName, RTLD_NOW);
+        LOC_LOGD("%s: %s %s in %lld ms", __func__, e.fileName,
+                 handle ? "loaded" : "not present",
+                 (long long)(getMonotonicMs() - start));
+
+        pthread_mutex_lock(&sMutex);
+        e.handle = handle;
+        e.state = LIB_LOADED;
+        pthread_cond_broadcast(&sLoaded);
+    } else if (LIB_LOADING == e.state) {
+        int64_t start = getMonotonicMs();
+        while (LIB_LOADED != e.state) {
+            pthread_cond_wait(&sLoaded, &sMutex);
+        }
+        LOC_LOGD("%s: waited %lld ms for %s", __func__,
+                 (long long)(getMonotonicMs() - start), e.fileName);
+    }
+    pthread_mutex_unlock(&sMutex);
+
+    return e.handle;
+}
+
+void* LocBackendLibs::getEntry(Lib lib)
+{
+    LibEntry &e = sLibs[lib];
+    void* handle = get(lib);
+
+    pthread_mutex_lock(&sMutex);
+    if (!e.entryResolved) {
+        e.entry = handle ? dlsym(handle, e.entryName) : NULL;
+        e.entryResolved = true;
+        if (handle && NULL == e.entry) {
+            LOC_LOGE("%s: %s has no %s", __func__, e.fileName, e.entryName);
+        }
+    }
+    pthread_mutex_unlock(&sMutex);
+
+    return e.entry;
+}
+
+} // namespace loc_core
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2016, The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LOC_BACKEND_LIBS_H
+#define LOC_BACKEND_LIBS_H
+
+#include <stdint.h>
+
+namespace loc_core {
+
+// Process wide cache of the optional vendor libraries the location
+// stack dlopen()s, and of the one entry point it needs from each.
+// prefetch() starts loading them as soon as the HAL is opened, so that
+// loc_init() finds them ready instead of loading them on its own path.
+// They are not probed in parallel: one background thread opens them one
+// after the other, as the dynamic linker holds its lock for the whole
+// of each dlopen(). Anything not prefetched is loaded on first use by
+// the caller. Every library is opened at most once.
+class LocBackendLibs {
+public:
+    enum Lib {
+        LBS_CORE = 0,   // liblbs_core.so, getLBSProxy
+        LOC_API_V02,    // libloc_api_v02.so, getLocApi
+        LOC_API_RPC,    // libloc_api-rpc-qc.so, getLocApi
+        GEOFENCE,       // libgeofence.so, gps_geofence_get_interface
+        LIB_COUNT
+    };
+
+    static inline uint32_t bit(Lib lib) { return 1 << lib; }
+
+    // starts loading the libraries in mask, in the order above, on a
+    // background thread, without resolving their entry points. Calling
+    // it again with libraries already queued or loaded is harmless.
+    static void prefetch(uint32_t mask);
+    // file name of lib
+    static const char* name(Lib lib);
+    // handle of lib, NULL if it is not present; waits for a prefetch
+    // in progress instead of loading it twice
+    static void* get(Lib lib);
+    // entry point of lib, resolved on first call and cached
+    static void* getEntry(Lib lib);
+};
+
+} // namespace loc_core
+
+#endif //LOC_BACKEND_LIBS_H
@@ -35,6 +35,11 @@
 #include <msg_q.h>
 #include <log_util.h>
 #include <loc_log.h>
+#include <loc_cfg.h>
+
+#ifndef GPS_CONF_FILE
+#define GPS_CONF_FILE            "/etc/gps.conf"
+#endif
 
 namespace loc_core {
 
@@ -63,6 +68,45 @@ const char* LocDualContext::mLBSLibName = "liblbs_core.so";
 
 pthread_mutex_t LocDualContext::mGetLocContextMutex = PTHREAD_MUTEX_INITIALIZER;
 
+// Threading model of the two contexts, from gps.conf:
+// LOC_CONTEXT_THREADS    1 - both contexts are served by one MsgTask
+//                            thread (default)
+//                        2 - the background context gets a MsgTask
+//                            thread of its own
+// LOC_BG_CONTEXT_SCHED   0 - the background thread stays in the
+//                            foreground scheduling group
+//                        1 - it is moved to the background group
+//                            (default, only with 2 threads)
+static uint32_t sContextThreads = 1;
+static uint32_t sBgContextSched = 1;
+static bool sThreadingConfigRead = false;
+static const MsgTask* sBgMsgTask = NULL;
+
+static const loc_param_s_type sThreadingConfTable[] =
+{
+    {"LOC_CONTEXT_THREADS",  &sContextThreads, NULL, 'n'},
+    {"LOC_BG_CONTEXT_SCHED", &sBgContextSched, NULL, 'n'},
+};
+
+// caller holds mGetLocContextMutex
+static void readThreadingConfig()
+{
+    if (!sThreadingConfigRead) {
+        UTIL_READ_CONF(GPS_CONF_FILE, sThreadingConfTable);
+        sThreadingConfigRead = true;
+        LOC_LOGD("%s:%d]: %u context thread(s), background sched %u",
+                 __func__, __LINE__, sContextThreads, sBgContextSched);
+    }
+}
+
+// first message on a dedicated background thread
+struct LocBgSchedMsg : public LocMsg {
+    inline LocBgSchedMsg() : LocMsg() {}
+    inline virtual void proc() const {
+        set_sched_policy(gettid(), SP_BACKGROUND);
+    }
+};
+
 const MsgTask* LocDualContext::getMsgTask(LocThread::tCreate tCreator,
                                           const char* name, bool joinable)
 {
@@ -109,7 +153,19 @@ ContextBase* LocDualContext::getLocBgContext(LocThread::tCreate tCreator,
     LOC_LOGD("%s:%d]: querying ContextBase with tCreator", __func__, __LINE__);
     if (NULL == mBgContext) {
         LOC_LOGD("%s:%d]: creating msgTask with tCreator", __func__, __LINE__);
-        const MsgTask* msgTask = getMsgTask(tCreator, name, joinable);
+        const MsgTask* msgTask;
+        readThreadingConfig();
+        if (sContextThreads > 1) {
+            if (NULL == sBgMsgTask) {
+                sBgMsgTask = new MsgTask(tCreator, name, joinable);
+                if (sBgContextSched) {
+                    sBgMsgTask->sendMsg(new LocBgSchedMsg());
+                }
+            }
+            msgTask = sBgMsgTask;
+        } else {
+            msgTask = getMsgTask(tCreator, name, joinable);
+        }
         mBgContext = new LocDualContext(msgTask,
                                         mBgExclMask);
     }
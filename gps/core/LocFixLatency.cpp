@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2016, The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_FixLatency"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <LocFixLatency.h>
+#include <log_util.h>
+
+namespace loc_core {
+
+#define LOC_FIX_LATENCY_BUCKETS 32
+#define LOC_FIX_TTFF_WINDOW     32
+
+// samples of one stage, in microseconds
+struct LatencyStage {
+    uint32_t window[LOC_FIX_LATENCY_WINDOW];
+    uint32_t next;
+    uint32_t inWindow;
+    uint64_t count;
+    uint32_t max;
+    // bucket n counts samples in [2^(n-1), 2^n) us, bucket 0 below 1 us
+    uint64_t histogram[LOC_FIX_LATENCY_BUCKETS];
+};
+
+static const char* const sStageNames[LocFixLatency::STAGE_COUNT] = {
+    "report", "queue", "callback", "total"
+};
+
+static pthread_mutex_t sMutex = PTHREAD_MUTEX_INITIALIZER;
+static LatencyStage sStages[LocFixLatency::STAGE_COUNT];
+static int64_t sSessionStartNs = 0;
+static uint32_t sTtffMs[LOC_FIX_TTFF_WINDOW];
+static uint32_t sTtffCount = 0;
+
+static pthread_once_t sKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t sReportKey;
+
+static void createReportKey()
+{
+    pthread_key_create(&sReportKey, free);
+}
+
+// the calling thread's report stamp
+static int64_t* getReportSlot()
+{
+    pthread_once(&sKeyOnce, createReportKey);
+    int64_t* slot = (int64_t*)pthread_getspecific(sReportKey);
+    if (NULL == slot) {
+        slot = (int64_t*)calloc(1, sizeof(int64_t));
+        if (NULL != slot) {
+            pthread_setspecific(sReportKey, slot);
+        }
+    }
+    return slot;
+}
+
+static void addSample(LatencyStage &stage, int64_t ns)
+{
+    uint32_t us = ns > 0 ? (uint32_t)std::min<int64_t>(ns / 1000, UINT32_MAX) : 0;
+    int bucket = 0;
+
+    for (uint32_t v = us; v && bucket < LOC_FIX_LATENCY_BUCKETS - 1; v >>= 1) {
+        bucket++;
+    }
+    stage.histogram[bucket]++;
+    stage.window[stage.next] = us;
+    stage.next = (stage.next + 1) % LOC_FIX_LATENCY_WINDOW;
+    if (stage.inWindow < LOC_FIX_LATENCY_WINDOW) {
+        stage.inWindow++;
+    }
+    stage.count++;
+    stage.max = std::max(stage.max, us);
+}
+
+// p-th percentile of the first n values, which get reordered
+static uint32_t percentile(uint32_t* values, uint32_t n, uint32_t p)
+{
+    if (0 == n) {
+        return 0;
+    }
+    uint32_t k = (uint32_t)(((uint64_t)n * p) / 100);
+    if (k >= n) {
+        k = n - 1;
+    }
+    std::nth_element(values, values + k, values + n);
+    return values[k];
+}
+
+int64_t LocFixLatency::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void LocFixLatency::beginReport(int64_t reportNs)
+{
+    int64_t* slot = getReportSlot();
+    if (NULL != slot) {
+        *slot = reportNs;
+    }
+}
+
+void LocFixLatency::endReport()
+{
+    int64_t* slot = getReportSlot();
+    if (NULL != slot) {
+        *slot = 0;
+    }
+}
+
+int64_t LocFixLatency::reportStamp()
+{
+    int64_t* slot = getReportSlot();
+    return (NULL != slot) ? *slot : 0;
+}
+
+void LocFixLatency::record(int64_t reportNs, int64_t queuedNs,
+                           int64_t procNs, int64_t doneNs)
+{
+    pthread_mutex_lock(&sMutex);
+    if (reportNs) {
+        addSample(sStages[STAGE_REPORT], queuedNs - reportNs);
+        addSample(sStages[STAGE_TOTAL], doneNs - reportNs);
+    }
+    addSample(sStages[STAGE_QUEUE], procNs - queuedNs);
+    addSample(sStages[STAGE_CALLBACK], doneNs - procNs);
+
+    if (sSessionStartNs && doneNs >= sSessionStartNs) {
+        uint32_t ttffMs = (uint32_t)((doneNs - sSessionStartNs) / 1000000);
+        sTtffMs[sTtffCount % LOC_FIX_TTFF_WINDOW] = ttffMs;
+        sTtffCount++;
+        sSessionStartNs = 0;
+        LOC_LOGI("%s: TTFF %u ms", __func__, ttffMs);
+    }
+    pthread_mutex_unlock(&sMutex);
+}
+
+void LocFixLatency::sessionStarted()
+{
+    pthread_mutex_lock(&sMutex);
+    sSessionStartNs = now();
+    pthread_mutex_unlock(&sMutex);
+}
+
+size_t LocFixLatency::dump(char* buffer, size_t bufferSize)
+{
+    static uint32_t values[LOC_FIX_LATENCY_WINDOW];
+    size_t len = 0;
+
+#define DUMP(...) \
+    if (len < bufferSize) { \
+        int written = snprintf(buffer + len, bufferSize - len, __VA_ARGS__); \
+        len += (written > 0) ? written : 0; \
+        if (len > bufferSize) len = bufferSize; \
+    }
+
+    pthread_mutex_lock(&sMutex);
+
+    DUMP("Fix delivery latency (us), percentiles of the last %d fixes\n",
+         LOC_FIX_LATENCY_WINDOW);
+    DUMP("%-9s %10s %8s %8s %8s %8s\n", "stage", "count", "p50", "p90", "p99", "max");
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        LatencyStage &stage = sStages[i];
+        memcpy(values, stage.window, stage.inWindow * sizeof(values[0]));
+        uint32_t p50 = percentile(values, stage.inWindow, 50);
+        uint32_t p90 = percentile(values, stage.inWindow, 90);
+        uint32_t p99 = percentile(values, stage.inWindow, 99);
+        DUMP("%-9s %10llu %8u %8u %8u %8u\n", sStageNames[i],
+             (unsigned long long)stage.count, p50, p90, p99, stage.max);
+    }
+
+    DUMP("Total latency histogram since boot, us: count\n");
+    for (int b = 0; b < LOC_FIX_LATENCY_BUCKETS; b++) {
+        uint64_t n = sStages[STAGE_TOTAL].histogram[b];
+        if (n) {
+            DUMP("  <%u: %llu\n", 1u << b, (unsigned long long)n);
+        }
+    }
+
+    uint32_t ttffs = std::min<uint32_t>(sTtffCount, LOC_FIX_TTFF_WINDOW);
+    memcpy(values, sTtffMs, ttffs * sizeof(values[0]));
+    uint32_t last = sTtffCount ? sTtffMs[(sTtffCount - 1) % LOC_FIX_TTFF_WINDOW] : 0;
+    DUMP("TTFF (ms): sessions %u, last %u, p50 %u, max %u of the last %u\n",
+         sTtffCount, last, percentile(values, ttffs, 50),
+         ttffs ? *std::max_element(values, values + ttffs) : 0, ttffs);
+
+    pthread_mutex_unlock(&sMutex);
+#undef DUMP
+
+    return len;
+}
+
+} // namespace loc_core
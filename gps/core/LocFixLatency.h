@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2016, The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LOC_FIX_LATENCY_H
+#define LOC_FIX_LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace loc_core {
+
+// Tracks how long position reports take from the modem to the
+// framework, split in stages:
+//   report:   LocApiBase::reportPosition() until the engine message
+//             for it is queued
+//   queue:    queued until the engine thread starts on it
+//   callback: from there until location_cb returns
+//   total:    all of the above
+// plus the time to first fix of every session. Each stage keeps the
+// last LOC_FIX_LATENCY_WINDOW samples for percentiles and a log2
+// histogram since boot. All times are CLOCK_MONOTONIC.
+#define LOC_FIX_LATENCY_WINDOW 1024
+
+class LocFixLatency {
+public:
+    enum Stage {
+        STAGE_REPORT = 0,
+        STAGE_QUEUE,
+        STAGE_CALLBACK,
+        STAGE_TOTAL,
+        STAGE_COUNT
+    };
+
+    static int64_t now();
+
+    // LocApiBase::reportPosition() brackets the delivery to the
+    // adapters, so that reportStamp() tells the engine message,
+    // created on the same thread, when the report came in
+    static void beginReport(int64_t reportNs);
+    static void endReport();
+    // 0 if no report is being delivered on the calling thread
+    static int64_t reportStamp();
+
+    // a position went out through location_cb, reportNs may be 0 if
+    // it did not come straight from reportPosition()
+    static void record(int64_t reportNs, int64_t queuedNs,
+                       int64_t procNs, int64_t doneNs);
+    // a session was started, the next record() ends its TTFF
+    static void sessionStarted();
+
+    // human readable summary into buffer, returns its length
+    static size_t dump(char* buffer, size_t bufferSize);
+};
+
+} // namespace loc_core
+
+#endif //LOC_FIX_LATENCY_H
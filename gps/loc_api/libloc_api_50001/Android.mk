@@ -25,13 +25,14 @@ LOCAL_SRC_FILES += \
     loc_eng_ni.cpp \
     loc_eng_log.cpp \
     loc_eng_nmea.cpp \
+    loc_eng_nmea_ring.cpp \
     LocEngAdapter.cpp
 
 LOCAL_SRC_FILES += \
     loc_eng_dmn_conn.cpp \
     loc_eng_dmn_conn_handler.cpp \
-    loc_eng_dmn_conn_thread_helper.c \
     loc_eng_dmn_conn_glue_msg.c \
+    loc_eng_dmn_conn_glue_sock.c \
     loc_eng_dmn_conn_glue_pipe.c
 
 LOCAL_CFLAGS += \
@@ -57,7 +58,8 @@ LOCAL_COPY_HEADERS:= \
    loc_eng_ni.h \
    loc_eng_agps.h \
    loc_eng_msg.h \
-   loc_eng_log.h
+   loc_eng_log.h \
+   loc_eng_nmea_ring.h
 
 LOCAL_PRELINK_MODULE := false
 
@@ -65,6 +67,40 @@ include $(BUILD_SHARED_LIBRARY)
 
 include $(CLEAR_VARS)
 
+LOCAL_MODULE := loc_api_replay
+LOCAL_MODULE_OWNER := qcom
+
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils \
+    liblog \
+    libloc_eng \
+    libloc_core \
+    libgps.utils
+
+LOCAL_SRC_FILES += \
+    loc_api_replay.cpp
+
+LOCAL_CFLAGS += \
+    -fno-short-enums \
+    -D_ANDROID_
+
+ifeq ($(QCPATH),)
+LOCAL_CFLAGS += -DOSS_BUILD
+endif
+
+LOCAL_C_INCLUDES:= \
+    $(TARGET_OUT_HEADERS)/gps.utils \
+    $(TARGET_OUT_HEADERS)/libloc_core \
+    $(LOCAL_PATH) \
+    $(TARGET_OUT_HEADERS)/libflp
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
 LOCAL_MODULE := gps.$(TARGET_BOARD_PLATFORM)
 LOCAL_MODULE_OWNER := qcom
 
@@ -111,4 +147,6 @@ LOCAL_MODULE_RELATIVE_PATH := hw
 
 include $(BUILD_SHARED_LIBRARY)
 
+include $(LOCAL_PATH)/tests/Android.mk
+
 endif # not BUILD_TINY_ANDROID
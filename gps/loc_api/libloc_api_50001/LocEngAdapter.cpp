@@ -77,9 +77,12 @@ LocEngAdapter::LocEngAdapter(LOC_API_ADAPTER_EVENT_MASK_T mask,
     mSupportsAgpsRequests(false),
     mSupportsPositionInjection(false),
     mSupportsTimeInjection(false),
-    mPowerVote(0)
+    mPowerVote(0),
+    mGpsMeasurementNext(0),
+    mGpsMeasurementOverflows(0)
 {
     memset(&mFixCriteria, 0, sizeof(mFixCriteria));
+    mGpsMeasurementBusy[0] = mGpsMeasurementBusy[1] = 0;
     mFixCriteria.mode = LOC_POSITION_MODE_INVALID;
     LOC_LOGD("LocEngAdapter created");
 }
@@ -566,8 +569,31 @@ enum loc_api_adapter_err LocEngAdapter::setXtraVersionCheck(int check)
 
 void LocEngAdapter::reportGpsMeasurementData(GpsData &gpsMeasurementData)
 {
-    sendMsg(new LocEngReportGpsMeasurement(mOwner,
-                                           gpsMeasurementData));
+    GpsData* data;
+    volatile int* busy;
+
+    // take the buffer not used last time if it is free, else the other
+    unsigned int i = mGpsMeasurementNext;
+    bool claimed = __sync_bool_compare_and_swap(&mGpsMeasurementBusy[i], 0, 1);
+    if (!claimed) {
+        i ^= 1;
+        claimed = __sync_bool_compare_and_swap(&mGpsMeasurementBusy[i], 0, 1);
+    }
+    if (claimed) {
+        data = &mGpsMeasurementData[i];
+        busy = &mGpsMeasurementBusy[i];
+        mGpsMeasurementNext = i ^ 1;
+    } else {
+        // the engine thread is behind, queue a copy of our own
+        data = new GpsData;
+        busy = NULL;
+        mGpsMeasurementOverflows++;
+        LOC_LOGD("%s: both buffers in use, %u reports copied to the heap",
+                 __func__, mGpsMeasurementOverflows);
+    }
+
+    memcpy(data, &gpsMeasurementData, sizeof(GpsData));
+    sendMsg(new LocEngReportGpsMeasurement(mOwner, data, busy));
 }
 
 /*
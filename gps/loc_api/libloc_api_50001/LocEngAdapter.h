@@ -80,6 +80,14 @@ class LocEngAdapter : public LocAdapterBase {
     unsigned int mPowerVote;
     static const unsigned int POWER_VOTE_RIGHT = 0x20;
     static const unsigned int POWER_VOTE_VALUE = 0x10;
+    // measurement reports are copied into one of two preallocated
+    // buffers, the message only carries its pointer and the engine
+    // thread frees it again after the callback.  With both still in
+    // use, the report is copied to the heap as it used to be.
+    GpsData mGpsMeasurementData[2];
+    volatile int mGpsMeasurementBusy[2];
+    unsigned int mGpsMeasurementNext;
+    unsigned int mGpsMeasurementOverflows;
 
 public:
     bool mSupportsAgpsRequests;
@@ -43,6 +43,8 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <LocDualContext.h>
+#include <LocBackendLibs.h>
+#include <LocFixLatency.h>
 #include <cutils/properties.h>
 
 using namespace loc_core;
@@ -172,9 +174,47 @@ static const GnssConfigurationInterface sLocEngConfigInterface =
     loc_configuration_update
 };
 
+static size_t loc_get_internal_state(char* buffer, size_t bufferSize);
+
+static const GpsDebugInterface sLocEngDebugInterface =
+{
+    sizeof(GpsDebugInterface),
+    loc_get_internal_state
+};
+
 static loc_eng_data_s_type loc_afw_data;
 static int gss_fd = -1;
 static int sGnssType = GNSS_UNKNOWN;
+/*===========================================================================
+FUNCTION    loc_prefetch_backend_libs
+
+DESCRIPTION
+   Starts loading the vendor libraries loc_init() is going to need in the
+   background, while the framework is still busy with its own setup.
+
+DEPENDENCIES
+   gps.conf has been read
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_prefetch_backend_libs()
+{
+    uint32_t libs = LocBackendLibs::bit(LocBackendLibs::LBS_CORE);
+
+    if (TARGET_MPQ != loc_get_target()) {
+        libs |= LocBackendLibs::bit(LocBackendLibs::LOC_API_V02);
+    }
+    if ((gps_conf.CAPABILITIES | GPS_CAPABILITY_GEOFENCING) == gps_conf.CAPABILITIES) {
+        libs |= LocBackendLibs::bit(LocBackendLibs::GEOFENCE);
+    }
+    LocBackendLibs::prefetch(libs);
+}
+
 /*===========================================================================
 FUNCTION    gps_get_hardware_interface
 
@@ -208,6 +248,7 @@ const GpsInterface* gps_get_hardware_interface ()
         LOC_LOGD("gps_get_interface returning NULL because gps.disable=1\n");
         ret_val = NULL;
     } else {
+        loc_prefetch_backend_libs();
         ret_val = &sLocEngInterface;
     }
 
@@ -252,6 +293,7 @@ extern "C" const GpsInterface* get_gps_interface()
         LOC_LOGD("qca1530 present: CAPABILITIES %0lx\n", gps_conf.CAPABILITIES);
         break;
     }
+    loc_prefetch_backend_libs();
     return &sLocEngInterface;
 }
 
@@ -275,6 +317,7 @@ SIDE EFFECTS
 static int loc_init(GpsCallbacks* callbacks)
 {
     int retVal = -1;
+    int64_t startMs = elapsedMillisSinceBoot();
     ENTRY_LOG();
     LOC_API_ADAPTER_EVENT_MASK_T event;
 
@@ -325,7 +368,8 @@ static int loc_init(GpsCallbacks* callbacks)
     loc_afw_data.adapter->setPowerVoteRight(loc_get_target() == TARGET_QCA1530);
     loc_afw_data.adapter->setPowerVote(true);
 
-    LOC_LOGD("loc_eng_init() success!");
+    LOC_LOGD("loc_eng_init() success in %lld ms!",
+             (long long)(elapsedMillisSinceBoot() - startMs));
 
 err:
     EXIT_LOG(%d, retVal);
@@ -546,33 +590,23 @@ static void loc_delete_aiding_data(GpsAidingData f)
 const GpsGeofencingInterface* get_geofence_interface(void)
 {
     ENTRY_LOG();
-    void *handle;
-    const char *error;
     typedef const GpsGeofencingInterface* (*get_gps_geofence_interface_function) (void);
     get_gps_geofence_interface_function get_gps_geofence_interface;
     static const GpsGeofencingInterface* geofence_interface = NULL;
 
-    dlerror();    /* Clear any existing error */
-
-    handle = dlopen ("libgeofence.so", RTLD_NOW);
-
-    if (!handle)
-    {
-        if ((error = dlerror()) != NULL)  {
-            LOC_LOGE ("%s, dlopen for libgeofence.so failed, error = %s\n", __func__, error);
-           }
-        goto exit;
+    // libgeofence.so is opened and resolved once per process, and
+    // usually prefetched already
+    if (NULL == geofence_interface) {
+        get_gps_geofence_interface = (get_gps_geofence_interface_function)
+            LocBackendLibs::getEntry(LocBackendLibs::GEOFENCE);
+        if (NULL == get_gps_geofence_interface) {
+            LOC_LOGE ("%s, libgeofence.so or its gps_geofence_get_interface"
+                      " is not available\n", __func__);
+        } else {
+            geofence_interface = get_gps_geofence_interface();
+        }
     }
-    dlerror();    /* Clear any existing error */
-    get_gps_geofence_interface = (get_gps_geofence_interface_function)dlsym(handle, "gps_geofence_get_interface");
-    if ((error = dlerror()) != NULL || NULL == get_gps_geofence_interface)  {
-        LOC_LOGE ("%s, dlsym for get_gps_geofence_interface failed, error = %s\n", __func__, error);
-        goto exit;
-     }
 
-    geofence_interface = get_gps_geofence_interface();
-
-exit:
     EXIT_LOG(%d, geofence_interface == NULL);
     return geofence_interface;
 }
@@ -637,6 +671,10 @@ const void* loc_get_extension(const char* name)
    {
        ret_val = &sLocEngGpsMeasurementInterface;
    }
+   else if (strcmp(name, GPS_DEBUG_INTERFACE) == 0)
+   {
+       ret_val = &sLocEngDebugInterface;
+   }
    else
    {
       LOC_LOGE ("get_extension: Invalid interface passed in\n");
@@ -1036,6 +1074,40 @@ static int loc_agps_revoke_certificates(const Sha1CertificateFingerprint* finger
     return ret_val;
 }
 
+/*===========================================================================
+FUNCTION    loc_get_internal_state
+
+DESCRIPTION
+   Fills buffer with the fix delivery latency and TTFF statistics, and
+   the AGPS data connection linger statistics, for the framework to show
+   in its dumpsys.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Number of characters written
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static size_t loc_get_internal_state(char* buffer, size_t bufferSize)
+{
+    ENTRY_LOG();
+    size_t ret_val = LocFixLatency::dump(buffer, bufferSize);
+    if (NULL != loc_afw_data.agnss_nif) {
+        ret_val += loc_afw_data.agnss_nif->dumpLingerStats(
+            buffer + ret_val, bufferSize - ret_val);
+    }
+    if (NULL != loc_afw_data.internet_nif) {
+        ret_val += loc_afw_data.internet_nif->dumpLingerStats(
+            buffer + ret_val, bufferSize - ret_val);
+    }
+    EXIT_LOG(%zu, ret_val);
+    return ret_val;
+}
+
 static void loc_configuration_update(const char* config_data, int32_t length)
 {
     ENTRY_LOG();
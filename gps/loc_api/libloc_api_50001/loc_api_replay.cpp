@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2016, The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Replays a LocApi trace recorded with LOC_API_TRACE_FILE, or runs the
+ * synthetic receiver, through the regular loc_eng stack in place of the
+ * modem, and reports how many callbacks came out the other end and how
+ * long it took.
+ *
+ *   loc_api_replay <trace> [speed]
+ *   loc_api_replay -s <rate Hz> <seconds> [SVs]
+ *
+ * The synthetic receiver also reports GNSS measurements, whose delivery
+ * latency is printed at the end.
+ *
+ * speed 1 replays in real time (default), N replays N times faster and
+ * 0 replays as fast as possible.
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_api_replay"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <loc_eng.h>
+#include <LocApiTrace.h>
+#include <LocApiSynthetic.h>
+
+using namespace loc_core;
+
+static loc_eng_data_s_type sLocEngData;
+static volatile uint32_t sLocations;
+static volatile uint32_t sSvStatus;
+static volatile uint32_t sStatus;
+static volatile uint32_t sNmea;
+
+static void replay_location_cb(UlpLocation* location, void* locExt)
+{
+    __sync_fetch_and_add(&sLocations, 1);
+}
+
+static void replay_sv_status_cb(GpsSvStatus* sv_status, void* svExt)
+{
+    __sync_fetch_and_add(&sSvStatus, 1);
+}
+
+static void replay_status_cb(GpsStatus* status)
+{
+    __sync_fetch_and_add(&sStatus, 1);
+}
+
+static void replay_nmea_cb(GpsUtcTime timestamp, const char* nmea, int length)
+{
+    __sync_fetch_and_add(&sNmea, 1);
+}
+
+static volatile uint32_t sMeasurements;
+static int64_t sMeasurementLatencyNs;
+static int64_t sMeasurementLatencyMaxNs;
+
+// synthetic measurements carry CLOCK_MONOTONIC as their clock
+static void replay_measurement_cb(GpsData* data)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t latency = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec -
+                      data->clock.time_ns;
+
+    // all callbacks come from the engine thread
+    sMeasurements++;
+    sMeasurementLatencyNs += latency;
+    if (latency > sMeasurementLatencyMaxNs) {
+        sMeasurementLatencyMaxNs = latency;
+    }
+}
+
+static void replay_wakelock_cb()
+{
+}
+
+static bool sDrained;
+static pthread_mutex_t sDrainMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sDrainCond = PTHREAD_COND_INITIALIZER;
+
+// Goes through the engine queue hops + 1 times. Whatever the messages
+// ahead of it post while they are processed, such as the status reports
+// of a stopping backend, ends up ahead of the next hop.
+struct ReplayDrainMsg : public LocMsg {
+    LocEngAdapter* mAdapter;
+    int mHops;
+    inline ReplayDrainMsg(LocEngAdapter* adapter, int hops) :
+        LocMsg(), mAdapter(adapter), mHops(hops) {}
+    virtual void proc() const {
+        if (mHops > 0) {
+            mAdapter->sendMsg(new ReplayDrainMsg(mAdapter, mHops - 1));
+        } else {
+            pthread_mutex_lock(&sDrainMutex);
+            sDrained = true;
+            pthread_cond_signal(&sDrainCond);
+            pthread_mutex_unlock(&sDrainMutex);
+        }
+    }
+};
+
+static void replay_drain(LocEngAdapter* adapter)
+{
+    adapter->sendMsg(new ReplayDrainMsg(adapter, 1));
+    pthread_mutex_lock(&sDrainMutex);
+    while (!sDrained) {
+        pthread_cond_wait(&sDrainCond, &sDrainMutex);
+    }
+    pthread_mutex_unlock(&sDrainMutex);
+}
+
+static int64_t replay_now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int main(int argc, char** argv)
+{
+    bool synthetic = argc > 1 && !strcmp(argv[1], "-s");
+    if (argc < 2 || (synthetic && argc < 4)) {
+        fprintf(stderr, "usage: %s <trace> [speed]\n"
+                        "       %s -s <rate Hz> <seconds> [SVs]\n",
+                argv[0], argv[0]);
+        return 1;
+    }
+    float speed = argc > 2 ? atof(argv[2]) : 1.0f;
+
+    LocCallbacks callbacks = {replay_location_cb, /* location_cb */
+                              replay_status_cb, /* status_cb */
+                              replay_sv_status_cb, /* sv_status_cb */
+                              replay_nmea_cb, /* nmea_cb */
+                              NULL, /* set_capabilities_cb */
+                              replay_wakelock_cb, /* acquire_wakelock_cb */
+                              replay_wakelock_cb, /* release_wakelock_cb */
+                              NULL, /* create_thread_cb */
+                              NULL, /* location_ext_parser */
+                              NULL, /* sv_ext_parser */
+                              NULL, /* request_utc_time_cb */
+                              };
+
+    loc_eng_read_config();
+    // the backend must be selected before loc_eng_init() creates the context
+    if (synthetic) {
+        LocApiSyntheticConfig config;
+        memset(&config, 0, sizeof(config));
+        config.rateHz = atoi(argv[2]);
+        config.numSvs = argc > 4 ? atoi(argv[4]) : 12;
+        LocApiSynthetic::select(config);
+    } else {
+        LocApiTracePlayer::select(argv[1], speed);
+    }
+
+    if (loc_eng_init(sLocEngData, &callbacks,
+                     LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT |
+                     LOC_API_ADAPTER_BIT_SATELLITE_REPORT |
+                     LOC_API_ADAPTER_BIT_LOCATION_SERVER_REQUEST |
+                     LOC_API_ADAPTER_BIT_ASSISTANCE_DATA_REQUEST |
+                     LOC_API_ADAPTER_BIT_STATUS_REPORT |
+                     LOC_API_ADAPTER_BIT_NMEA_1HZ_REPORT,
+                     NULL)) {
+        fprintf(stderr, "loc_eng_init failed\n");
+        return 1;
+    }
+
+    GpsMeasurementCallbacks measurementCallbacks = {sizeof(GpsMeasurementCallbacks),
+                                                    replay_measurement_cb};
+    if (synthetic) {
+        loc_eng_gps_measurement_init(sLocEngData, &measurementCallbacks);
+    }
+
+    int64_t start = replay_now_ms();
+    loc_eng_start(sLocEngData);
+    if (synthetic) {
+        sleep(atoi(argv[3]));
+    } else {
+        LocApiTracePlayer::waitForEnd();
+    }
+    int64_t elapsed = replay_now_ms() - start;
+
+    // let the engine message queue drain before counting
+    loc_eng_stop(sLocEngData);
+    replay_drain(sLocEngData.adapter);
+
+    if (synthetic) {
+        printf("ran the synthetic receiver at %s Hz for %lld ms\n",
+               argv[2], (long long)elapsed);
+    } else {
+        printf("replayed %s at speed %g in %lld ms\n",
+               argv[1], speed, (long long)elapsed);
+    }
+    printf("locations %u, sv status %u, status %u, nmea %u\n",
+           sLocations, sSvStatus, sStatus, sNmea);
+    if (sMeasurements) {
+        printf("measurements %u, latency avg %lld us, max %lld us\n",
+               sMeasurements,
+               (long long)(sMeasurementLatencyNs / sMeasurements / 1000),
+               (long long)(sMeasurementLatencyMaxNs / 1000));
+    }
+
+    loc_eng_cleanup(sLocEngData);
+    return 0;
+}
@@ -46,6 +46,9 @@
 #include <time.h>
 #include <new>
 #include <LocEngAdapter.h>
+#include <LocApiTrace.h>
+#include <LocApiSynthetic.h>
+#include <LocFixLatency.h>
 
 #include <cutils/sched_policy.h>
 #ifndef USE_GLIB
@@ -101,15 +104,26 @@ static const loc_param_s_type gps_conf_table[] =
   {"LPP_PROFILE",                    &gps_conf.LPP_PROFILE,                    NULL, 'n'},
   {"A_GLONASS_POS_PROTOCOL_SELECT",  &gps_conf.A_GLONASS_POS_PROTOCOL_SELECT,  NULL, 'n'},
   {"AGPS_CERT_WRITABLE_MASK",        &gps_conf.AGPS_CERT_WRITABLE_MASK,        NULL, 'n'},
+  {"AGPS_LINGER_TIME",               &gps_conf.AGPS_LINGER_TIME,               NULL, 'n'},
   {"SUPL_MODE",                      &gps_conf.SUPL_MODE,                      NULL, 'n'},
   {"INTERMEDIATE_POS",               &gps_conf.INTERMEDIATE_POS,               NULL, 'n'},
   {"ACCURACY_THRES",                 &gps_conf.ACCURACY_THRES,                 NULL, 'n'},
   {"NMEA_PROVIDER",                  &gps_conf.NMEA_PROVIDER,                  NULL, 'n'},
+  {"NMEA_RING_SIZE",                 &gps_conf.NMEA_RING_SIZE,                 NULL, 'n'},
+  {"LOC_API_TRACE_FILE",             &gps_conf.LOC_API_TRACE_FILE,             NULL, 's'},
+  {"SYNTHETIC_LOC_API_RATE",         &gps_conf.SYNTHETIC_LOC_API_RATE,         NULL, 'n'},
+  {"SYNTHETIC_LOC_API_NUM_SVS",      &gps_conf.SYNTHETIC_LOC_API_NUM_SVS,      NULL, 'n'},
+  {"SYNTHETIC_LOC_API_ATL_INTERVAL", &gps_conf.SYNTHETIC_LOC_API_ATL_INTERVAL, NULL, 'n'},
+  {"SYNTHETIC_LOC_API_XTRA_INTERVAL", &gps_conf.SYNTHETIC_LOC_API_XTRA_INTERVAL, NULL, 'n'},
+  {"SYNTHETIC_LOC_API_FAILURE_PERCENT", &gps_conf.SYNTHETIC_LOC_API_FAILURE_PERCENT, NULL, 'n'},
   {"CAPABILITIES",                   &gps_conf.CAPABILITIES,                   NULL, 'n'},
   {"XTRA_VERSION_CHECK",             &gps_conf.XTRA_VERSION_CHECK,             NULL, 'n'},
   {"XTRA_SERVER_1",                  &gps_conf.XTRA_SERVER_1,                  NULL, 's'},
   {"XTRA_SERVER_2",                  &gps_conf.XTRA_SERVER_2,                  NULL, 's'},
   {"XTRA_SERVER_3",                  &gps_conf.XTRA_SERVER_3,                  NULL, 's'},
+  {"XTRA_CACHE_FILE",                &gps_conf.XTRA_CACHE_FILE,                NULL, 's'},
+  {"XTRA_CACHE_VALIDITY",            &gps_conf.XTRA_CACHE_VALIDITY,            NULL, 'n'},
+  {"XTRA_PREFETCH_MARGIN",           &gps_conf.XTRA_PREFETCH_MARGIN,           NULL, 'n'},
   {"USE_EMERGENCY_PDN_FOR_EMERGENCY_SUPL",  &gps_conf.USE_EMERGENCY_PDN_FOR_EMERGENCY_SUPL,          NULL, 'n'},
 };
 
@@ -140,6 +154,11 @@ static void loc_default_parameters(void)
    gps_conf.INTERMEDIATE_POS = 0;
    gps_conf.ACCURACY_THRES = 0;
    gps_conf.NMEA_PROVIDER = 0;
+   /*NMEA shared memory ring is disabled by default*/
+   gps_conf.NMEA_RING_SIZE = 0;
+   /*Synthetic LocApi is disabled by default*/
+   gps_conf.SYNTHETIC_LOC_API_RATE = 0;
+   gps_conf.SYNTHETIC_LOC_API_NUM_SVS = 12;
    gps_conf.GPS_LOCK = 0;
    gps_conf.SUPL_VER = 0x10000;
    gps_conf.SUPL_MODE = 0x3;
@@ -150,8 +169,14 @@ static void loc_default_parameters(void)
    gps_conf.A_GLONASS_POS_PROTOCOL_SELECT = 0;
    /*XTRA version check is disabled by default*/
    gps_conf.XTRA_VERSION_CHECK=0;
+   /*XTRA cache is disabled by default*/
+   gps_conf.XTRA_CACHE_FILE[0] = '\0';
+   gps_conf.XTRA_CACHE_VALIDITY = 72;
+   gps_conf.XTRA_PREFETCH_MARGIN = 12;
    /*Use emergency PDN by default*/
    gps_conf.USE_EMERGENCY_PDN_FOR_EMERGENCY_SUPL = 1;
+   /*Data connections are released as soon as AGPS is done by default*/
+   gps_conf.AGPS_LINGER_TIME = 0;
 
    /*Defaults for sap.conf*/
    sap_conf.GYRO_BIAS_RANDOM_WALK = 0;
@@ -267,6 +292,10 @@ LocEngStartFix::LocEngStartFix(LocEngAdapter* adapter) :
 inline void LocEngStartFix::proc() const
 {
     loc_eng_data_s_type* locEng = (loc_eng_data_s_type*)mAdapter->getOwner();
+    // isInSession() is only stable here on the engine thread
+    if (!mAdapter->isInSession()) {
+        LocFixLatency::sessionStarted();
+    }
     loc_eng_start_handler(*locEng);
 }
 inline void LocEngStartFix::locallog() const
@@ -734,13 +763,16 @@ LocEngReportPosition::LocEngReportPosition(LocAdapterBase* adapter,
     mLocationExt(((loc_eng_data_s_type*)
                   ((LocEngAdapter*)
                    (mAdapter))->getOwner())->location_ext_parser(locExt)),
-    mStatus(st), mTechMask(technology)
+    mStatus(st), mTechMask(technology),
+    mReportNs(LocFixLatency::reportStamp()),
+    mQueuedNs(LocFixLatency::now())
 {
     locallog();
 }
 void LocEngReportPosition::proc() const {
     LocEngAdapter* adapter = (LocEngAdapter*)mAdapter;
     loc_eng_data_s_type* locEng = (loc_eng_data_s_type*)adapter->getOwner();
+    int64_t procNs = LocFixLatency::now();
 
     if (locEng->mute_session_state != LOC_MUTE_SESS_IN_SESSION) {
         bool reported = false;
@@ -774,6 +806,8 @@ void LocEngReportPosition::proc() const {
                 locEng->location_cb((UlpLocation*)&(mLocation),
                                     (void*)mLocationExt);
                 reported = true;
+                LocFixLatency::record(mReportNs, mQueuedNs, procNs,
+                                      LocFixLatency::now());
             }
         }
 
@@ -906,6 +940,7 @@ void LocEngReportNmea::proc() const {
 
     if (locEng->nmea_cb != NULL)
         locEng->nmea_cb(now, mNmea, mLen);
+    loc_eng_nmea_ring_publish(locEng->nmea_ring, now, mNmea, mLen);
 }
 inline void LocEngReportNmea::locallog() const {
     LOC_LOGV("LocEngReportNmea");
@@ -1247,15 +1282,7 @@ LocEngRequestXtra::LocEngRequestXtra(void* locEng) :
 }
 void LocEngRequestXtra::proc() const
 {
-    loc_eng_xtra_data_s_type* locEngXtra =
-        &(((loc_eng_data_s_type*)mLocEng)->xtra_module_data);
-
-    if (locEngXtra->download_request_cb != NULL) {
-        CALLBACK_LOG_CALLFLOW("download_request_cb", %p, mLocEng);
-        locEngXtra->download_request_cb();
-    } else {
-        LOC_LOGE("Callback function for request xtra is NULL");
-    }
+    loc_eng_xtra_handle_request(*(loc_eng_data_s_type*)mLocEng);
 }
 inline void LocEngRequestXtra::locallog() const {
     LOC_LOGV("LocEngReqXtra");
@@ -1625,26 +1652,38 @@ struct LocEngGnssConstellationConfig : public LocMsg {
 
 //        case LOC_ENG_MSG_REPORT_GNSS_MEASUREMENT:
 LocEngReportGpsMeasurement::LocEngReportGpsMeasurement(void* locEng,
-                                                       GpsData &gpsData) :
-    LocMsg(), mLocEng(locEng), mGpsData(gpsData)
+                                                       GpsData* gpsData,
+                                                       volatile int* busy) :
+    LocMsg(), mLocEng(locEng), mGpsData(gpsData), mBusy(busy)
 {
     locallog();
 }
+LocEngReportGpsMeasurement::~LocEngReportGpsMeasurement()
+{
+    if (NULL == mBusy) {
+        delete mGpsData;
+    }
+}
 void LocEngReportGpsMeasurement::proc() const {
     loc_eng_data_s_type* locEng = (loc_eng_data_s_type*) mLocEng;
     if (locEng->mute_session_state != LOC_MUTE_SESS_IN_SESSION)
     {
         if (locEng->gps_measurement_cb != NULL) {
-            locEng->gps_measurement_cb((GpsData*)&(mGpsData));
+            locEng->gps_measurement_cb(mGpsData);
         }
     }
+    // the framework copies the data in the callback, the buffer
+    // can take the next report now
+    if (NULL != mBusy) {
+        __sync_lock_release(mBusy);
+    }
 }
 void LocEngReportGpsMeasurement::locallog() const {
     IF_LOC_LOGV {
         LOC_LOGV("%s:%d]: Received in GPS HAL."
                  "GNSS Measurements count: %d \n",
-                 __func__, __LINE__, mGpsData.measurement_count);
-        for (int i =0; i< mGpsData.measurement_count && i < GPS_MAX_SVS; i++) {
+                 __func__, __LINE__, mGpsData->measurement_count);
+        for (int i =0; i< mGpsData->measurement_count && i < GPS_MAX_SVS; i++) {
                 LOC_LOGV(" GNSS measurement data in GPS HAL: \n"
                          " GPS_HAL => Measurement ID | prn | time_offset_ns | state |"
                          " received_gps_tow_ns| c_n0_dbhz | pseudorange_rate_mps |"
@@ -1652,19 +1691,19 @@ void LocEngReportGpsMeasurement::locallog() const {
                          " accumulated_delta_range_state | flags \n"
                          " GPS_HAL => %d | %d | %f | %d | %lld | %f | %f | %f | %d | %d \n",
                          i,
-                         mGpsData.measurements[i].prn,
-                         mGpsData.measurements[i].time_offset_ns,
-                         mGpsData.measurements[i].state,
-                         mGpsData.measurements[i].received_gps_tow_ns,
-                         mGpsData.measurements[i].c_n0_dbhz,
-                         mGpsData.measurements[i].pseudorange_rate_mps,
-                         mGpsData.measurements[i].pseudorange_rate_uncertainty_mps,
-                         mGpsData.measurements[i].accumulated_delta_range_state,
-                         mGpsData.measurements[i].flags);
+                         mGpsData->measurements[i].prn,
+                         mGpsData->measurements[i].time_offset_ns,
+                         mGpsData->measurements[i].state,
+                         mGpsData->measurements[i].received_gps_tow_ns,
+                         mGpsData->measurements[i].c_n0_dbhz,
+                         mGpsData->measurements[i].pseudorange_rate_mps,
+                         mGpsData->measurements[i].pseudorange_rate_uncertainty_mps,
+                         mGpsData->measurements[i].accumulated_delta_range_state,
+                         mGpsData->measurements[i].flags);
         }
         LOC_LOGV(" GPS_HAL => Clocks Info: type | time_ns \n"
-                 " GPS_HAL => Clocks Info: %d | %lld", mGpsData.clock.type,
-                 mGpsData.clock.time_ns);
+                 " GPS_HAL => Clocks Info: %d | %lld", mGpsData->clock.type,
+                 mGpsData->clock.time_ns);
     }
 }
 inline void LocEngReportGpsMeasurement::log() const {
@@ -1752,6 +1791,24 @@ int loc_eng_init(loc_eng_data_s_type &loc_eng_data, LocCallbacks* callbacks,
     loc_eng_data.sv_ext_parser = callbacks->sv_ext_parser ?
         callbacks->sv_ext_parser : noProc;
     loc_eng_data.intermediateFix = gps_conf.INTERMEDIATE_POS;
+    if (gps_conf.NMEA_RING_SIZE) {
+        loc_eng_data.nmea_ring = loc_eng_nmea_ring_create(gps_conf.NMEA_RING_SIZE);
+    }
+    if (gps_conf.SYNTHETIC_LOC_API_RATE) {
+        // must be selected before the adapter below creates the context
+        LocApiSyntheticConfig synthetic = {gps_conf.SYNTHETIC_LOC_API_RATE,
+                                           gps_conf.SYNTHETIC_LOC_API_NUM_SVS,
+                                           gps_conf.SYNTHETIC_LOC_API_ATL_INTERVAL,
+                                           gps_conf.SYNTHETIC_LOC_API_XTRA_INTERVAL,
+                                           gps_conf.SYNTHETIC_LOC_API_FAILURE_PERCENT};
+        LocApiSynthetic::select(synthetic);
+    }
+    // only record the modem, replaying the configured trace would
+    // otherwise truncate it and record the replay in its place
+    if (gps_conf.LOC_API_TRACE_FILE[0] != '\0' &&
+        !LocApiTracePlayer::isSelected() && !LocApiSynthetic::isSelected()) {
+        LocApiTraceRecorder::start(gps_conf.LOC_API_TRACE_FILE);
+    }
     // initial states taken care of by the memset above
     // loc_eng_data.engine_status -- GPS_STATUS_NONE;
     // loc_eng_data.fix_session_status -- GPS_STATUS_NONE;
@@ -2301,6 +2358,7 @@ void loc_eng_agps_init(loc_eng_data_s_type &loc_eng_data, AGpsExtCallbacks* call
                                                      (void *)loc_eng_data.agps_status_cb,
                                                      AGPS_TYPE_WWAN_ANY,
                                                      false);
+    loc_eng_data.internet_nif->setLinger(gps_conf.AGPS_LINGER_TIME, adapter);
     loc_eng_data.wifi_nif = new AgpsStateMachine(servicerTypeAgps,
                                                  (void *)loc_eng_data.agps_status_cb,
                                                  AGPS_TYPE_WIFI,
@@ -2312,13 +2370,15 @@ void loc_eng_agps_init(loc_eng_data_s_type &loc_eng_data, AGpsExtCallbacks* call
                                                       (void *)loc_eng_data.agps_status_cb,
                                                       AGPS_TYPE_SUPL,
                                                       false);
+        loc_eng_data.agnss_nif->setLinger(gps_conf.AGPS_LINGER_TIME, adapter);
 
         if (adapter->mSupportsAgpsRequests) {
             if(gps_conf.USE_EMERGENCY_PDN_FOR_EMERGENCY_SUPL) {
                 loc_eng_data.adapter->sendMsg(new LocEngDataClientInit(&loc_eng_data));
             }
-            loc_eng_dmn_conn_loc_api_server_launch(callbacks->create_thread_cb,
-                                                   NULL, NULL, &loc_eng_data);
+            loc_eng_dmn_conn_loc_api_server_launch(
+                (LocThread::tCreate)callbacks->create_thread_cb,
+                NULL, NULL, &loc_eng_data);
         }
         loc_eng_agps_reinit(loc_eng_data);
     }
@@ -2396,6 +2456,8 @@ int loc_eng_agps_open(loc_eng_data_s_type &loc_eng_data, AGpsExtType agpsType,
 
     loc_eng_data.adapter->sendMsg(
         new LocEngAtlOpenSuccess(sm, apn, apn_len, bearerType));
+    // a good time for a due XTRA prefetch
+    loc_eng_xtra_data_conn_up(loc_eng_data);
 
     EXIT_LOG(%d, 0);
     return 0;
@@ -2841,6 +2903,7 @@ void loc_eng_handle_engine_up(loc_eng_data_s_type &loc_eng_data)
 {
     ENTRY_LOG();
     loc_eng_reinit(loc_eng_data);
+    loc_eng_xtra_handle_engine_up(loc_eng_data);
 
     loc_eng_data.adapter->requestPowerVote();
 
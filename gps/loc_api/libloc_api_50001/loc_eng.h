@@ -56,6 +56,7 @@ typedef unsigned char boolean;
 #include <loc_log.h>
 #include <log_util.h>
 #include <loc_eng_agps.h>
+#include <loc_eng_nmea_ring.h>
 #include <LocEngAdapter.h>
 
 // The data connection minimal open time
@@ -120,9 +121,13 @@ typedef struct loc_eng_data_s
     // For nmea generation
     boolean generateNmea;
     uint32_t sv_used_mask;
+    uint32_t glo_used_mask;
+    uint64_t bds_used_mask;
     float hdop;
     float pdop;
     float vdop;
+    // shared memory fan-out of the NMEA sentences, NULL if disabled
+    loc_eng_nmea_ring_s_type* nmea_ring;
 
     // Address buffers, for addressing setting before init
     int    supl_host_set;
@@ -160,6 +165,17 @@ typedef struct loc_gps_cfg_s
     uint32_t       GPS_LOCK;
     uint32_t       A_GLONASS_POS_PROTOCOL_SELECT;
     uint32_t       AGPS_CERT_WRITABLE_MASK;
+    uint32_t       NMEA_RING_SIZE;
+    char        LOC_API_TRACE_FILE[LOC_MAX_PARAM_STRING];
+    uint32_t       SYNTHETIC_LOC_API_RATE;
+    uint32_t       SYNTHETIC_LOC_API_NUM_SVS;
+    uint32_t       SYNTHETIC_LOC_API_ATL_INTERVAL;
+    uint32_t       SYNTHETIC_LOC_API_XTRA_INTERVAL;
+    uint32_t       SYNTHETIC_LOC_API_FAILURE_PERCENT;
+    uint32_t       AGPS_LINGER_TIME;
+    char        XTRA_CACHE_FILE[LOC_MAX_PARAM_STRING];
+    uint32_t       XTRA_CACHE_VALIDITY;
+    uint32_t       XTRA_PREFETCH_MARGIN;
 } loc_gps_cfg_s_type;
 
 /* NOTE: the implementaiton of the parser casts number
@@ -244,7 +260,15 @@ int  loc_eng_xtra_init (loc_eng_data_s_type &loc_eng_data,
                        GpsXtraExtCallbacks* callbacks);
 int  loc_eng_xtra_inject_data(loc_eng_data_s_type &loc_eng_data,
                              char* data, int length);
+int  loc_eng_xtra_inject_data_owned(loc_eng_data_s_type &loc_eng_data,
+                                   char* data, int length);
+int  loc_eng_xtra_inject_fd(loc_eng_data_s_type &loc_eng_data, int fd);
+int  loc_eng_xtra_inject_file(loc_eng_data_s_type &loc_eng_data,
+                             const char* path);
 int  loc_eng_xtra_request_server(loc_eng_data_s_type &loc_eng_data);
+void loc_eng_xtra_handle_request(loc_eng_data_s_type &loc_eng_data);
+void loc_eng_xtra_handle_engine_up(loc_eng_data_s_type &loc_eng_data);
+void loc_eng_xtra_data_conn_up(loc_eng_data_s_type &loc_eng_data);
 void loc_eng_xtra_version_check(loc_eng_data_s_type &loc_eng_data, int check);
 
 //loc_eng_ni functions
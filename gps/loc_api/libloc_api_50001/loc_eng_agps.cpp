@@ -36,36 +36,18 @@
 #include <platform_lib_includes.h>
 #include <loc_eng_dmn_conn_handler.h>
 #include <loc_eng_dmn_conn.h>
+#include <LocTimer.h>
 #include <sys/time.h>
 
 //======================================================================
 // C callbacks
 //======================================================================
 
-// This is given to linked_list_add as the dealloc callback
-// data -- an instance of Subscriber
-static void deleteObj(void* data)
-{
-    delete (Subscriber*)data;
-}
-
-// This is given to linked_list_search() as the comparison callback
-// when the state manchine needs to process for particular subscriber
-// fromCaller -- caller provides this obj
-// fromList -- linked_list_search() function take this one from list
-static bool hasSubscriber(void* fromCaller, void* fromList)
-{
-    Notification* notification = (Notification*)fromCaller;
-    Subscriber* s1 = (Subscriber*)fromList;
-
-    return s1->forMe(*notification);
-}
-
-// This is gvien to linked_list_search() to notify subscriber objs
-// when the state machine needs to inform all subscribers of resource
-// status changes, e.g. when resource is GRANTED.
+// This is used when the state machine needs to inform a subscriber
+// of resource status changes, e.g. when resource is GRANTED.
 // fromCaller -- caller provides this ptr to a Notification obj.
-// fromList -- linked_list_search() function take this one from list
+// fromList -- the subscriber to notify
+// returns true if the subscriber should be deleted from the list
 static bool notifySubscriber(void* fromCaller, void* fromList)
 {
     Notification* notification = (Notification*)fromCaller;
@@ -342,7 +324,7 @@ AgpsState* AgpsPendingState::onRsrcEvent(AgpsRsrcStatus event, void* data)
     {
         Subscriber* subscriber = (Subscriber*) data;
         if (subscriber->waitForCloseComplete()) {
-            subscriber->setInactive();
+            mStateMachine->deactivateSubscriber(subscriber);
         } else {
             // auto notify this subscriber of the unsubscribe
             Notification notification(subscriber, event, true);
@@ -441,7 +423,7 @@ AgpsState* AgpsAcquiredState::onRsrcEvent(AgpsRsrcStatus event, void* data)
     {
         Subscriber* subscriber = (Subscriber*) data;
         if (subscriber->waitForCloseComplete()) {
-            subscriber->setInactive();
+            mStateMachine->deactivateSubscriber(subscriber);
         } else {
             // auto notify this subscriber of the unsubscribe
             Notification notification(subscriber, event, true);
@@ -450,11 +432,17 @@ AgpsState* AgpsAcquiredState::onRsrcEvent(AgpsRsrcStatus event, void* data)
 
         // now check if there is any subscribers left
         if (!mStateMachine->hasSubscribers()) {
-            // no more subscribers, move to RELEASED state
-            nextState = mReleasedState;
-
-            // tell connecivity service we can release NIF
-            mStateMachine->sendRsrcRequest(GPS_RELEASE_AGPS_DATA_CONN);
+            if (mStateMachine->startLinger()) {
+                // keep NIF up a while in RELEASING state, in case
+                // another session comes along
+                nextState = mReleasingState;
+            } else {
+                // no more subscribers, move to RELEASED state
+                nextState = mReleasedState;
+
+                // tell connecivity service we can release NIF
+                mStateMachine->sendRsrcRequest(GPS_RELEASE_AGPS_DATA_CONN);
+            }
         } else if (!mStateMachine->hasActiveSubscribers()) {
             // only inactive subscribers, move to RELEASING state
             nextState = mReleasingState;
@@ -520,11 +508,21 @@ AgpsState* AgpsReleasingState::onRsrcEvent(AgpsRsrcStatus event, void* data)
     {
     case RSRC_SUBSCRIBE:
     {
-        // already requested for NIF resource,
-        // do nothing until we get RSRC_GRANTED indication
-        // but we need to add subscriber to the list
-        mStateMachine->addSubscriber((Subscriber*)data);
-        // no state change.
+        Subscriber* subscriber = (Subscriber*) data;
+        if (mStateMachine->isLingering()) {
+            // NIF is still up, grant it right away
+            mStateMachine->stopLinger(true);
+            Notification notification(subscriber, RSRC_GRANTED, false);
+            subscriber->notifyRsrcStatus(notification);
+            mStateMachine->addSubscriber(subscriber);
+            nextState = mAcquiredState;
+        } else {
+            // already requested for NIF resource,
+            // do nothing until we get RSRC_GRANTED indication
+            // but we need to add subscriber to the list
+            mStateMachine->addSubscriber(subscriber);
+            // no state change.
+        }
     }
         break;
 
@@ -532,7 +530,7 @@ AgpsState* AgpsReleasingState::onRsrcEvent(AgpsRsrcStatus event, void* data)
     {
         Subscriber* subscriber = (Subscriber*) data;
         if (subscriber->waitForCloseComplete()) {
-            subscriber->setInactive();
+            mStateMachine->deactivateSubscriber(subscriber);
         } else {
             // auto notify this subscriber of the unsubscribe
             Notification notification(subscriber, event, true);
@@ -551,6 +549,8 @@ AgpsState* AgpsReleasingState::onRsrcEvent(AgpsRsrcStatus event, void* data)
         // A race condition subscriber unsubscribes before AFW denies resource.
     case RSRC_RELEASED:
     {
+        // NIF is gone under a lingering state machine
+        mStateMachine->stopLinger(false);
         nextState = mAcquiredState;
         Notification notification(Notification::BROADCAST_INACTIVE, event, true);
         // notify all subscribers that are active NIF resource RELEASE
@@ -616,6 +616,227 @@ int AGpsServicer :: requestRsrc(void *cb_data)
     return 0;
 }
 
+//======================================================================
+// AgpsSubscriberList
+//======================================================================
+
+// must be a power of 2
+#define SUBSCRIBER_LIST_MIN_BUCKETS 16
+
+AgpsSubscriberList::AgpsSubscriberList() :
+    mBuckets(new Node*[SUBSCRIBER_LIST_MIN_BUCKETS]),
+    mBucketCount(SUBSCRIBER_LIST_MIN_BUCKETS),
+    mCount(0), mHead(NULL), mTail(NULL)
+{
+    memset(mBuckets, 0, sizeof(Node*) * mBucketCount);
+}
+
+AgpsSubscriberList::~AgpsSubscriberList()
+{
+    flush();
+    delete[] mBuckets;
+}
+
+AgpsSubscriberList::Node**
+AgpsSubscriberList::bucketOf(const Subscriber* subscriber) const
+{
+    // BITSubscribers with INADDR_NONE differ only by their ipv6
+    // address, they share a bucket and equals() tells them apart.
+    uint32_t hash = (subscriber->ID ^ ((uint32_t)subscriber->mType << 28)) *
+                    2654435761U;
+    return &mBuckets[(hash ^ (hash >> 16)) & (mBucketCount - 1)];
+}
+
+AgpsSubscriberList::Node*
+AgpsSubscriberList::lookup(const Subscriber* subscriber) const
+{
+    Node* node = *bucketOf(subscriber);
+    while (NULL != node &&
+           (node->mSubscriber->mType != subscriber->mType ||
+            !node->mSubscriber->equals(subscriber))) {
+        node = node->mChain;
+    }
+    return node;
+}
+
+void AgpsSubscriberList::rehash(unsigned int bucketCount)
+{
+    delete[] mBuckets;
+    mBuckets = new Node*[bucketCount];
+    mBucketCount = bucketCount;
+    memset(mBuckets, 0, sizeof(Node*) * mBucketCount);
+
+    for (Node* node = mHead; NULL != node; node = node->mNext) {
+        Node** bucket = bucketOf(node->mSubscriber);
+        node->mChain = *bucket;
+        *bucket = node;
+    }
+}
+
+void AgpsSubscriberList::add(Subscriber* subscriber)
+{
+    if (mCount >= mBucketCount) {
+        rehash(mBucketCount << 1);
+    }
+
+    Node* node = new Node;
+    Node** bucket = bucketOf(subscriber);
+    node->mSubscriber = subscriber;
+    node->mChain = *bucket;
+    *bucket = node;
+
+    node->mNext = NULL;
+    node->mPrev = mTail;
+    if (NULL == mTail) {
+        mHead = node;
+    } else {
+        mTail->mNext = node;
+    }
+    mTail = node;
+    mCount++;
+}
+
+void AgpsSubscriberList::remove(Node* node)
+{
+    Node** link = bucketOf(node->mSubscriber);
+    while (*link != node) {
+        link = &(*link)->mChain;
+    }
+    *link = node->mChain;
+
+    if (NULL == node->mPrev) {
+        mHead = node->mNext;
+    } else {
+        node->mPrev->mNext = node->mNext;
+    }
+    if (NULL == node->mNext) {
+        mTail = node->mPrev;
+    } else {
+        node->mNext->mPrev = node->mPrev;
+    }
+    mCount--;
+
+    delete node->mSubscriber;
+    delete node;
+}
+
+Subscriber* AgpsSubscriberList::findFirst(Notification& notification) const
+{
+    if (NULL != notification.rcver) {
+        return find(notification.rcver);
+    }
+
+    for (Node* node = mHead; NULL != node; node = node->mNext) {
+        if (node->mSubscriber->forMe(notification)) {
+            return node->mSubscriber;
+        }
+    }
+    return NULL;
+}
+
+void AgpsSubscriberList::notify(Notification& notification)
+{
+    if (NULL != notification.rcver) {
+        // subscribers are unique, so there is at most one to tell
+        Node* node = lookup(notification.rcver);
+        if (NULL != node &&
+            notifySubscriber(&notification, node->mSubscriber)) {
+            remove(node);
+        }
+        return;
+    }
+
+    Node* node = mHead;
+    while (NULL != node) {
+        // node may be gone once notified
+        Node* next = node->mNext;
+        if (notifySubscriber(&notification, node->mSubscriber)) {
+            remove(node);
+        }
+        node = next;
+    }
+}
+
+void AgpsSubscriberList::deactivate(Subscriber* subscriber)
+{
+    Node* node = lookup(subscriber);
+    subscriber->setInactive();
+
+    // inactive ones go to the back, so that looking for an active
+    // subscriber stops at the head.
+    if (NULL != node && mTail != node) {
+        if (NULL == node->mPrev) {
+            mHead = node->mNext;
+        } else {
+            node->mPrev->mNext = node->mNext;
+        }
+        node->mNext->mPrev = node->mPrev;
+        node->mPrev = mTail;
+        node->mNext = NULL;
+        mTail->mNext = node;
+        mTail = node;
+    }
+}
+
+void AgpsSubscriberList::flush()
+{
+    Node* node = mHead;
+    while (NULL != node) {
+        Node* next = node->mNext;
+        delete node->mSubscriber;
+        delete node;
+        node = next;
+    }
+    memset(mBuckets, 0, sizeof(Node*) * mBucketCount);
+    mHead = mTail = NULL;
+    mCount = 0;
+}
+
+//======================================================================
+// AgpsLingerTimer
+//======================================================================
+
+struct AgpsLingerExpiredMsg : public LocMsg {
+    AgpsStateMachine* mStateMachine;
+    const uint32_t mSeq;
+    inline AgpsLingerExpiredMsg(AgpsStateMachine* stateMachine,
+                                uint32_t seq) :
+        LocMsg(), mStateMachine(stateMachine), mSeq(seq)
+    {
+        locallog();
+    }
+    inline virtual void proc() const
+    {
+        mStateMachine->onLingerExpired(mSeq);
+    }
+    inline void locallog() const
+    {
+        LOC_LOGV("AgpsLingerExpired: type %d, seq %u",
+                 mStateMachine->getType(), mSeq);
+    }
+    inline virtual void log() const
+    {
+        locallog();
+    }
+};
+
+class AgpsLingerTimer : public LocTimer {
+    AgpsStateMachine* mStateMachine;
+    LocEngAdapter* mAdapter;
+public:
+    // seq of the linger the timer is armed for
+    uint32_t mSeq;
+    inline AgpsLingerTimer(AgpsStateMachine* stateMachine,
+                           LocEngAdapter* adapter) :
+        LocTimer(), mStateMachine(stateMachine), mAdapter(adapter),
+        mSeq(0) {}
+    // state machine only runs on the adapter's thread
+    inline virtual void timeOutCallback()
+    {
+        mAdapter->sendMsg(new AgpsLingerExpiredMsg(mStateMachine, mSeq));
+    }
+};
+
 //======================================================================
 // AgpsStateMachine
 //======================================================================
@@ -629,10 +850,15 @@ AgpsStateMachine::AgpsStateMachine(servicerType servType,
     mAPNLen(0),
     mBearer(AGPS_APN_BEARER_INVALID),
     mEnforceSingleSubscriber(enforceSingleSubscriber),
+    mLingerTimer(NULL),
+    mLingerMs(0),
+    mLingerStartMs(0),
+    mLingerSeq(0),
+    mLingers(0),
+    mReconnectsAvoided(0),
+    mLingerConnectedMs(0),
     mServicer(Servicer :: getServicer(servType, (void *)cb_func))
 {
-    linked_list_init(&mSubscribers);
-
     // setting up mReleasedState
     mStatePtr->mPendingState = new AgpsPendingState(this);
     mStatePtr->mAcquiredState = new AgpsAcquiredState(this);
@@ -671,7 +897,7 @@ AgpsStateMachine::~AgpsStateMachine()
     delete pendindState;
     delete releasingState;
     delete mServicer;
-    linked_list_destroy(&mSubscribers);
+    delete mLingerTimer;
 
     if (NULL != mAPN) {
         delete[] mAPN;
@@ -697,6 +923,90 @@ void AgpsStateMachine::setAPN(const char* apn, unsigned int len)
     }
 }
 
+void AgpsStateMachine::setLinger(uint32_t seconds, LocEngAdapter* adapter)
+{
+    if (0 == seconds || NULL == adapter) {
+        return;
+    }
+    if (NULL == mLingerTimer) {
+        mLingerTimer = new AgpsLingerTimer(this, adapter);
+    }
+    mLingerMs = seconds * 1000;
+    LOC_LOGD("AgpsStateMachine: type %d lingers %u s", mType, seconds);
+}
+
+bool AgpsStateMachine::startLinger() const
+{
+    if (NULL == mLingerTimer) {
+        return false;
+    }
+
+    mLingerTimer->stop();
+    mLingerTimer->mSeq = ++mLingerSeq;
+    if (!mLingerTimer->start(mLingerMs, true)) {
+        LOC_LOGE("AgpsStateMachine: type %d failed to start linger timer",
+                 mType);
+        return false;
+    }
+
+    mLingerStartMs = elapsedMillisSinceBoot();
+    mLingers++;
+    LOC_LOGD("AgpsStateMachine: type %d lingering for %u ms",
+             mType, mLingerMs);
+    return true;
+}
+
+void AgpsStateMachine::stopLinger(bool reused) const
+{
+    if (!isLingering()) {
+        return;
+    }
+
+    mLingerTimer->stop();
+    int64_t lingeredMs = elapsedMillisSinceBoot() - mLingerStartMs;
+    mLingerStartMs = 0;
+    mLingerConnectedMs += lingeredMs;
+    if (reused) {
+        mReconnectsAvoided++;
+    }
+    LOC_LOGD("AgpsStateMachine: type %d lingered %lld ms, %s; "
+             "%u of %u lingers reused",
+             mType, (long long)lingeredMs, reused ? "reused" : "ended",
+             mReconnectsAvoided, mLingers);
+}
+
+void AgpsStateMachine::onLingerExpired(uint32_t seq)
+{
+    // the linger may have ended before the expiry got here
+    if (!isLingering() || seq != mLingerSeq) {
+        return;
+    }
+
+    stopLinger(false);
+    // lingering only happens in RELEASING state without subscribers
+    mStatePtr = mStatePtr->mReleasedState;
+    // tell connecivity service we can release NIF
+    sendRsrcRequest(GPS_RELEASE_AGPS_DATA_CONN);
+}
+
+bool AgpsStateMachine::isRsrcAcquired() const
+{
+    return mStatePtr == mStatePtr->mAcquiredState || isLingering();
+}
+
+size_t AgpsStateMachine::dumpLingerStats(char* buf, size_t size) const
+{
+    int len = snprintf(buf, size,
+                       "AGPS type %d: linger %u ms, %u lingers, "
+                       "%u reconnects avoided, %llu ms connected longer\n",
+                       mType, mLingerMs, mLingers, mReconnectsAvoided,
+                       (unsigned long long)mLingerConnectedMs);
+    if (len < 0 || 0 == size) {
+        return 0;
+    }
+    return (size_t)len < size ? (size_t)len : size - 1;
+}
+
 void AgpsStateMachine::onRsrcEvent(AgpsRsrcStatus event)
 {
     switch (event)
@@ -714,45 +1024,25 @@ void AgpsStateMachine::onRsrcEvent(AgpsRsrcStatus event)
 
 void AgpsStateMachine::notifySubscribers(Notification& notification) const
 {
-    if (notification.postNotifyDelete) {
-        // just any non NULL value to get started
-        Subscriber* s = (Subscriber*)~0;
-        while (NULL != s) {
-            s = NULL;
-            // if the last param sets to true, _search will delete
-            // the node from the list for us.  But the problem is
-            // once that is done, _search returns, leaving the
-            // rest of the list unprocessed.  So we need a loop.
-            linked_list_search(mSubscribers, (void**)&s, notifySubscriber,
-                               (void*)&notification, true);
-            delete s;
-        }
-    } else {
-        // no loop needed if it the last param sets to false, which
-        // mean nothing gets deleted from the list.
-        linked_list_search(mSubscribers, NULL, notifySubscriber,
-                           (void*)&notification, false);
-    }
+    mSubscribers.notify(notification);
 }
 
 void AgpsStateMachine::addSubscriber(Subscriber* subscriber) const
 {
-    Subscriber* s = NULL;
-    Notification notification((const Subscriber*)subscriber);
-    linked_list_search(mSubscribers, (void**)&s,
-                       hasSubscriber, (void*)&notification, false);
-
-    if (NULL == s) {
-        linked_list_add(mSubscribers, subscriber->clone(), deleteObj);
+    if (NULL == mSubscribers.find(subscriber)) {
+        mSubscribers.add(subscriber->clone());
     }
 }
 
+void AgpsStateMachine::deactivateSubscriber(Subscriber* subscriber) const
+{
+    mSubscribers.deactivate(subscriber);
+}
+
 int AgpsStateMachine::sendRsrcRequest(AGpsStatusValue action) const
 {
-    Subscriber* s = NULL;
     Notification notification(Notification::BROADCAST_ACTIVE);
-    linked_list_search(mSubscribers, (void**)&s, hasSubscriber,
-                       (void*)&notification, false);
+    Subscriber* s = mSubscribers.findFirst(notification);
 
     if ((NULL == s) == (GPS_RELEASE_AGPS_DATA_CONN == action)) {
         AGpsExtStatus nifRequest;
@@ -788,10 +1078,7 @@ void AgpsStateMachine::subscribeRsrc(Subscriber *subscriber)
 
 bool AgpsStateMachine::unsubscribeRsrc(Subscriber *subscriber)
 {
-    Subscriber* s = NULL;
-    Notification notification((const Subscriber*)subscriber);
-    linked_list_search(mSubscribers, (void**)&s,
-                       hasSubscriber, (void*)&notification, false);
+    Subscriber* s = mSubscribers.find(subscriber);
 
     if (NULL != s) {
         mStatePtr = mStatePtr->onRsrcEvent(RSRC_UNSUBSCRIBE, (void*)s);
@@ -802,11 +1089,8 @@ bool AgpsStateMachine::unsubscribeRsrc(Subscriber *subscriber)
 
 bool AgpsStateMachine::hasActiveSubscribers() const
 {
-    Subscriber* s = NULL;
     Notification notification(Notification::BROADCAST_ACTIVE);
-    linked_list_search(mSubscribers, (void**)&s,
-                       hasSubscriber, (void*)&notification, false);
-    return NULL != s;
+    return NULL != mSubscribers.findFirst(notification);
 }
 
 //======================================================================
@@ -837,10 +1121,8 @@ DSStateMachine :: DSStateMachine(servicerType type, void *cb_func,
 
 void DSStateMachine :: retryCallback(void)
 {
-    DSSubscriber *subscriber = NULL;
     Notification notification(Notification::BROADCAST_ACTIVE);
-    linked_list_search(mSubscribers, (void**)&subscriber, hasSubscriber,
-                       (void*)&notification, false);
+    Subscriber *subscriber = mSubscribers.findFirst(notification);
     if(subscriber)
         mLocAdapter->requestSuplES(subscriber->ID);
     else
@@ -851,14 +1133,12 @@ void DSStateMachine :: retryCallback(void)
 
 int DSStateMachine :: sendRsrcRequest(AGpsStatusValue action) const
 {
-    DSSubscriber* s = NULL;
     dsCbData cbData;
     int ret=-1;
     int connHandle=-1;
     LOC_LOGD("Enter DSStateMachine :: sendRsrcRequest\n");
     Notification notification(Notification::BROADCAST_ACTIVE);
-    linked_list_search(mSubscribers, (void**)&s, hasSubscriber,
-                       (void*)&notification, false);
+    Subscriber* s = mSubscribers.findFirst(notification);
     if(s) {
         connHandle = s->ID;
         LOC_LOGD("DSStateMachine :: sendRsrcRequest - subscriber found\n");
@@ -37,13 +37,13 @@
 #include <hardware/gps.h>
 #include <gps_extended.h>
 #include <loc_core_log.h>
-#include <linked_list.h>
 #include <loc_timer.h>
 #include <LocEngAdapter.h>
 
 // forward declaration
 class AgpsStateMachine;
 class Subscriber;
+class AgpsLingerTimer;
 
 // NIF resource events
 typedef enum {
@@ -110,6 +110,59 @@ struct Notification {
         postNotifyDelete(false) {}
 };
 
+// kind of AGPS client a subscriber stands for.  Part of the subscriber
+// identity, so an ATL connection handle never aliases a WIFI sender id.
+typedef enum {
+    SUBSCRIBER_BIT,
+    SUBSCRIBER_ATL,
+    SUBSCRIBER_WIFI,
+    SUBSCRIBER_DS
+} SubscriberType;
+
+// Subscribers of a state machine, kept in subscribe order with the
+// inactive ones at the back, and hashed on (type, ID) so that targeted
+// lookups do not walk the whole list.
+// notify() visits every subscriber exactly once, and may delete the
+// subscriber it is visiting.
+class AgpsSubscriberList {
+    struct Node {
+        Subscriber* mSubscriber;
+        Node* mPrev;
+        Node* mNext;
+        // next node in the same hash bucket
+        Node* mChain;
+    };
+    Node** mBuckets;
+    unsigned int mBucketCount;
+    unsigned int mCount;
+    Node* mHead;
+    Node* mTail;
+
+    Node** bucketOf(const Subscriber* subscriber) const;
+    Node* lookup(const Subscriber* subscriber) const;
+    void remove(Node* node);
+    void rehash(unsigned int bucketCount);
+public:
+    AgpsSubscriberList();
+    ~AgpsSubscriberList();
+
+    // takes the ownership of subscriber
+    void add(Subscriber* subscriber);
+    // the list copy of subscriber, NULL if not there
+    inline Subscriber* find(const Subscriber* subscriber) const
+    { Node* node = lookup(subscriber); return node ? node->mSubscriber : NULL; }
+    // marks subscriber inactive, moving it behind the active ones
+    void deactivate(Subscriber* subscriber);
+    // first subscriber in list order the notification is for
+    Subscriber* findFirst(Notification& notification) const;
+    // delivers notification to the subscriber(s) it is for, deleting
+    // them afterwards if notification.postNotifyDelete is set
+    void notify(Notification& notification);
+    void flush();
+    inline bool empty() const { return 0 == mCount; }
+    inline unsigned int size() const { return mCount; }
+};
+
 class AgpsState {
     // allows AgpsStateMachine to access private data
     // no class members are public.  We don't want
@@ -179,8 +232,8 @@ public:
 
 class AgpsStateMachine {
 protected:
-    // a linked list of subscribers.
-    void* mSubscribers;
+    // subscribers, indexed on their identity.
+    mutable AgpsSubscriberList mSubscribers;
     //handle to whoever provides the service
     Servicer *mServicer;
     // allows AgpsState to access private data
@@ -203,6 +256,17 @@ private:
     AGpsBearerType mBearer;
     // ipv4 address for routing
     bool mEnforceSingleSubscriber;
+    // linger window, see setLinger()
+    AgpsLingerTimer* mLingerTimer;
+    uint32_t mLingerMs;
+    // when the current linger started, 0 if not lingering
+    mutable int64_t mLingerStartMs;
+    // tells a stale expiry from the one of the current linger
+    mutable uint32_t mLingerSeq;
+    // linger stats since boot
+    mutable uint32_t mLingers;
+    mutable uint32_t mReconnectsAvoided;
+    mutable uint64_t mLingerConnectedMs;
 
 public:
     AgpsStateMachine(servicerType servType, void *cb_func,
@@ -216,31 +280,46 @@ public:
     inline AGpsBearerType getBearer() const { return mBearer; }
     inline AGpsExtType getType() const { return (AGpsExtType)mType; }
 
+    // keeps the NIF up for seconds after the last subscriber is gone,
+    // granting new subscribers right away in the meantime.  The expiry
+    // is handled on the adapter's thread.  0 disables lingering.
+    void setLinger(uint32_t seconds, LocEngAdapter* adapter);
+    inline bool isLingering() const { return 0 != mLingerStartMs; }
+    // NIF is up, either in use or lingering
+    bool isRsrcAcquired() const;
+    // the last subscriber is gone, returns false if NIF should be
+    // released right away instead.
+    bool startLinger() const;
+    // reused is true if a new subscriber got the lingering NIF
+    void stopLinger(bool reused) const;
+    // linger window expired, releases NIF if it is still lingering
+    void onLingerExpired(uint32_t seq);
+    size_t dumpLingerStats(char* buf, size_t size) const;
+
     // someone, a ATL client or BIT, is asking for NIF
     void subscribeRsrc(Subscriber *subscriber);
 
     // someone, a ATL client or BIT, is done with NIF
     bool unsubscribeRsrc(Subscriber *subscriber);
 
-    // add a subscriber in the linked list, if not already there.
+    // add a subscriber in the list, if not already there.
     void addSubscriber(Subscriber* subscriber) const;
 
+    // subscriber waits for close complete, it is no longer active.
+    void deactivateSubscriber(Subscriber* subscriber) const;
+
     virtual void onRsrcEvent(AgpsRsrcStatus event);
 
     // put the data together and send the FW
     virtual int sendRsrcRequest(AGpsStatusValue action) const;
 
-    //if list is empty, linked_list_empty returns 1
-    //else if list is not empty, returns 0
-    //so hasSubscribers() returns 1 if list is not empty
-    //and returns 0 if list is empty
     inline bool hasSubscribers() const
-    { return !linked_list_empty(mSubscribers); }
+    { return !mSubscribers.empty(); }
 
     bool hasActiveSubscribers() const;
 
     inline void dropAllSubscribers() const
-    { linked_list_flush(mSubscribers); }
+    { mSubscribers.flush(); }
 
     // private. Only a state gets to call this.
     void notifySubscribers(Notification& notification) const;
@@ -269,10 +348,11 @@ public:
 // cilent from BIT daemon.
 struct Subscriber {
     const uint32_t ID;
+    const SubscriberType mType;
     const AgpsStateMachine* mStateMachine;
-    inline Subscriber(const int id,
+    inline Subscriber(const int id, const SubscriberType type,
                       const AgpsStateMachine* stateMachine) :
-        ID(id), mStateMachine(stateMachine) {}
+        ID(id), mType(type), mStateMachine(stateMachine) {}
     inline virtual ~Subscriber() {}
 
     virtual void setIPAddresses(uint32_t &v4, char* v6) = 0;
@@ -303,7 +383,7 @@ struct BITSubscriber : public Subscriber {
 
     inline BITSubscriber(const AgpsStateMachine* stateMachine,
                          unsigned int ipv4, char* ipv6) :
-        Subscriber(ipv4, stateMachine)
+        Subscriber(ipv4, SUBSCRIBER_BIT, stateMachine)
     {
         if (NULL == ipv6) {
             mIPv6Addr[0] = 0;
@@ -337,7 +417,7 @@ struct ATLSubscriber : public Subscriber {
                          const AgpsStateMachine* stateMachine,
                          const LocEngAdapter* adapter,
                          const bool compatibleMode) :
-        Subscriber(id, stateMachine), mLocAdapter(adapter),
+        Subscriber(id, SUBSCRIBER_ATL, stateMachine), mLocAdapter(adapter),
         mBackwardCompatibleMode(compatibleMode){}
     virtual bool notifyRsrcStatus(Notification &notification);
 
@@ -363,7 +443,7 @@ struct WIFISubscriber : public Subscriber {
     bool mIsInactive;
     inline WIFISubscriber(const AgpsStateMachine* stateMachine,
                          char * ssid, char * password, loc_if_req_sender_id_e_type sender_id) :
-        Subscriber(sender_id, stateMachine),
+        Subscriber(sender_id, SUBSCRIBER_WIFI, stateMachine),
         mSSID(NULL == ssid ? NULL : new char[SSID_BUF_SIZE]),
         mPassword(NULL == password ? NULL : new char[SSID_BUF_SIZE]),
         senderId(sender_id)
@@ -410,7 +490,7 @@ struct DSSubscriber : public Subscriber {
     bool mIsInactive;
     inline DSSubscriber(const AgpsStateMachine *stateMachine,
                          const int id) :
-        Subscriber(id, stateMachine)
+        Subscriber(id, SUBSCRIBER_DS, stateMachine)
     {
         mIsInactive = false;
     }
@@ -29,17 +29,21 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <linux/stat.h>
 #include <fcntl.h>
 #include <linux/types.h>
 #include <unistd.h>
 #include <errno.h>
 #include <grp.h>
+#include <pthread.h>
 #include <sys/stat.h>
+#include <sys/epoll.h>
 
 #include "log_util.h"
 #include "platform_lib_includes.h"
 #include "loc_eng_dmn_conn_glue_msg.h"
+#include "loc_eng_dmn_conn_glue_sock.h"
 #include "loc_eng_dmn_conn_handler.h"
 #include "loc_eng_dmn_conn.h"
 #include "loc_eng_msg.h"
@@ -55,100 +59,118 @@ static const char * global_loc_api_resp_q_path = GPSONE_LOC_API_RESP_Q_PATH;
 static const char * global_quipc_ctrl_q_path = QUIPC_CTRL_Q_PATH;
 static const char * global_msapm_ctrl_q_path = MSAPM_CTRL_Q_PATH;
 static const char * global_msapu_ctrl_q_path = MSAPU_CTRL_Q_PATH;
-
-static int loc_api_server_proc_init(void *context)
+static const char * global_loc_api_sock_path = GPSONE_LOC_API_SOCK_PATH;
+
+/* Besides the legacy request pipe, the server listens on a SOCK_SEQPACKET
+   socket. Any number of senders may connect to it, one ctrl_msgbuf per
+   packet; a sender's responses go back over the connection its last
+   request came in on, and to its ctrl pipe while it has none. */
+#define LOC_API_SERVER_MAX_CLIENTS 8
+#define LOC_API_SERVER_MAX_EVENTS  (LOC_API_SERVER_MAX_CLIENTS + 2)
+#define LOC_API_SERVER_BATCH       8
+#define LOC_API_SERVER_MSG_SIZE    (sizeof(struct ctrl_msgbuf) + 256)
+
+static int loc_api_server_epollfd = -1;
+static int loc_api_server_sockfd = -1;
+static int loc_api_clients[LOC_API_SERVER_MAX_CLIENTS];
+static int loc_api_sender_socks[LOC_ENG_IF_REQUEST_SENDER_ID_UNKNOWN];
+// guards loc_api_sender_socks against the engine thread sending responses
+static pthread_mutex_t loc_api_sender_lock = PTHREAD_MUTEX_INITIALIZER;
+static void * loc_api_server_bufs[LOC_API_SERVER_BATCH];
+static int loc_api_server_lens[LOC_API_SERVER_BATCH];
+
+static void loc_api_server_set_access(const char * path)
 {
-    loc_api_server_msgqid = loc_eng_dmn_conn_glue_msgget(global_loc_api_q_path, O_RDWR);
-    //change mode/group for the global_loc_api_q_path pipe
-    int result = chmod (global_loc_api_q_path, 0660);
+    int result = chmod (path, 0660);
     if (result != 0)
     {
-        LOC_LOGE("failed to change mode for %s, error = %s\n", global_loc_api_q_path, strerror(errno));
+        LOC_LOGE("failed to change mode for %s, error = %s\n", path, strerror(errno));
     }
 
     struct group * gps_group = getgrnam("gps");
     if (gps_group != NULL)
     {
-       result = chown (global_loc_api_q_path, -1, gps_group->gr_gid);
+       result = chown (path, -1, gps_group->gr_gid);
        if (result != 0)
        {
-          LOC_LOGE("chown for pipe failed, pipe %s, gid = %d, result = %d, error = %s\n",
-                   global_loc_api_q_path, gps_group->gr_gid, result, strerror(errno));
+          LOC_LOGE("chown failed, path %s, gid = %d, result = %d, error = %s\n",
+                   path, gps_group->gr_gid, result, strerror(errno));
        }
     }
     else
     {
        LOC_LOGE("getgrnam for gps failed, error code = %d\n",  errno);
     }
-
-    loc_api_resp_msgqid = loc_eng_dmn_conn_glue_msgget(global_loc_api_resp_q_path, O_RDWR);
-
-    //change mode/group for the global_loc_api_resp_q_path pipe
-    result = chmod (global_loc_api_resp_q_path, 0660);
-    if (result != 0)
-    {
-        LOC_LOGE("failed to change mode for %s, error = %s\n", global_loc_api_resp_q_path, strerror(errno));
-    }
-
-    if (gps_group != NULL)
-    {
-       result = chown (global_loc_api_resp_q_path, -1, gps_group->gr_gid);
-       if (result != 0)
-       {
-          LOC_LOGE("chown for pipe failed, pipe %s, gid = %d, result = %d, error = %s\n",
-                   global_loc_api_resp_q_path,
-                   gps_group->gr_gid, result, strerror(errno));
-       }
-    }
-
-    quipc_msgqid = loc_eng_dmn_conn_glue_msgget(global_quipc_ctrl_q_path, O_RDWR);
-    msapm_msgqid = loc_eng_dmn_conn_glue_msgget(global_msapm_ctrl_q_path , O_RDWR);
-    msapu_msgqid = loc_eng_dmn_conn_glue_msgget(global_msapu_ctrl_q_path , O_RDWR);
-
-    LOC_LOGD("%s:%d] loc_api_server_msgqid = %d\n", __func__, __LINE__, loc_api_server_msgqid);
-    return 0;
 }
 
-static int loc_api_server_proc_pre(void *context)
+static int loc_api_server_watch(int fd)
 {
-    return 0;
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    return epoll_ctl(loc_api_server_epollfd, EPOLL_CTL_ADD, fd, &ev);
 }
 
-static int loc_api_server_proc(void *context)
+static void loc_api_server_accept(void)
 {
-    int length, sz;
-    int result = 0;
-    static int cnt = 0;
-    struct ctrl_msgbuf * p_cmsgbuf;
-    struct ctrl_msgbuf cmsg_resp;
-
-    sz = sizeof(struct ctrl_msgbuf) + 256;
-    p_cmsgbuf = (struct ctrl_msgbuf *) malloc(sz);
+    int fd;
+    while ((fd = loc_eng_dmn_conn_glue_sockaccept(loc_api_server_sockfd)) >= 0) {
+        int i;
+        for (i = 0; i < LOC_API_SERVER_MAX_CLIENTS && loc_api_clients[i] >= 0; i++);
+
+        if (i == LOC_API_SERVER_MAX_CLIENTS || loc_api_server_watch(fd) != 0) {
+            LOC_LOGE("%s:%d] dropping connection %d\n", __func__, __LINE__, fd);
+            close(fd);
+            continue;
+        }
+        loc_api_clients[i] = fd;
+        LOC_LOGD("%s:%d] client %d connected\n", __func__, __LINE__, fd);
+    }
+}
 
-    if (!p_cmsgbuf) {
-        LOC_LOGE("%s:%d] Out of memory\n", __func__, __LINE__);
-        return -1;
+static void loc_api_server_drop(int fd)
+{
+    LOC_LOGD("%s:%d] client %d gone\n", __func__, __LINE__, fd);
+    epoll_ctl(loc_api_server_epollfd, EPOLL_CTL_DEL, fd, NULL);
+
+    pthread_mutex_lock(&loc_api_sender_lock);
+    for (int i = 0; i < LOC_ENG_IF_REQUEST_SENDER_ID_UNKNOWN; i++) {
+        if (loc_api_sender_socks[i] == fd) {
+            loc_api_sender_socks[i] = -1;
+        }
     }
+    close(fd);
+    pthread_mutex_unlock(&loc_api_sender_lock);
 
-    cnt ++;
-    LOC_LOGD("%s:%d] %d listening on %s...\n", __func__, __LINE__, cnt, (char *) context);
-    length = loc_eng_dmn_conn_glue_msgrcv(loc_api_server_msgqid, p_cmsgbuf, sz);
-    if (length <= 0) {
-        free(p_cmsgbuf);
-        LOC_LOGE("%s:%d] fail receiving msg from gpsone_daemon, retry later\n", __func__, __LINE__);
-        usleep(1000);
-        return -1;
+    for (int i = 0; i < LOC_API_SERVER_MAX_CLIENTS; i++) {
+        if (loc_api_clients[i] == fd) {
+            loc_api_clients[i] = -1;
+        }
     }
+}
 
+static void loc_api_server_dispatch(struct ctrl_msgbuf * p_cmsgbuf, int length, int client)
+{
     LOC_LOGD("%s:%d] received ctrl_type = %d\n", __func__, __LINE__, p_cmsgbuf->ctrl_type);
     switch(p_cmsgbuf->ctrl_type) {
         case GPSONE_LOC_API_IF_REQUEST:
-            result = loc_eng_dmn_conn_loc_api_server_if_request_handler(p_cmsgbuf, length);
-            break;
-
         case GPSONE_LOC_API_IF_RELEASE:
-            result = loc_eng_dmn_conn_loc_api_server_if_release_handler(p_cmsgbuf, length);
+        {
+            // register the reply route before the request can be answered
+            unsigned int sender_id = p_cmsgbuf->cmsg.cmsg_if_request.sender_id;
+            if (client >= 0 && sender_id < LOC_ENG_IF_REQUEST_SENDER_ID_UNKNOWN) {
+                pthread_mutex_lock(&loc_api_sender_lock);
+                loc_api_sender_socks[sender_id] = client;
+                pthread_mutex_unlock(&loc_api_sender_lock);
+            }
+            if (GPSONE_LOC_API_IF_REQUEST == p_cmsgbuf->ctrl_type) {
+                loc_eng_dmn_conn_loc_api_server_if_request_handler(p_cmsgbuf, length);
+            } else {
+                loc_eng_dmn_conn_loc_api_server_if_release_handler(p_cmsgbuf, length);
+            }
             break;
+        }
 
         case GPSONE_UNBLOCK:
             LOC_LOGD("%s:%d] GPSONE_UNBLOCK\n", __func__, __LINE__);
@@ -159,14 +181,149 @@ static int loc_api_server_proc(void *context)
                 __func__, __LINE__, p_cmsgbuf->ctrl_type);
             break;
     }
+}
+
+static void loc_api_server_read_client(int fd)
+{
+    int count;
+    do {
+        count = loc_eng_dmn_conn_glue_sockrcv(fd, loc_api_server_bufs,
+                                              loc_api_server_lens,
+                                              LOC_API_SERVER_MSG_SIZE,
+                                              LOC_API_SERVER_BATCH);
+        if (count < 0) {
+            loc_api_server_drop(fd);
+            return;
+        }
+
+        for (int i = 0; i < count; i++) {
+            struct ctrl_msgbuf * p_cmsgbuf = (struct ctrl_msgbuf *) loc_api_server_bufs[i];
+            int length = loc_api_server_lens[i];
+            if (length < (int) sizeof(struct ctrl_msgbuf) ||
+                length != (int) p_cmsgbuf->msgsz) {
+                LOC_LOGE("%s:%d] malformed packet from %d, length = %d\n",
+                         __func__, __LINE__, fd, length);
+                continue;
+            }
+            loc_api_server_dispatch(p_cmsgbuf, length, fd);
+        }
+    } while (count == LOC_API_SERVER_BATCH);
+}
+
+static int loc_api_server_proc_init(void *context)
+{
+    loc_api_server_msgqid = loc_eng_dmn_conn_glue_msgget(global_loc_api_q_path, O_RDWR);
+    //change mode/group for the global_loc_api_q_path pipe
+    loc_api_server_set_access(global_loc_api_q_path);
+
+    loc_api_resp_msgqid = loc_eng_dmn_conn_glue_msgget(global_loc_api_resp_q_path, O_RDWR);
+    //change mode/group for the global_loc_api_resp_q_path pipe
+    loc_api_server_set_access(global_loc_api_resp_q_path);
+
+    quipc_msgqid = loc_eng_dmn_conn_glue_msgget(global_quipc_ctrl_q_path, O_RDWR);
+    msapm_msgqid = loc_eng_dmn_conn_glue_msgget(global_msapm_ctrl_q_path , O_RDWR);
+    msapu_msgqid = loc_eng_dmn_conn_glue_msgget(global_msapu_ctrl_q_path , O_RDWR);
+
+    for (int i = 0; i < LOC_API_SERVER_MAX_CLIENTS; i++) {
+        loc_api_clients[i] = -1;
+    }
+    for (int i = 0; i < LOC_ENG_IF_REQUEST_SENDER_ID_UNKNOWN; i++) {
+        loc_api_sender_socks[i] = -1;
+    }
+    for (int i = 0; i < LOC_API_SERVER_BATCH; i++) {
+        loc_api_server_bufs[i] = malloc(LOC_API_SERVER_MSG_SIZE);
+        if (!loc_api_server_bufs[i]) {
+            LOC_LOGE("%s:%d] Out of memory\n", __func__, __LINE__);
+            return -1;
+        }
+    }
+
+    loc_api_server_epollfd = epoll_create1(EPOLL_CLOEXEC);
+    if (loc_api_server_epollfd < 0 || loc_api_server_watch(loc_api_server_msgqid) != 0) {
+        LOC_LOGE("%s:%d] epoll setup failed: %s\n", __func__, __LINE__, strerror(errno));
+        return -1;
+    }
+
+    // the socket is an addition; the pipes keep working without it
+    loc_api_server_sockfd = loc_eng_dmn_conn_glue_sockget(global_loc_api_sock_path,
+                                                          LOC_API_SERVER_MAX_CLIENTS);
+    if (loc_api_server_sockfd >= 0) {
+        loc_api_server_set_access(global_loc_api_sock_path);
+        if (loc_api_server_watch(loc_api_server_sockfd) != 0) {
+            LOC_LOGE("%s:%d] cannot watch %s\n", __func__, __LINE__, global_loc_api_sock_path);
+            loc_eng_dmn_conn_glue_sockremove(global_loc_api_sock_path, loc_api_server_sockfd);
+            loc_api_server_sockfd = -1;
+        }
+    }
+
+    LOC_LOGD("%s:%d] loc_api_server_msgqid = %d, loc_api_server_sockfd = %d\n",
+             __func__, __LINE__, loc_api_server_msgqid, loc_api_server_sockfd);
+    return 0;
+}
+
+static int loc_api_server_proc(void *context)
+{
+    int n, length;
+    static int cnt = 0;
+    struct epoll_event events[LOC_API_SERVER_MAX_EVENTS];
+
+    cnt ++;
+    LOC_LOGD("%s:%d] %d listening on %s...\n", __func__, __LINE__, cnt, (char *) context);
+    n = epoll_wait(loc_api_server_epollfd, events, LOC_API_SERVER_MAX_EVENTS, -1);
+    if (n < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        LOC_LOGE("%s:%d] epoll_wait failed: %s\n", __func__, __LINE__, strerror(errno));
+        usleep(1000);
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        int fd = events[i].data.fd;
+        if (fd == loc_api_server_msgqid) {
+            struct ctrl_msgbuf * p_cmsgbuf = (struct ctrl_msgbuf *) loc_api_server_bufs[0];
+            length = loc_eng_dmn_conn_glue_msgrcv(loc_api_server_msgqid, p_cmsgbuf,
+                                                  LOC_API_SERVER_MSG_SIZE);
+            if (length <= 0) {
+                LOC_LOGE("%s:%d] fail receiving msg from gpsone_daemon, retry later\n", __func__, __LINE__);
+                usleep(1000);
+                return -1;
+            }
+            loc_api_server_dispatch(p_cmsgbuf, length, -1);
+        } else if (fd == loc_api_server_sockfd) {
+            loc_api_server_accept();
+        } else if (events[i].events & EPOLLIN) {
+            // drains whatever is queued, hangup included
+            loc_api_server_read_client(fd);
+        } else {
+            loc_api_server_drop(fd);
+        }
+    }
 
-    free(p_cmsgbuf);
     return 0;
 }
 
 static int loc_api_server_proc_post(void *context)
 {
     LOC_LOGD("%s:%d]\n", __func__, __LINE__);
+    for (int i = 0; i < LOC_API_SERVER_MAX_CLIENTS; i++) {
+        if (loc_api_clients[i] >= 0) {
+            loc_api_server_drop(loc_api_clients[i]);
+        }
+    }
+    if (loc_api_server_sockfd >= 0) {
+        loc_eng_dmn_conn_glue_sockremove(global_loc_api_sock_path, loc_api_server_sockfd);
+        loc_api_server_sockfd = -1;
+    }
+    if (loc_api_server_epollfd >= 0) {
+        close(loc_api_server_epollfd);
+        loc_api_server_epollfd = -1;
+    }
+    for (int i = 0; i < LOC_API_SERVER_BATCH; i++) {
+        free(loc_api_server_bufs[i]);
+        loc_api_server_bufs[i] = NULL;
+    }
     loc_eng_dmn_conn_glue_msgremove( global_loc_api_q_path, loc_api_server_msgqid);
     loc_eng_dmn_conn_glue_msgremove( global_loc_api_resp_q_path, loc_api_resp_msgqid);
     loc_eng_dmn_conn_glue_msgremove( global_quipc_ctrl_q_path, quipc_msgqid);
@@ -184,27 +341,67 @@ static int loc_eng_dmn_conn_unblock_proc(void)
     return 0;
 }
 
-static struct loc_eng_dmn_conn_thelper thelper;
+// set by loc_eng_dmn_conn_loc_api_server_unblock() to end the server loop
+static volatile bool loc_api_server_exit = false;
+static LocThread * loc_api_server_thread = NULL;
+
+class LocApiServerRunnable : public LocRunnable {
+    const int64_t mLaunchTime;
+    const int64_t mInitTime;
+public:
+    inline LocApiServerRunnable(int64_t launchTime, int64_t initTime) :
+        LocRunnable(), mLaunchTime(launchTime), mInitTime(initTime) {}
+    // the pipes and sockets belong to the server thread once it runs
+    inline virtual ~LocApiServerRunnable() {
+        loc_api_server_proc_post((void *) global_loc_api_q_path);
+    }
+    virtual void prerun() {
+        int64_t now = elapsedMillisSinceBoot();
+        LOC_LOGD("%s:%d] loc_api server ready, init %lld ms, start to ready %lld ms\n",
+                 __func__, __LINE__, (long long) (mInitTime - mLaunchTime),
+                 (long long) (now - mLaunchTime));
+    }
+    virtual bool run() {
+        return !loc_api_server_exit &&
+            loc_api_server_proc((void *) global_loc_api_q_path) >= 0;
+    }
+};
 
-int loc_eng_dmn_conn_loc_api_server_launch(thelper_create_thread   create_thread_cb,
+int loc_eng_dmn_conn_loc_api_server_launch(LocThread::tCreate create_thread_cb,
     const char * loc_api_q_path, const char * resp_q_path, void *agps_handle)
 {
-    int result;
+    int64_t launchTime = elapsedMillisSinceBoot();
+
+    if (NULL != loc_api_server_thread) {
+        LOC_LOGE("%s:%d] already launched\n", __func__, __LINE__);
+        return -1;
+    }
 
     loc_api_handle = agps_handle;
 
     if (loc_api_q_path) global_loc_api_q_path = loc_api_q_path;
     if (resp_q_path)    global_loc_api_resp_q_path = resp_q_path;
 
-    result = loc_eng_dmn_conn_launch_thelper( &thelper,
-        loc_api_server_proc_init,
-        loc_api_server_proc_pre,
-        loc_api_server_proc,
-        loc_api_server_proc_post,
-        create_thread_cb,
-        (char *) global_loc_api_q_path);
-    if (result != 0) {
-        LOC_LOGE("%s:%d]\n", __func__, __LINE__);
+    // Set up the pipes and sockets here rather than on the new thread:
+    // senders may queue requests as soon as this returns, and the kernel
+    // holds them until the server loop comes up, so there is nothing to
+    // wait for.
+    if (loc_api_server_proc_init((void *) global_loc_api_q_path) < 0) {
+        LOC_LOGE("%s:%d] init failed\n", __func__, __LINE__);
+        loc_api_server_proc_post((void *) global_loc_api_q_path);
+        return -1;
+    }
+
+    loc_api_server_exit = false;
+    LocApiServerRunnable * runnable =
+        new LocApiServerRunnable(launchTime, elapsedMillisSinceBoot());
+    loc_api_server_thread = new LocThread();
+    if (!loc_api_server_thread->start(create_thread_cb, "loc_eng_dmn_conn", runnable)) {
+        LOC_LOGE("%s:%d] thread start failed\n", __func__, __LINE__);
+        delete loc_api_server_thread;
+        loc_api_server_thread = NULL;
+        // runnable is ours to free if start fails
+        delete runnable;
         return -1;
     }
     return 0;
@@ -212,14 +409,20 @@ int loc_eng_dmn_conn_loc_api_server_launch(thelper_create_thread   create_thread
 
 int loc_eng_dmn_conn_loc_api_server_unblock(void)
 {
-    loc_eng_dmn_conn_unblock_thelper(&thelper);
+    LOC_LOGD("%s:%d]\n", __func__, __LINE__);
+    loc_api_server_exit = true;
     loc_eng_dmn_conn_unblock_proc();
     return 0;
 }
 
 int loc_eng_dmn_conn_loc_api_server_join(void)
 {
-    loc_eng_dmn_conn_join_thelper(&thelper);
+    if (NULL != loc_api_server_thread) {
+        // joins the server thread, which releases its pipes on the way out
+        loc_api_server_thread->stop();
+        delete loc_api_server_thread;
+        loc_api_server_thread = NULL;
+    }
     return 0;
 }
 
@@ -228,6 +431,26 @@ int loc_eng_dmn_conn_loc_api_server_data_conn(int sender_id, int status) {
   LOC_LOGD("%s:%d] quipc_msgqid = %d\n", __func__, __LINE__, quipc_msgqid);
   cmsgbuf.ctrl_type = GPSONE_LOC_API_RESPONSE;
   cmsgbuf.cmsg.cmsg_response.result = status;
+  if (sender_id >= 0 && sender_id < LOC_ENG_IF_REQUEST_SENDER_ID_UNKNOWN) {
+    bool routed = false;
+    int result = 0;
+    pthread_mutex_lock(&loc_api_sender_lock);
+    if (loc_api_sender_socks[sender_id] >= 0) {
+      LOC_LOGD("%s:%d] sender_id = %d over socket %d", __func__, __LINE__,
+               sender_id, loc_api_sender_socks[sender_id]);
+      routed = true;
+      result = loc_eng_dmn_conn_glue_socksnd(loc_api_sender_socks[sender_id],
+                                             & cmsgbuf, sizeof(struct ctrl_msgbuf));
+    }
+    pthread_mutex_unlock(&loc_api_sender_lock);
+    if (routed) {
+      if (result < 0) {
+        LOC_LOGD("%s:%d] error! conn_glue_socksnd failed\n", __func__, __LINE__);
+        return -1;
+      }
+      return 0;
+    }
+  }
   switch (sender_id) {
     case LOC_ENG_IF_REQUEST_SENDER_ID_QUIPC: {
       LOC_LOGD("%s:%d] sender_id = LOC_ENG_IF_REQUEST_SENDER_ID_QUIPC", __func__, __LINE__);
@@ -29,7 +29,7 @@
 #ifndef LOC_ENG_DATA_SERVER_H
 #define LOC_ENG_DATA_SERVER_H
 
-#include "loc_eng_dmn_conn_thread_helper.h"
+#include <LocThread.h>
 
 #ifdef _ANDROID_
 
@@ -38,6 +38,7 @@
 #define QUIPC_CTRL_Q_PATH "/data/misc/location/gpsone_d/quipc_ctrl_q"
 #define MSAPM_CTRL_Q_PATH "/data/misc/location/gpsone_d/msapm_ctrl_q"
 #define MSAPU_CTRL_Q_PATH "/data/misc/location/gpsone_d/msapu_ctrl_q"
+#define GPSONE_LOC_API_SOCK_PATH "/data/misc/location/gpsone_d/gpsone_loc_api_sock"
 
 #else
 
@@ -46,10 +47,11 @@
 #define QUIPC_CTRL_Q_PATH "/tmp/quipc_ctrl_q"
 #define MSAPM_CTRL_Q_PATH "/tmp/msapm_ctrl_q"
 #define MSAPU_CTRL_Q_PATH "/tmp/msapu_ctrl_q"
+#define GPSONE_LOC_API_SOCK_PATH "/tmp/gpsone_loc_api_sock"
 
 #endif
 
-int loc_eng_dmn_conn_loc_api_server_launch(thelper_create_thread   create_thread_cb,
+int loc_eng_dmn_conn_loc_api_server_launch(LocThread::tCreate create_thread_cb,
     const char * loc_api_q_path, const char * ctrl_q_path, void *agps_handle);
 int loc_eng_dmn_conn_loc_api_server_unblock(void);
 int loc_eng_dmn_conn_loc_api_server_join(void);
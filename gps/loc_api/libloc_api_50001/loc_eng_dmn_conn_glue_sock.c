@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2016, The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "loc_eng_dmn_conn_glue_sock.h"
+#include "log_util.h"
+#include "platform_lib_includes.h"
+#include "loc_eng_dmn_conn_handler.h"
+
+/* upper bound on the packets pulled off a socket per recvmmsg() call */
+#define GLUE_SOCK_MAX_BATCH 16
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_sockget
+
+DESCRIPTION
+   create a listening SOCK_SEQPACKET unix domain socket. Each packet on
+   the connections accepted from it carries exactly one ctrl_msgbuf, so
+   no extra framing is needed on top of the socket.
+
+   sock_path - socket name path
+   backlog - listen backlog
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   non blocking listening fd or negative value for failure
+
+SIDE EFFECTS
+   a stale socket file left at sock_path is removed
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_sockget(const char * sock_path, int backlog)
+{
+    int fd;
+    int result;
+    struct sockaddr_un addr;
+
+    LOC_LOGD("%s, backlog = %d\n", sock_path, backlog);
+    if (strlen(sock_path) >= sizeof(addr.sun_path)) {
+        LOC_LOGE("socket path too long: %s\n", sock_path);
+        return -1;
+    }
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOC_LOGE("failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strlcpy(addr.sun_path, sock_path, sizeof(addr.sun_path));
+    unlink(sock_path);
+
+    result = bind(fd, (struct sockaddr *) &addr, sizeof(addr));
+    if (result == 0) {
+        result = listen(fd, backlog);
+    }
+    if (result != 0) {
+        LOC_LOGE("failed: %s\n", strerror(errno));
+        close(fd);
+        unlink(sock_path);
+        return -1;
+    }
+
+    // same access rules as the gpsone_d pipes
+    result = chmod(sock_path, 0660);
+    if (result != 0) {
+        LOC_LOGE("%s failed to change mode for %s, error = %s\n", __func__,
+              sock_path, strerror(errno));
+    }
+
+    LOC_LOGD("fd = %d, %s\n", fd, sock_path);
+    return fd;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_sockremove
+
+DESCRIPTION
+   close a listening socket and remove its name
+
+    sock_path - socket name path
+    fd - listening fd
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_sockremove(const char * sock_path, int fd)
+{
+    if (fd >= 0) close(fd);
+    if (sock_path) unlink(sock_path);
+    LOC_LOGD("fd = %d, %s\n", fd, sock_path);
+    return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_sockaccept
+
+DESCRIPTION
+   accept one pending connection
+
+   fd - listening fd
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   connection fd, or negative value when there is nothing left to accept
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_sockaccept(int fd)
+{
+    int result;
+
+    do {
+        result = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        LOC_LOGE("%s:%d] accept failed: %s\n", __func__, __LINE__, strerror(errno));
+    }
+    return result;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_socksnd
+
+DESCRIPTION
+   send a message as a single packet
+
+   fd - connection fd
+   msgp - pointer to the message
+   msgsz - size of the message
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   number of bytes sent out or negative value for failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_socksnd(int fd, const void * msgp, size_t msgsz)
+{
+    int result;
+    struct ctrl_msgbuf *pmsg = (struct ctrl_msgbuf *) msgp;
+    pmsg->msgsz = msgsz;
+
+    do {
+        result = send(fd, msgp, msgsz, MSG_NOSIGNAL);
+    } while (result < 0 && errno == EINTR);
+
+    if (result != (int) msgsz) {
+        LOC_LOGE("%s:%d] socket broken %d, msgsz = %d\n", __func__, __LINE__, result, (int) msgsz);
+        return -1;
+    }
+
+    return result;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_sockrcv
+
+DESCRIPTION
+   receive every packet already queued on a connection, up to count,
+   with a single system call. Does not block.
+
+   fd - connection fd
+   msgps - array of count buffers, msgbufsz bytes each
+   lens - receives the length of each packet, or -1 for a packet that
+          did not fit its buffer
+   msgbufsz - size of each buffer
+   count - number of buffers
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   number of packets received, 0 if none was pending, or negative value
+   once the peer has hung up or the connection failed
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_sockrcv(int fd, void ** msgps, int * lens,
+                                  size_t msgbufsz, int count)
+{
+    struct mmsghdr hdrs[GLUE_SOCK_MAX_BATCH];
+    struct iovec iovs[GLUE_SOCK_MAX_BATCH];
+    int result, i;
+
+    if (count > GLUE_SOCK_MAX_BATCH) {
+        count = GLUE_SOCK_MAX_BATCH;
+    }
+
+    memset(hdrs, 0, sizeof(hdrs[0]) * count);
+    for (i = 0; i < count; i++) {
+        iovs[i].iov_base = msgps[i];
+        iovs[i].iov_len = msgbufsz;
+        hdrs[i].msg_hdr.msg_iov = &iovs[i];
+        hdrs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    do {
+        result = recvmmsg(fd, hdrs, count, MSG_DONTWAIT, NULL);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        }
+        LOC_LOGE("%s:%d] recvmmsg failed: %s\n", __func__, __LINE__, strerror(errno));
+        return -1;
+    }
+
+    for (i = 0; i < result; i++) {
+        // a zero length packet is how SOCK_SEQPACKET reports end of stream
+        if (hdrs[i].msg_len == 0) {
+            return (i > 0) ? i : -1;
+        }
+        lens[i] = (hdrs[i].msg_hdr.msg_flags & MSG_TRUNC) ? -1 : (int) hdrs[i].msg_len;
+    }
+
+    return result;
+}
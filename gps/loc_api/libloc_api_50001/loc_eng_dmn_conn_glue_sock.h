@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2016, The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOC_ENG_DMN_CONN_GLUE_SOCK_H
+#define LOC_ENG_DMN_CONN_GLUE_SOCK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <linux/types.h>
+
+int loc_eng_dmn_conn_glue_sockget(const char * sock_path, int backlog);
+int loc_eng_dmn_conn_glue_sockremove(const char * sock_path, int fd);
+int loc_eng_dmn_conn_glue_sockaccept(int fd);
+int loc_eng_dmn_conn_glue_socksnd(int fd, const void * msgp, size_t msgsz);
+int loc_eng_dmn_conn_glue_sockrcv(int fd, void ** msgps, int * lens,
+                                  size_t msgbufsz, int count);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* LOC_ENG_DMN_CONN_GLUE_SOCK_H */
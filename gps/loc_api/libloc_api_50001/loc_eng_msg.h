@@ -91,6 +91,9 @@ struct LocEngReportPosition : public LocMsg {
     const void* mLocationExt;
     const enum loc_sess_status mStatus;
     const LocPosTechMask mTechMask;
+    // LocFixLatency stamps
+    const int64_t mReportNs;
+    const int64_t mQueuedNs;
     LocEngReportPosition(LocAdapterBase* adapter,
                          UlpLocation &loc,
                          GpsLocationExtended &locExtended,
@@ -291,9 +294,14 @@ struct LocEngGetZpp : public LocMsg {
 
 struct LocEngReportGpsMeasurement : public LocMsg {
     void* mLocEng;
-    const GpsData mGpsData;
+    // one of the adapter's measurement buffers, released by proc(),
+    // or with busy NULL, a heap copy deleted along with the message
+    GpsData* const mGpsData;
+    volatile int* const mBusy;
     LocEngReportGpsMeasurement(void* locEng,
-                               GpsData &gpsData);
+                               GpsData* gpsData,
+                               volatile int* busy);
+    virtual ~LocEngReportGpsMeasurement();
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -32,14 +32,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/time.h>
-#include <pthread.h>
 #include <errno.h>
 #include <string.h>
 #include <ctype.h>
 #include <unistd.h>
 #include <time.h>
 #include <MsgTask.h>
+#include <LocTimer.h>
 
 #include <loc_eng.h>
 
@@ -54,42 +53,70 @@ using namespace loc_core;
  *
  *============================================================================*/
 
+// A pending NI request.  The 'no response' timeout is a LocTimer, which
+// only posts back to the engine thread, where the session is handled.
+class LocEngNiSession : public LocTimer {
+    loc_eng_data_s_type* mLocEng;
+public:
+    LocEngNiSession* mNext;
+    const int mReqID;
+    const bool mIsEs;
+    void* mRawRequest;
+
+    inline LocEngNiSession(loc_eng_data_s_type* locEng, int reqID, bool isEs,
+                           void* rawRequest) :
+        LocTimer(), mLocEng(locEng), mNext(NULL), mReqID(reqID),
+        mIsEs(isEs), mRawRequest(rawRequest) {}
+    inline virtual ~LocEngNiSession()
+    {
+        free(mRawRequest);
+    }
+    virtual void timeOutCallback();
+};
+
 /*=============================================================================
  *
  *                             FUNCTION DECLARATIONS
  *
  *============================================================================*/
-static void* ni_thread_proc(void *args);
-
-struct LocEngInformNiResponse : public LocMsg {
-    LocEngAdapter* mAdapter;
-    const GpsUserResponseType mResponse;
-    const void *mPayload;
-    inline LocEngInformNiResponse(LocEngAdapter* adapter,
-                                  GpsUserResponseType resp,
-                                  const void* data) :
-        LocMsg(), mAdapter(adapter),
-        mResponse(resp), mPayload(data)
+static void ni_session_respond(loc_eng_data_s_type &loc_eng_data,
+                               LocEngNiSession* pSession,
+                               GpsUserResponseType resp);
+
+struct LocEngNiTimeout : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    const int mReqID;
+    inline LocEngNiTimeout(loc_eng_data_s_type* locEng, int reqID) :
+        LocMsg(), mLocEng(locEng), mReqID(reqID)
     {
         locallog();
     }
-    inline ~LocEngInformNiResponse()
+    virtual void proc() const;
+    inline void locallog() const
+    {
+        LOC_LOGV("LocEngNiTimeout - id: %d", mReqID);
+    }
+    inline virtual void log() const
     {
-        // this is a bit weird since mPayload is not
-        // allocated by this class.  But there is no better way.
-        // mPayload actually won't be NULL here.
-        free((void*)mPayload);
+        locallog();
     }
-    inline virtual void proc() const
+};
+
+struct LocEngNiRespond : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    const int mReqID;
+    const GpsUserResponseType mResponse;
+    inline LocEngNiRespond(loc_eng_data_s_type* locEng, int reqID,
+                           GpsUserResponseType resp) :
+        LocMsg(), mLocEng(locEng), mReqID(reqID), mResponse(resp)
     {
-        mAdapter->informNiResponse(mResponse, mPayload);
+        locallog();
     }
+    virtual void proc() const;
     inline void locallog() const
     {
-        LOC_LOGV("LocEngInformNiResponse - "
-                 "response: %s\n  mPayload: %p",
-                 loc_get_ni_response_name(mResponse),
-                 mPayload);
+        LOC_LOGV("LocEngNiRespond - id: %d\n  response: %s",
+                 mReqID, loc_get_ni_response_name(mResponse));
     }
     inline virtual void log() const
     {
@@ -97,13 +124,40 @@ struct LocEngInformNiResponse : public LocMsg {
     }
 };
 
+void LocEngNiSession::timeOutCallback()
+{
+    mLocEng->adapter->sendMsg(new LocEngNiTimeout(mLocEng, mReqID));
+}
+
+static LocEngNiSession* ni_session_find(loc_eng_ni_data_s_type* loc_eng_ni_data_p,
+                                        int reqID)
+{
+    LocEngNiSession* pSession = loc_eng_ni_data_p->sessions;
+    while (NULL != pSession && pSession->mReqID != reqID) {
+        pSession = pSession->mNext;
+    }
+    return pSession;
+}
+
+static bool ni_session_es_pending(loc_eng_ni_data_s_type* loc_eng_ni_data_p)
+{
+    for (LocEngNiSession* pSession = loc_eng_ni_data_p->sessions;
+         NULL != pSession; pSession = pSession->mNext) {
+        if (pSession->mIsEs) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /*===========================================================================
 
 FUNCTION loc_eng_ni_request_handler
 
 DESCRIPTION
-   Displays the NI request and awaits user input. If a previous request is
-   in session, it is ignored.
+   Displays the NI request and awaits user input. A new SUPL NI request is
+   ignored while an emergency SUPL NI is in session, and any request is
+   ignored if LOC_NI_MAX_SESSIONS are already in session.
 
 RETURN VALUE
    none
@@ -114,47 +168,34 @@ void loc_eng_ni_request_handler(loc_eng_data_s_type &loc_eng_data,
                             const void* passThrough)
 {
     ENTRY_LOG();
-    char lcs_addr[32]; // Decoded LCS address for UMTS CP NI
     loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data.loc_eng_ni_data;
-    loc_eng_ni_session_s_type* pSession = NULL;
+    bool isEs = (notif->ni_type == GPS_NI_TYPE_EMERGENCY_SUPL);
 
     if (NULL == loc_eng_data.ni_notify_cb) {
         EXIT_LOG(%s, "loc_eng_ni_init hasn't happened yet.");
         return;
     }
 
-    if (notif->ni_type == GPS_NI_TYPE_EMERGENCY_SUPL) {
-        if (NULL != loc_eng_ni_data_p->sessionEs.rawRequest) {
-            LOC_LOGW("loc_eng_ni_request_handler, supl es NI in progress, new supl es NI ignored, type: %d",
-                     notif->ni_type);
-            if (NULL != passThrough) {
-                free((void*)passThrough);
-            }
-        } else {
-            pSession = &loc_eng_ni_data_p->sessionEs;
-        }
+    if (loc_eng_ni_data_p->numSessions >= LOC_NI_MAX_SESSIONS) {
+        LOC_LOGW("loc_eng_ni_request_handler, %d NI in progress, new NI ignored, type: %d",
+                 loc_eng_ni_data_p->numSessions, notif->ni_type);
+        free((void*)passThrough);
+    } else if (!isEs && ni_session_es_pending(loc_eng_ni_data_p)) {
+        LOC_LOGW("loc_eng_ni_request_handler, supl es NI in progress, new supl NI ignored, type: %d",
+                 notif->ni_type);
+        free((void*)passThrough);
     } else {
-        if (NULL != loc_eng_ni_data_p->session.rawRequest ||
-            NULL != loc_eng_ni_data_p->sessionEs.rawRequest) {
-            LOC_LOGW("loc_eng_ni_request_handler, supl NI in progress, new supl NI ignored, type: %d",
-                     notif->ni_type);
-            if (NULL != passThrough) {
-                free((void*)passThrough);
-            }
-        } else {
-            pSession = &loc_eng_ni_data_p->session;
-        }
-    }
-
-
-    if (pSession) {
         /* Save request */
-        pSession->rawRequest = (void*)passThrough;
-        pSession->reqID = ++loc_eng_ni_data_p->reqIDCounter;
-        pSession->adapter = loc_eng_data.adapter;
+        LocEngNiSession* pSession =
+            new LocEngNiSession(&loc_eng_data,
+                                ++loc_eng_ni_data_p->reqIDCounter,
+                                isEs, (void*)passThrough);
+        pSession->mNext = loc_eng_ni_data_p->sessions;
+        loc_eng_ni_data_p->sessions = pSession;
+        loc_eng_ni_data_p->numSessions++;
 
         /* Fill in notification */
-        ((GpsNiNotification*)notif)->notification_id = pSession->reqID;
+        ((GpsNiNotification*)notif)->notification_id = pSession->mReqID;
 
         if (notif->notify_flags == GPS_NI_PRIVACY_OVERRIDE)
         {
@@ -170,22 +211,14 @@ void loc_eng_ni_request_handler(loc_eng_data_s_type &loc_eng_data,
             LOC_LOGI("              extras: %s", notif->extras);
         }
 
-        /* For robustness, spawn a thread at this point to timeout to clear up the notification status, even though
+        /* For robustness, time out to clear up the notification status, even though
          * the OEM layer in java does not do so.
          **/
-        pSession->respTimeLeft = 5 + (notif->timeout != 0 ? notif->timeout : LOC_NI_NO_RESPONSE_TIME);
-        LOC_LOGI("Automatically sends 'no response' in %d seconds (to clear status)\n", pSession->respTimeLeft);
+        int respTimeLeft = 5 + (notif->timeout != 0 ? notif->timeout : LOC_NI_NO_RESPONSE_TIME);
+        LOC_LOGI("Automatically sends 'no response' in %d seconds (to clear status)\n", respTimeLeft);
 
-        int rc = 0;
-        rc = pthread_create(&pSession->thread, NULL, ni_thread_proc, pSession);
-        if (rc)
-        {
-            LOC_LOGE("Loc NI thread is not created.\n");
-        }
-        rc = pthread_detach(pSession->thread);
-        if (rc)
-        {
-            LOC_LOGE("Loc NI thread is not detached.\n");
+        if (!pSession->start(respTimeLeft * 1000, true)) {
+            LOC_LOGE("Loc NI timer is not started.\n");
         }
 
         CALLBACK_LOG_CALLFLOW("ni_notify_cb - id", %d, notif->notification_id);
@@ -196,76 +229,72 @@ void loc_eng_ni_request_handler(loc_eng_data_s_type &loc_eng_data,
 
 /*===========================================================================
 
-FUNCTION ni_thread_proc
+FUNCTION ni_session_respond
+
+DESCRIPTION
+   Ends the session, and sends resp to the modem unless it is
+   GPS_NI_RESPONSE_IGNORE.
 
 ===========================================================================*/
-static void* ni_thread_proc(void *args)
+static void ni_session_respond(loc_eng_data_s_type &loc_eng_data,
+                               LocEngNiSession* pSession,
+                               GpsUserResponseType resp)
 {
-    ENTRY_LOG();
-
-    loc_eng_ni_session_s_type* pSession = (loc_eng_ni_session_s_type*)args;
-    int rc = 0;          /* return code from pthread calls */
-
-    struct timeval present_time;
-    struct timespec expire_time;
+    loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data.loc_eng_ni_data;
+    LocEngNiSession** link = &loc_eng_ni_data_p->sessions;
 
-    LOC_LOGD("Starting Loc NI thread...\n");
-    pthread_mutex_lock(&pSession->tLock);
-    /* Calculate absolute expire time */
-    gettimeofday(&present_time, NULL);
-    expire_time.tv_sec  = present_time.tv_sec + pSession->respTimeLeft;
-    expire_time.tv_nsec = present_time.tv_usec * 1000;
-    LOC_LOGD("ni_thread_proc-Time out set for abs time %ld with delay %d sec\n",
-             (long) expire_time.tv_sec, pSession->respTimeLeft );
+    while (*link != pSession) {
+        link = &(*link)->mNext;
+    }
+    *link = pSession->mNext;
+    loc_eng_ni_data_p->numSessions--;
 
-    while (!pSession->respRecvd)
-    {
-        rc = pthread_cond_timedwait(&pSession->tCond,
-                                    &pSession->tLock,
-                                    &expire_time);
-        if (rc == ETIMEDOUT)
-        {
-            pSession->resp = GPS_NI_RESPONSE_NORESP;
-            LOC_LOGD("ni_thread_proc-Thread time out after valting for specified time. Ret Val %d\n",rc );
-            break;
-        }
+    LOC_LOGD("ni_session_respond: id %d, resp %d\n", pSession->mReqID, resp);
+    if (resp != GPS_NI_RESPONSE_IGNORE) {
+        loc_eng_data.adapter->informNiResponse(resp, pSession->mRawRequest);
+    } else {
+        LOC_LOGD("this is the ignore reply for SUPL ES\n");
     }
-    LOC_LOGD("ni_thread_proc-Java layer has sent us a user response and return value from "
-             "pthread_cond_timedwait = %d\n",rc );
-    pSession->respRecvd = FALSE; /* Reset the user response flag for the next session*/
-
-    LOC_LOGD("pSession->resp is %d\n",pSession->resp);
-
-    // adding this check to support modem restart, in which case, we need the thread
-    // to exit without calling sending data. We made sure that rawRequest is NULL in
-    // loc_eng_ni_reset_on_engine_restart()
-    LocEngAdapter* adapter = pSession->adapter;
-    LocEngInformNiResponse *msg = NULL;
-
-    if (NULL != pSession->rawRequest) {
-        if (pSession->resp != GPS_NI_RESPONSE_IGNORE) {
-            LOC_LOGD("pSession->resp != GPS_NI_RESPONSE_IGNORE \n");
-            msg = new LocEngInformNiResponse(adapter,
-                                             pSession->resp,
-                                             pSession->rawRequest);
-        } else {
-            LOC_LOGD("this is the ignore reply for SUPL ES\n");
-            free(pSession->rawRequest);
-        }
-        pSession->rawRequest = NULL;
+    // also stops the timer
+    delete pSession;
+}
+
+void LocEngNiTimeout::proc() const
+{
+    // the session may have been responded to in the meantime
+    LocEngNiSession* pSession =
+        ni_session_find(&mLocEng->loc_eng_ni_data, mReqID);
+    if (NULL != pSession) {
+        LOC_LOGD("LocEngNiTimeout: no response for notif %d\n", mReqID);
+        ni_session_respond(*mLocEng, pSession, GPS_NI_RESPONSE_NORESP);
     }
-    pthread_mutex_unlock(&pSession->tLock);
+}
 
-    pSession->respTimeLeft = 0;
-    pSession->reqID = 0;
+void LocEngNiRespond::proc() const
+{
+    loc_eng_ni_data_s_type* loc_eng_ni_data_p = &mLocEng->loc_eng_ni_data;
+    LocEngNiSession* pSession = ni_session_find(loc_eng_ni_data_p, mReqID);
 
-    if (NULL != msg) {
-        LOC_LOGD("ni_thread_proc: adapter->sendMsg(msg)\n");
-        adapter->sendMsg(msg);
+    if (NULL == pSession) {
+        LOC_LOGE("loc_eng_ni_respond: notif_id %d not an active session", mReqID);
+        return;
     }
 
-    EXIT_LOG(%s, VOID_RET);
-    return NULL;
+    // ignore any SUPL NI non-Es session if a SUPL NI ES is accepted
+    if (pSession->mIsEs && mResponse == GPS_NI_RESPONSE_ACCEPT) {
+        LocEngNiSession* other = loc_eng_ni_data_p->sessions;
+        while (NULL != other) {
+            LocEngNiSession* next = other->mNext;
+            if (!other->mIsEs) {
+                ni_session_respond(*mLocEng, other,
+                                   (GpsUserResponseType)GPS_NI_RESPONSE_IGNORE);
+            }
+            other = next;
+        }
+    }
+
+    LOC_LOGI("loc_eng_ni_respond: send user response %d for notif %d", mResponse, mReqID);
+    ni_session_respond(*mLocEng, pSession, mResponse);
 }
 
 void loc_eng_ni_reset_on_engine_restart(loc_eng_data_s_type &loc_eng_data)
@@ -278,30 +307,14 @@ void loc_eng_ni_reset_on_engine_restart(loc_eng_data_s_type &loc_eng_data)
         return;
     }
 
-    // only if modem has requested but then died.
-    if (NULL != loc_eng_ni_data_p->sessionEs.rawRequest) {
-        free(loc_eng_ni_data_p->sessionEs.rawRequest);
-        loc_eng_ni_data_p->sessionEs.rawRequest = NULL;
-
-        pthread_mutex_lock(&loc_eng_ni_data_p->sessionEs.tLock);
-        // the goal is to wake up ni_thread_proc
-        // and let it exit.
-        loc_eng_ni_data_p->sessionEs.respRecvd = TRUE;
-        pthread_cond_signal(&loc_eng_ni_data_p->sessionEs.tCond);
-        pthread_mutex_unlock(&loc_eng_ni_data_p->sessionEs.tLock);
-    }
-
-    if (NULL != loc_eng_ni_data_p->session.rawRequest) {
-        free(loc_eng_ni_data_p->session.rawRequest);
-        loc_eng_ni_data_p->session.rawRequest = NULL;
-
-        pthread_mutex_lock(&loc_eng_ni_data_p->session.tLock);
-        // the goal is to wake up ni_thread_proc
-        // and let it exit.
-        loc_eng_ni_data_p->session.respRecvd = TRUE;
-        pthread_cond_signal(&loc_eng_ni_data_p->session.tCond);
-        pthread_mutex_unlock(&loc_eng_ni_data_p->session.tLock);
+    // only if modem has requested but then died. The requests are
+    // dropped without a response, and late timeouts find no session.
+    while (NULL != loc_eng_ni_data_p->sessions) {
+        LocEngNiSession* pSession = loc_eng_ni_data_p->sessions;
+        loc_eng_ni_data_p->sessions = pSession->mNext;
+        delete pSession;
     }
+    loc_eng_ni_data_p->numSessions = 0;
 
     EXIT_LOG(%s, VOID_RET);
 }
@@ -334,19 +347,8 @@ void loc_eng_ni_init(loc_eng_data_s_type &loc_eng_data, GpsNiExtCallbacks *callb
         EXIT_LOG(%s, "loc_eng_ni_init: already inited.");
     } else {
         loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data.loc_eng_ni_data;
-        loc_eng_ni_data_p->sessionEs.respTimeLeft = 0;
-        loc_eng_ni_data_p->sessionEs.respRecvd = FALSE;
-        loc_eng_ni_data_p->sessionEs.rawRequest = NULL;
-        loc_eng_ni_data_p->sessionEs.reqID = 0;
-        pthread_cond_init(&loc_eng_ni_data_p->sessionEs.tCond, NULL);
-        pthread_mutex_init(&loc_eng_ni_data_p->sessionEs.tLock, NULL);
-
-        loc_eng_ni_data_p->session.respTimeLeft = 0;
-        loc_eng_ni_data_p->session.respRecvd = FALSE;
-        loc_eng_ni_data_p->session.rawRequest = NULL;
-        loc_eng_ni_data_p->session.reqID = 0;
-        pthread_cond_init(&loc_eng_ni_data_p->session.tCond, NULL);
-        pthread_mutex_init(&loc_eng_ni_data_p->session.tLock, NULL);
+        loc_eng_ni_data_p->sessions = NULL;
+        loc_eng_ni_data_p->numSessions = 0;
 
         loc_eng_data.ni_notify_cb = callbacks->notify_cb;
         EXIT_LOG(%s, VOID_RET);
@@ -373,42 +375,15 @@ void loc_eng_ni_respond(loc_eng_data_s_type &loc_eng_data,
                         int notif_id, GpsUserResponseType user_response)
 {
     ENTRY_LOG_CALLFLOW();
-    loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data.loc_eng_ni_data;
-    loc_eng_ni_session_s_type* pSession = NULL;
 
     if (NULL == loc_eng_data.ni_notify_cb) {
         EXIT_LOG(%s, "loc_eng_ni_init hasn't happened yet.");
         return;
     }
 
-    if (notif_id == loc_eng_ni_data_p->sessionEs.reqID &&
-        NULL != loc_eng_ni_data_p->sessionEs.rawRequest) {
-        pSession = &loc_eng_ni_data_p->sessionEs;
-        // ignore any SUPL NI non-Es session if a SUPL NI ES is accepted
-        if (user_response == GPS_NI_RESPONSE_ACCEPT &&
-            NULL != loc_eng_ni_data_p->session.rawRequest) {
-                pthread_mutex_lock(&loc_eng_ni_data_p->session.tLock);
-                loc_eng_ni_data_p->session.resp = GPS_NI_RESPONSE_IGNORE;
-                loc_eng_ni_data_p->session.respRecvd = TRUE;
-                pthread_cond_signal(&loc_eng_ni_data_p->session.tCond);
-                pthread_mutex_unlock(&loc_eng_ni_data_p->session.tLock);
-        }
-    } else if (notif_id == loc_eng_ni_data_p->session.reqID &&
-        NULL != loc_eng_ni_data_p->session.rawRequest) {
-        pSession = &loc_eng_ni_data_p->session;
-    }
-
-    if (pSession) {
-        LOC_LOGI("loc_eng_ni_respond: send user response %d for notif %d", user_response, notif_id);
-        pthread_mutex_lock(&pSession->tLock);
-        pSession->resp = user_response;
-        pSession->respRecvd = TRUE;
-        pthread_cond_signal(&pSession->tCond);
-        pthread_mutex_unlock(&pSession->tLock);
-    }
-    else {
-        LOC_LOGE("loc_eng_ni_respond: notif_id %d not an active session", notif_id);
-    }
+    // sessions are only touched on the engine thread
+    loc_eng_data.adapter->sendMsg(
+        new LocEngNiRespond(&loc_eng_data, notif_id, user_response));
 
     EXIT_LOG(%s, VOID_RET);
 }
@@ -37,22 +37,15 @@
 #define LOC_NI_NOTIF_KEY_ADDRESS           "Address"
 #define GPS_NI_RESPONSE_IGNORE             4
 
-typedef struct {
-    pthread_t               thread;            /* NI thread */
-    int                     respTimeLeft;       /* examine time for NI response */
-    bool                    respRecvd;   /* NI User reponse received or not from Java layer*/
-    void*                   rawRequest;
-    int                     reqID;         /* ID to check against response */
-    GpsUserResponseType     resp;
-    pthread_cond_t          tCond;
-    pthread_mutex_t         tLock;
-    LocEngAdapter*          adapter;
-} loc_eng_ni_session_s_type;
+#define LOC_NI_MAX_SESSIONS                8
+
+class LocEngNiSession;
 
+/* NI sessions only live on the engine thread */
 typedef struct {
-    loc_eng_ni_session_s_type session;    /* SUPL NI Session */
-    loc_eng_ni_session_s_type sessionEs;  /* Emergency SUPL NI Session */
-    int reqIDCounter;
+    LocEngNiSession*        sessions;      /* pending NI sessions */
+    int                     numSessions;
+    int                     reqIDCounter;
 } loc_eng_ni_data_s_type;
 
 
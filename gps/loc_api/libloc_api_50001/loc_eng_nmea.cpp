@@ -33,11 +33,98 @@
 #define GPS_PRN_END   32
 #define GLONASS_PRN_START 65
 #define GLONASS_PRN_END   96
+#define BDS_PRN_START 201
+#define BDS_PRN_END   237
+#define GAL_PRN_START 301
+#define GAL_PRN_END   336
 #include <loc_eng.h>
 #include <loc_eng_nmea.h>
 #include <math.h>
 #include "log_util.h"
 
+enum loc_nmea_sv_system_e_type {
+    NMEA_SV_SYSTEM_UNKNOWN = -1,
+    NMEA_SV_SYSTEM_GPS = 0,
+    NMEA_SV_SYSTEM_GLONASS,
+    NMEA_SV_SYSTEM_GALILEO,
+    NMEA_SV_SYSTEM_BDS,
+    NMEA_SV_SYSTEM_MAX
+};
+
+typedef struct loc_nmea_sv_system_s {
+    const char *talker;   // NMEA talker id of the constellation
+    int prnStart;
+    int prnEnd;
+    int prnOffset;        // subtracted from the PRN to get the NMEA sv id
+    bool sendEmpty;       // send a blank $xxGSV when no sv is in view
+} loc_nmea_sv_system_s_type;
+
+static const loc_nmea_sv_system_s_type nmeaSvSystems[NMEA_SV_SYSTEM_MAX] = {
+    { "GP", GPS_PRN_START,     GPS_PRN_END,     0,                 true  },
+    { "GL", GLONASS_PRN_START, GLONASS_PRN_END, 0,                 true  },
+    { "GA", GAL_PRN_START,     GAL_PRN_END,     GAL_PRN_START - 1, false },
+    { "GB", BDS_PRN_START,     BDS_PRN_END,     BDS_PRN_START - 1, false }
+};
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_get_sv_system
+
+DESCRIPTION
+   Map a PRN to the constellation it belongs to
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   index into nmeaSvSystems, or NMEA_SV_SYSTEM_UNKNOWN
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_eng_nmea_get_sv_system(int prn)
+{
+    for (int system = 0; system < NMEA_SV_SYSTEM_MAX; system++)
+    {
+        if (prn >= nmeaSvSystems[system].prnStart &&
+            prn <= nmeaSvSystems[system].prnEnd)
+        {
+            return system;
+        }
+    }
+    return NMEA_SV_SYSTEM_UNKNOWN;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_get_used_list
+
+DESCRIPTION
+   Expand a used in fix mask into a list of NMEA sv ids, bit 0 of the
+   mask being firstSvId
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   Number of sv ids put in svUsedList
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static uint32_t loc_eng_nmea_get_used_list(uint64_t mask, uint32_t firstSvId,
+                                           uint32_t *svUsedList, uint32_t maxCount)
+{
+    uint32_t svUsedCount = 0;
+    for (uint32_t svId = firstSvId; mask > 0 && svUsedCount < maxCount; svId++)
+    {
+        if (mask & 1)
+            svUsedList[svUsedCount++] = svId;
+        mask = mask >> 1;
+    }
+    return svUsedCount;
+}
+
 /*===========================================================================
 FUNCTION    loc_eng_nmea_send
 
@@ -62,6 +149,7 @@ void loc_eng_nmea_send(char *pNmea, int length, loc_eng_data_s_type *loc_eng_dat
     CALLBACK_LOG_CALLFLOW("nmea_cb", %p, pNmea);
     if (loc_eng_data_p->nmea_cb != NULL)
         loc_eng_data_p->nmea_cb(now, pNmea, length);
+    loc_eng_nmea_ring_publish(loc_eng_data_p->nmea_ring, now, pNmea, length);
     LOC_LOGD("NMEA <%s", pNmea);
 }
 
@@ -97,6 +185,83 @@ int loc_eng_nmea_put_checksum(char *pNmea, int maxSize)
     return (length + checksumLength);
 }
 
+/*===========================================================================
+FUNCTION    loc_eng_nmea_generate_gsa
+
+DESCRIPTION
+   Generate one $xxGSA sentence out of a list of used sv ids
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   false on string formatting error, true otherwise
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static bool loc_eng_nmea_generate_gsa(loc_eng_data_s_type *loc_eng_data_p,
+                                      const char *talker, char fixType,
+                                      const uint32_t *svUsedList,
+                                      uint32_t svUsedCount,
+                                      const GpsLocationExtended &locationExtended)
+{
+    char sentence[NMEA_SENTENCE_MAX_LENGTH] = {0};
+    char* pMarker = sentence;
+    int lengthRemaining = sizeof(sentence);
+    int length = 0;
+
+    length = snprintf(pMarker, lengthRemaining, "$%sGSA,A,%c,", talker, fixType);
+
+    if (length < 0 || length >= lengthRemaining)
+    {
+        LOC_LOGE("NMEA Error in string formatting");
+        return false;
+    }
+    pMarker += length;
+    lengthRemaining -= length;
+
+    for (uint8_t i = 0; i < 12; i++) // only the first 12 sv go in sentence
+    {
+        if (i < svUsedCount)
+            length = snprintf(pMarker, lengthRemaining, "%02d,", svUsedList[i]);
+        else
+            length = snprintf(pMarker, lengthRemaining, ",");
+
+        if (length < 0 || length >= lengthRemaining)
+        {
+            LOC_LOGE("NMEA Error in string formatting");
+            return false;
+        }
+        pMarker += length;
+        lengthRemaining -= length;
+    }
+
+    if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
+    {   // dop is in locationExtended, (QMI)
+        length = snprintf(pMarker, lengthRemaining, "%.1f,%.1f,%.1f",
+                          locationExtended.pdop,
+                          locationExtended.hdop,
+                          locationExtended.vdop);
+    }
+    else if (loc_eng_data_p->pdop > 0 && loc_eng_data_p->hdop > 0 && loc_eng_data_p->vdop > 0)
+    {   // dop was cached from sv report (RPC)
+        length = snprintf(pMarker, lengthRemaining, "%.1f,%.1f,%.1f",
+                          loc_eng_data_p->pdop,
+                          loc_eng_data_p->hdop,
+                          loc_eng_data_p->vdop);
+    }
+    else
+    {   // no dop
+        length = snprintf(pMarker, lengthRemaining, ",,");
+    }
+
+    length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
+    loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+    return true;
+}
+
 /*===========================================================================
 FUNCTION    loc_eng_nmea_generate_pos
 
@@ -139,20 +304,23 @@ void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p,
 
     if (generate_nmea) {
         // ------------------
-        // ------$GPGSA------
+        // ---$GPGSA/$GNGSA--
         // ------------------
 
-        uint32_t svUsedCount = 0;
-        uint32_t svUsedList[32] = {0};
-        uint32_t mask = loc_eng_data_p->sv_used_mask;
-        for (uint8_t i = 1; mask > 0 && svUsedCount < 32; i++)
-        {
-            if (mask & 1)
-                svUsedList[svUsedCount++] = i;
-            mask = mask >> 1;
-        }
+        uint32_t gpsUsedList[32] = {0};
+        uint32_t gloUsedList[32] = {0};
+        uint32_t bdsUsedList[64] = {0};
+        uint32_t gpsUsedCount = loc_eng_nmea_get_used_list(
+                loc_eng_data_p->sv_used_mask, GPS_PRN_START, gpsUsedList, 32);
+        uint32_t gloUsedCount = loc_eng_nmea_get_used_list(
+                loc_eng_data_p->glo_used_mask, GLONASS_PRN_START, gloUsedList, 32);
+        uint32_t bdsUsedCount = loc_eng_nmea_get_used_list(
+                loc_eng_data_p->bds_used_mask, 1, bdsUsedList, 64);
+        uint32_t svUsedCount = gpsUsedCount + gloUsedCount + bdsUsedCount;
         // clear the cache so they can't be used again
         loc_eng_data_p->sv_used_mask = 0;
+        loc_eng_data_p->glo_used_mask = 0;
+        loc_eng_data_p->bds_used_mask = 0;
 
         char fixType;
         if (svUsedCount == 0)
@@ -162,54 +330,32 @@ void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p,
         else
             fixType = '3'; // 3D fix
 
-        length = snprintf(pMarker, lengthRemaining, "$GPGSA,A,%c,", fixType);
-
-        if (length < 0 || length >= lengthRemaining)
+        if (gloUsedCount == 0 && bdsUsedCount == 0)
         {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        for (uint8_t i = 0; i < 12; i++) // only the first 12 sv go in sentence
-        {
-            if (i < svUsedCount)
-                length = snprintf(pMarker, lengthRemaining, "%02d,", svUsedList[i]);
-            else
-                length = snprintf(pMarker, lengthRemaining, ",");
-
-            if (length < 0 || length >= lengthRemaining)
-            {
-                LOC_LOGE("NMEA Error in string formatting");
+            // GPS only fix, keep the legacy $GPGSA
+            if (!loc_eng_nmea_generate_gsa(loc_eng_data_p, "GP", fixType,
+                                           gpsUsedList, gpsUsedCount,
+                                           locationExtended))
                 return;
-            }
-            pMarker += length;
-            lengthRemaining -= length;
-        }
-
-        if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
-        {   // dop is in locationExtended, (QMI)
-            length = snprintf(pMarker, lengthRemaining, "%.1f,%.1f,%.1f",
-                              locationExtended.pdop,
-                              locationExtended.hdop,
-                              locationExtended.vdop);
-        }
-        else if (loc_eng_data_p->pdop > 0 && loc_eng_data_p->hdop > 0 && loc_eng_data_p->vdop > 0)
-        {   // dop was cached from sv report (RPC)
-            length = snprintf(pMarker, lengthRemaining, "%.1f,%.1f,%.1f",
-                              loc_eng_data_p->pdop,
-                              loc_eng_data_p->hdop,
-                              loc_eng_data_p->vdop);
         }
         else
-        {   // no dop
-            length = snprintf(pMarker, lengthRemaining, ",,");
+        {
+            // multi constellation fix, one $GNGSA per constellation used
+            if ((gpsUsedCount > 0 &&
+                 !loc_eng_nmea_generate_gsa(loc_eng_data_p, "GN", fixType,
+                                            gpsUsedList, gpsUsedCount,
+                                            locationExtended)) ||
+                (gloUsedCount > 0 &&
+                 !loc_eng_nmea_generate_gsa(loc_eng_data_p, "GN", fixType,
+                                            gloUsedList, gloUsedCount,
+                                            locationExtended)) ||
+                (bdsUsedCount > 0 &&
+                 !loc_eng_nmea_generate_gsa(loc_eng_data_p, "GN", fixType,
+                                            bdsUsedList, bdsUsedCount,
+                                            locationExtended)))
+                return;
         }
 
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
         // ------------------
         // ------$GPVTG------
         // ------------------
@@ -586,78 +732,74 @@ void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p,
 }
 
 
-
 /*===========================================================================
-FUNCTION    loc_eng_nmea_generate_sv
+FUNCTION    loc_eng_nmea_generate_gsv
 
 DESCRIPTION
-   Generate NMEA sentences generated based on sv report
+   Generate the $xxGSV sentences of one constellation, svIndex holds the
+   positions in svStatus.sv_list of the svCount SVs belonging to it
 
 DEPENDENCIES
    NONE
 
 RETURN VALUE
-   0
+   N/A
 
 SIDE EFFECTS
    N/A
 
 ===========================================================================*/
-void loc_eng_nmea_generate_sv(loc_eng_data_s_type *loc_eng_data_p,
-                              const QcomSvStatus &svStatus, const GpsLocationExtended &locationExtended)
+static void loc_eng_nmea_generate_gsv(loc_eng_data_s_type *loc_eng_data_p,
+                                      const QcomSvStatus &svStatus,
+                                      const loc_nmea_sv_system_s_type &system,
+                                      const uint8_t *svIndex, int svCount)
 {
-    ENTRY_LOG();
-
     char sentence[NMEA_SENTENCE_MAX_LENGTH] = {0};
     char* pMarker = sentence;
     int lengthRemaining = sizeof(sentence);
     int length = 0;
-    int svCount = svStatus.num_svs;
     int sentenceCount = 0;
     int sentenceNumber = 1;
-    int svNumber = 1;
-    int gpsCount = 0;
-    int glnCount = 0;
-
-    //Count GPS SVs for saparating GPS from GLONASS and throw others
+    int svNumber = 0;
 
-    for(svNumber=1; svNumber <= svCount; svNumber++) {
-        if( (svStatus.sv_list[svNumber-1].prn >= GPS_PRN_START)&&
-            (svStatus.sv_list[svNumber-1].prn <= GPS_PRN_END) )
-        {
-            gpsCount++;
-        }
-        else if( (svStatus.sv_list[svNumber-1].prn >= GLONASS_PRN_START) &&
-                 (svStatus.sv_list[svNumber-1].prn <= GLONASS_PRN_END) )
+    if (svCount <= 0)
+    {
+        // no svs in view, so just send a blank sentence if required
+        if (system.sendEmpty)
         {
-            glnCount++;
+            snprintf(sentence, sizeof(sentence), "$%sGSV,1,1,0,", system.talker);
+            length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
+            loc_eng_nmea_send(sentence, length, loc_eng_data_p);
         }
+        return;
     }
 
-    // ------------------
-    // ------$GPGSV------
-    // ------------------
+    sentenceCount = svCount/4 + (svCount % 4 != 0);
 
-    if (gpsCount <= 0)
+    while (sentenceNumber <= sentenceCount)
     {
-        // no svs in view, so just send a blank $GPGSV sentence
-        strlcpy(sentence, "$GPGSV,1,1,0,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-    }
-    else
-    {
-        svNumber = 1;
-        sentenceNumber = 1;
-        sentenceCount = gpsCount/4 + (gpsCount % 4 != 0);
+        pMarker = sentence;
+        lengthRemaining = sizeof(sentence);
+
+        length = snprintf(pMarker, lengthRemaining, "$%sGSV,%d,%d,%02d",
+                          system.talker, sentenceCount, sentenceNumber, svCount);
+
+        if (length < 0 || length >= lengthRemaining)
+        {
+            LOC_LOGE("NMEA Error in string formatting");
+            return;
+        }
+        pMarker += length;
+        lengthRemaining -= length;
 
-        while (sentenceNumber <= sentenceCount)
+        for (int i=0; (svNumber < svCount) && (i < 4); i++, svNumber++)
         {
-            pMarker = sentence;
-            lengthRemaining = sizeof(sentence);
+            const GpsSvInfo &sv = svStatus.sv_list[svIndex[svNumber]];
 
-            length = snprintf(pMarker, lengthRemaining, "$GPGSV,%d,%d,%02d",
-                          sentenceCount, sentenceNumber, gpsCount);
+            length = snprintf(pMarker, lengthRemaining,",%02d,%02d,%03d,",
+                              sv.prn - system.prnOffset,
+                              (int)(0.5 + sv.elevation), //float to int
+                              (int)(0.5 + sv.azimuth)); //float to int
 
             if (length < 0 || length >= lengthRemaining)
             {
@@ -667,132 +809,82 @@ void loc_eng_nmea_generate_sv(loc_eng_data_s_type *loc_eng_data_p,
             pMarker += length;
             lengthRemaining -= length;
 
-            for (int i=0; (svNumber <= svCount) && (i < 4);  svNumber++)
+            if (sv.snr > 0)
             {
-                if( (svStatus.sv_list[svNumber-1].prn >= GPS_PRN_START) &&
-                    (svStatus.sv_list[svNumber-1].prn <= GPS_PRN_END) )
-                {
-                    length = snprintf(pMarker, lengthRemaining,",%02d,%02d,%03d,",
-                                  svStatus.sv_list[svNumber-1].prn,
-                                  (int)(0.5 + svStatus.sv_list[svNumber-1].elevation), //float to int
-                                  (int)(0.5 + svStatus.sv_list[svNumber-1].azimuth)); //float to int
-
-                    if (length < 0 || length >= lengthRemaining)
-                    {
-                        LOC_LOGE("NMEA Error in string formatting");
-                        return;
-                    }
-                    pMarker += length;
-                    lengthRemaining -= length;
-
-                    if (svStatus.sv_list[svNumber-1].snr > 0)
-                    {
-                        length = snprintf(pMarker, lengthRemaining,"%02d",
-                                         (int)(0.5 + svStatus.sv_list[svNumber-1].snr)); //float to int
-
-                        if (length < 0 || length >= lengthRemaining)
-                        {
-                            LOC_LOGE("NMEA Error in string formatting");
-                            return;
-                        }
-                        pMarker += length;
-                        lengthRemaining -= length;
-                    }
-
-                    i++;
-               }
+                length = snprintf(pMarker, lengthRemaining,"%02d",
+                                  (int)(0.5 + sv.snr)); //float to int
 
+                if (length < 0 || length >= lengthRemaining)
+                {
+                    LOC_LOGE("NMEA Error in string formatting");
+                    return;
+                }
+                pMarker += length;
+                lengthRemaining -= length;
             }
+        }
 
-            length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-            loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-            sentenceNumber++;
+        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
+        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        sentenceNumber++;
 
-        }  //while
+    }  //while
+}
 
-    } //if
+/*===========================================================================
+FUNCTION    loc_eng_nmea_generate_sv
 
-    // ------------------
-    // ------$GLGSV------
-    // ------------------
+DESCRIPTION
+   Generate NMEA sentences generated based on sv report
 
-    if (glnCount <= 0)
-    {
-        // no svs in view, so just send a blank $GLGSV sentence
-        strlcpy(sentence, "$GLGSV,1,1,0,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-    }
-    else
-    {
-        svNumber = 1;
-        sentenceNumber = 1;
-        sentenceCount = glnCount/4 + (glnCount % 4 != 0);
+DEPENDENCIES
+   NONE
 
-        while (sentenceNumber <= sentenceCount)
-        {
-            pMarker = sentence;
-            lengthRemaining = sizeof(sentence);
+RETURN VALUE
+   0
 
-            length = snprintf(pMarker, lengthRemaining, "$GLGSV,%d,%d,%02d",
-                          sentenceCount, sentenceNumber, glnCount);
+SIDE EFFECTS
+   N/A
 
-            if (length < 0 || length >= lengthRemaining)
-            {
-                LOC_LOGE("NMEA Error in string formatting");
-                return;
-            }
-            pMarker += length;
-            lengthRemaining -= length;
+===========================================================================*/
+void loc_eng_nmea_generate_sv(loc_eng_data_s_type *loc_eng_data_p,
+                              const QcomSvStatus &svStatus, const GpsLocationExtended &locationExtended)
+{
+    ENTRY_LOG();
 
-            for (int i=0; (svNumber <= svCount) && (i < 4);  svNumber++)
-            {
-                if( (svStatus.sv_list[svNumber-1].prn >= GLONASS_PRN_START) &&
-                    (svStatus.sv_list[svNumber-1].prn <= GLONASS_PRN_END) )      {
-
-                    length = snprintf(pMarker, lengthRemaining,",%02d,%02d,%03d,",
-                                  svStatus.sv_list[svNumber-1].prn,
-                                  (int)(0.5 + svStatus.sv_list[svNumber-1].elevation), //float to int
-                                  (int)(0.5 + svStatus.sv_list[svNumber-1].azimuth)); //float to int
-
-                    if (length < 0 || length >= lengthRemaining)
-                    {
-                        LOC_LOGE("NMEA Error in string formatting");
-                        return;
-                    }
-                    pMarker += length;
-                    lengthRemaining -= length;
-
-                    if (svStatus.sv_list[svNumber-1].snr > 0)
-                    {
-                        length = snprintf(pMarker, lengthRemaining,"%02d",
-                                         (int)(0.5 + svStatus.sv_list[svNumber-1].snr)); //float to int
-
-                        if (length < 0 || length >= lengthRemaining)
-                        {
-                            LOC_LOGE("NMEA Error in string formatting");
-                            return;
-                        }
-                        pMarker += length;
-                        lengthRemaining -= length;
-                    }
-
-                    i++;
-               }
+    uint8_t svIndex[NMEA_SV_SYSTEM_MAX][GPS_MAX_SVS];
+    int svSystemCount[NMEA_SV_SYSTEM_MAX] = {0};
+    int svCount = svStatus.num_svs;
 
-            }
+    if (svCount > GPS_MAX_SVS)
+        svCount = GPS_MAX_SVS;
 
-            length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-            loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-            sentenceNumber++;
+    // Sort the SVs into their constellations in a single pass,
+    // SVs outside of the known PRN ranges are thrown away
+    for (int svNumber = 0; svNumber < svCount; svNumber++)
+    {
+        int system = loc_eng_nmea_get_sv_system(svStatus.sv_list[svNumber].prn);
+        if (system != NMEA_SV_SYSTEM_UNKNOWN)
+        {
+            svIndex[system][svSystemCount[system]++] = (uint8_t)svNumber;
+        }
+    }
 
-        }  //while
+    // ------------------
+    // ------$xxGSV------
+    // ------------------
 
-    }//if
+    for (int system = 0; system < NMEA_SV_SYSTEM_MAX; system++)
+    {
+        loc_eng_nmea_generate_gsv(loc_eng_data_p, svStatus, nmeaSvSystems[system],
+                                  svIndex[system], svSystemCount[system]);
+    }
 
-    // cache the used in fix mask, as it will be needed to send $GPGSA
-    // during the position report
+    // cache the used in fix masks, as they will be needed to send
+    // $GPGSA/$GNGSA during the position report
     loc_eng_data_p->sv_used_mask = svStatus.gps_used_in_fix_mask;
+    loc_eng_data_p->glo_used_mask = svStatus.glo_used_in_fix_mask;
+    loc_eng_data_p->bds_used_mask = svStatus.bds_used_in_fix_mask;
 
     // For RPC, the DOP are sent during sv report, so cache them
     // now to be sent during position report.
@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2016, The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng_nmea"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <LocThread.h>
+#include <loc_eng_nmea_ring.h>
+#include "log_util.h"
+#include "platform_lib_includes.h"
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+struct loc_eng_nmea_ring_s {
+    int fd;
+    // fd reopened read-only, what readers get
+    int readerFd;
+    uint32_t mapSize;
+    loc_nmea_ring_header* header;
+    char* data;
+    // listening socket at LOC_NMEA_RING_SOCK_PATH
+    int sock;
+    LocThread server;
+};
+
+// hands the ring to every reader that connects to the socket
+class LocEngNmeaRingServer : public LocRunnable {
+    const loc_eng_nmea_ring_s_type* mRing;
+public:
+    inline LocEngNmeaRingServer(const loc_eng_nmea_ring_s_type* ring) :
+        LocRunnable(), mRing(ring) {}
+    virtual bool run();
+};
+
+static int loc_eng_nmea_ring_memfd(const char* name)
+{
+#ifdef __NR_memfd_create
+    return syscall(__NR_memfd_create, name, MFD_CLOEXEC);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+static void loc_eng_nmea_ring_copy_in(loc_eng_nmea_ring_s_type* ring, uint64_t pos,
+                                      const void* src, uint32_t len)
+{
+    uint32_t offset = (uint32_t)(pos & (ring->header->dataSize - 1));
+    uint32_t first = ring->header->dataSize - offset;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(ring->data + offset, src, first);
+    memcpy(ring->data, (const char*)src + first, len - first);
+}
+
+bool LocEngNmeaRingServer::run()
+{
+    int conn = accept4(mRing->sock, NULL, NULL, SOCK_CLOEXEC);
+    if (conn < 0) {
+        if (EINTR == errno || ECONNABORTED == errno) {
+            return true;
+        }
+        LOC_LOGE("%s: accept failed, errno %d", __func__, errno);
+        return false;
+    }
+
+    uint32_t size = mRing->mapSize;
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov;
+    struct msghdr msg;
+    iov.iov_base = &size;
+    iov.iov_len = sizeof(size);
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &mRing->readerFd, sizeof(int));
+
+    if (sendmsg(conn, &msg, MSG_NOSIGNAL) < 0) {
+        LOC_LOGW("%s: sendmsg failed, errno %d", __func__, errno);
+    }
+    close(conn);
+    return true;
+}
+
+// listens at LOC_NMEA_RING_SOCK_PATH, open to the gps group like the
+// gpsone_d sockets
+static int loc_eng_nmea_ring_listen()
+{
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOC_LOGE("%s: socket failed, errno %d", __func__, errno);
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strlcpy(addr.sun_path, LOC_NMEA_RING_SOCK_PATH, sizeof(addr.sun_path));
+    unlink(LOC_NMEA_RING_SOCK_PATH);
+    if (0 != bind(fd, (struct sockaddr*)&addr, sizeof(addr)) ||
+        0 != listen(fd, 4)) {
+        LOC_LOGE("%s: cannot listen at %s, errno %d",
+                 __func__, LOC_NMEA_RING_SOCK_PATH, errno);
+        close(fd);
+        return -1;
+    }
+
+    if (0 != chmod(LOC_NMEA_RING_SOCK_PATH, 0660)) {
+        LOC_LOGE("%s: chmod failed, errno %d", __func__, errno);
+    }
+    struct group* gps_group = getgrnam("gps");
+    if (NULL == gps_group ||
+        0 != chown(LOC_NMEA_RING_SOCK_PATH, -1, gps_group->gr_gid)) {
+        LOC_LOGE("%s: cannot hand %s to the gps group, errno %d",
+                 __func__, LOC_NMEA_RING_SOCK_PATH, errno);
+    }
+    return fd;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_ring_create
+
+DESCRIPTION
+   Create the shared memory ring NMEA sentences get published into, the
+   data area is size rounded up to a power of 2, and start handing it out
+   at LOC_NMEA_RING_SOCK_PATH
+
+DEPENDENCIES
+   memfd support in the kernel
+
+RETURN VALUE
+   the ring, NULL on failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+loc_eng_nmea_ring_s_type* loc_eng_nmea_ring_create(uint32_t size)
+{
+    uint32_t dataSize = 4096;
+    while (dataSize < size && dataSize < (1U << 24)) {
+        dataSize <<= 1;
+    }
+    uint32_t dataOffset = LOC_NMEA_RING_ALIGN(sizeof(loc_nmea_ring_header));
+    size_t mapSize = dataOffset + dataSize;
+
+    int fd = loc_eng_nmea_ring_memfd("loc_nmea_ring");
+    if (fd < 0) {
+        LOC_LOGE("%s: memfd_create failed, errno %d", __func__, errno);
+        return NULL;
+    }
+    if (ftruncate(fd, mapSize) < 0) {
+        LOC_LOGE("%s: ftruncate failed, errno %d", __func__, errno);
+        close(fd);
+        return NULL;
+    }
+    void* map = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == map) {
+        LOC_LOGE("%s: mmap failed, errno %d", __func__, errno);
+        close(fd);
+        return NULL;
+    }
+
+    // readers get a read-only fd, so that they cannot scribble on the
+    // ring; the memfd itself is read-write
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    int readerFd = open(path, O_RDONLY | O_CLOEXEC);
+    if (readerFd < 0) {
+        LOC_LOGE("%s: cannot reopen the ring read-only, errno %d", __func__, errno);
+        munmap(map, mapSize);
+        close(fd);
+        return NULL;
+    }
+
+    loc_eng_nmea_ring_s_type* ring = new loc_eng_nmea_ring_s_type;
+    ring->fd = fd;
+    ring->readerFd = readerFd;
+    ring->mapSize = mapSize;
+    ring->header = (loc_nmea_ring_header*)map;
+    ring->data = (char*)map + dataOffset;
+    ring->header->version = LOC_NMEA_RING_VERSION;
+    ring->header->dataSize = dataSize;
+    ring->header->dataOffset = dataOffset;
+    ring->header->head = 0;
+    ring->header->claim = 0;
+    ring->header->seq = 0;
+    __atomic_store_n(&ring->header->magic, LOC_NMEA_RING_MAGIC, __ATOMIC_RELEASE);
+
+    // the ring lives as long as the process, and so does its server
+    ring->sock = loc_eng_nmea_ring_listen();
+    if (ring->sock >= 0) {
+        LocEngNmeaRingServer* server = new LocEngNmeaRingServer(ring);
+        if (!ring->server.start("LocNmeaRing", server, false)) {
+            delete server;
+        }
+    }
+
+    LOC_LOGI("%s: %u bytes, readers attach at %s",
+             __func__, dataSize, LOC_NMEA_RING_SOCK_PATH);
+    return ring;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_ring_publish
+
+DESCRIPTION
+   Append one sentence to the ring, overwriting the oldest ones. Must
+   only be called from the loc_eng message thread.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_ring_publish(loc_eng_nmea_ring_s_type* ring, int64_t timestamp,
+                               const char* nmea, int length)
+{
+    if (NULL == ring || length <= 0) {
+        return;
+    }
+    if (length > LOC_NMEA_RING_MAX_SENTENCE) {
+        LOC_LOGW("%s: dropping %d bytes sentence", __func__, length);
+        return;
+    }
+
+    loc_nmea_ring_header* header = ring->header;
+    uint64_t head = header->head;
+    loc_nmea_ring_record rec;
+    rec.seq = header->seq;
+    rec.timestamp = timestamp;
+    rec.length = length;
+    rec.reserved = 0;
+
+    uint64_t next = head + LOC_NMEA_RING_ALIGN(sizeof(rec) + length);
+
+    // readers must see the claim before any byte of the new record
+    __atomic_store_n(&header->claim, next, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    loc_eng_nmea_ring_copy_in(ring, head, &rec, sizeof(rec));
+    loc_eng_nmea_ring_copy_in(ring, head + sizeof(rec), nmea, length);
+
+    __atomic_store_n(&header->seq, rec.seq + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->head, next, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2016, The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOC_ENG_NMEA_RING_H
+#define LOC_ENG_NMEA_RING_H
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Shared memory layout of the NMEA ring.
+
+   The HAL is the only writer. Readers get a read-only fd of the region
+   from LOC_NMEA_RING_SOCK_PATH, which is open to the gps group, map it
+   with loc_nmea_ring_attach() and tail it with loc_nmea_ring_read()
+   without taking any lock.
+
+   Before copying a record in, the writer moves claim past it. A reader
+   copying a record out checks claim afterwards, and throws the copy away
+   if the writer may have been overwriting it meanwhile. */
+
+#define LOC_NMEA_RING_MAGIC       0x4e4d4541 /* "NMEA" */
+#define LOC_NMEA_RING_VERSION     2
+/* longest sentence accepted into the ring */
+#define LOC_NMEA_RING_MAX_SENTENCE 1024
+
+/* Each connection to this SOCK_SEQPACKET socket gets one packet, the
+   uint32_t size of the mapping with the fd attached as SCM_RIGHTS, and
+   is closed right after. */
+#ifdef _ANDROID_
+#define LOC_NMEA_RING_SOCK_PATH "/data/misc/location/gpsone_d/nmea_ring_sock"
+#else
+#define LOC_NMEA_RING_SOCK_PATH "/tmp/nmea_ring_sock"
+#endif
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    /* size of the data area, a power of 2 */
+    uint32_t dataSize;
+    /* offset of the data area from the start of the mapping */
+    uint32_t dataOffset;
+    /* total bytes ever written, stored after a record is complete */
+    uint64_t head;
+    /* head plus the record being written, stored before it is copied in */
+    uint64_t claim;
+    /* total sentences ever written */
+    uint64_t seq;
+} loc_nmea_ring_header;
+
+typedef struct {
+    uint64_t seq;
+    /* same timestamp as given to nmea_cb */
+    int64_t  timestamp;
+    uint32_t length;
+    uint32_t reserved;
+} loc_nmea_ring_record;
+
+#define LOC_NMEA_RING_ALIGN(len) (((len) + 7) & ~7)
+/* room kept between the head and a reader, for the longest record */
+#define LOC_NMEA_RING_SLACK \
+    LOC_NMEA_RING_ALIGN(sizeof(loc_nmea_ring_record) + LOC_NMEA_RING_MAX_SENTENCE)
+
+/* Whether the mapSize bytes at hdr hold a ring this reader understands */
+static inline int loc_nmea_ring_valid(const loc_nmea_ring_header* hdr, size_t mapSize)
+{
+    return mapSize >= sizeof(*hdr) &&
+           LOC_NMEA_RING_MAGIC == __atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) &&
+           LOC_NMEA_RING_VERSION == hdr->version &&
+           0 == (hdr->dataSize & (hdr->dataSize - 1)) &&
+           hdr->dataSize > LOC_NMEA_RING_SLACK &&
+           hdr->dataOffset >= sizeof(*hdr) && hdr->dataOffset <= mapSize &&
+           mapSize - hdr->dataOffset >= hdr->dataSize;
+}
+
+/* Map the ring of the HAL read-only, through the socket at path,
+   normally LOC_NMEA_RING_SOCK_PATH.
+   Returns the header, or NULL if the HAL is not there or has no ring.
+   Unmap it with munmap(hdr, *mapSize) when done. */
+static inline const loc_nmea_ring_header* loc_nmea_ring_attach(const char* path,
+                                                               size_t* mapSize)
+{
+    struct sockaddr_un addr;
+    uint32_t size = 0;
+    int fd = -1;
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov;
+    struct msghdr msg;
+    struct cmsghdr* cmsg;
+    void* map = MAP_FAILED;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return NULL;
+    }
+    int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        return NULL;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    iov.iov_base = &size;
+    iov.iov_len = sizeof(size);
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (0 == connect(sock, (struct sockaddr*)&addr, sizeof(addr)) &&
+        (ssize_t)sizeof(size) == recvmsg(sock, &msg, MSG_CMSG_CLOEXEC)) {
+        cmsg = CMSG_FIRSTHDR(&msg);
+        if (NULL != cmsg && SOL_SOCKET == cmsg->cmsg_level &&
+            SCM_RIGHTS == cmsg->cmsg_type &&
+            CMSG_LEN(sizeof(int)) == cmsg->cmsg_len) {
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+        }
+    }
+    close(sock);
+
+    if (fd >= 0) {
+        map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+    }
+    if (MAP_FAILED == map) {
+        return NULL;
+    }
+    if (!loc_nmea_ring_valid((const loc_nmea_ring_header*)map, size)) {
+        munmap(map, size);
+        return NULL;
+    }
+    *mapSize = size;
+    return (const loc_nmea_ring_header*)map;
+}
+
+static inline void loc_nmea_ring_copy_out(const loc_nmea_ring_header* hdr,
+                                          uint64_t pos, void* dst, uint32_t len)
+{
+    const char* data = (const char*)hdr + hdr->dataOffset;
+    uint32_t offset = (uint32_t)(pos & (hdr->dataSize - 1));
+    uint32_t first = hdr->dataSize - offset;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(dst, data + offset, first);
+    memcpy((char*)dst + first, data, len - first);
+}
+
+/* Read the sentence at *cursor into buf, start with *cursor set to
+   hdr->head to tail the ring from now on.
+   Returns the sentence length, 0 if there is nothing new, or -1 if the
+   writer lapped the reader, in which case *cursor jumps to the head. */
+static inline int loc_nmea_ring_read(const loc_nmea_ring_header* hdr, uint64_t* cursor,
+                                     char* buf, uint32_t bufSize, int64_t* timestamp)
+{
+    loc_nmea_ring_record rec;
+    uint64_t head = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+
+    if (*cursor == head) {
+        return 0;
+    }
+    if (head - *cursor > hdr->dataSize - LOC_NMEA_RING_SLACK) {
+        *cursor = head;
+        return -1;
+    }
+
+    loc_nmea_ring_copy_out(hdr, *cursor, &rec, sizeof(rec));
+    // a record being overwritten may claim any length, which must not
+    // take the copy past the record, let alone the data area
+    if (rec.length > LOC_NMEA_RING_MAX_SENTENCE ||
+        LOC_NMEA_RING_ALIGN(sizeof(rec) + rec.length) > head - *cursor) {
+        *cursor = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+        return -1;
+    }
+    uint32_t len = rec.length < bufSize ? rec.length : bufSize;
+    loc_nmea_ring_copy_out(hdr, *cursor + sizeof(rec), buf, len);
+
+    // the writer may have run over the record while it was being copied;
+    // if the copies saw any of its bytes, the fence makes the claim made
+    // before them visible here
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint64_t claim = __atomic_load_n(&hdr->claim, __ATOMIC_RELAXED);
+    if (claim - *cursor > hdr->dataSize) {
+        *cursor = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+        return -1;
+    }
+
+    if (NULL != timestamp) {
+        *timestamp = rec.timestamp;
+    }
+    *cursor += LOC_NMEA_RING_ALIGN(sizeof(rec) + rec.length);
+    return (int)len;
+}
+
+/* HAL side */
+typedef struct loc_eng_nmea_ring_s loc_eng_nmea_ring_s_type;
+
+loc_eng_nmea_ring_s_type* loc_eng_nmea_ring_create(uint32_t size);
+void loc_eng_nmea_ring_publish(loc_eng_nmea_ring_s_type* ring, int64_t timestamp,
+                               const char* nmea, int length);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif // LOC_ENG_NMEA_RING_H
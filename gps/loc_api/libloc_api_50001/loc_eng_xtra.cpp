@@ -32,6 +32,13 @@
 
 #include <loc_eng.h>
 #include <MsgTask.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <LocTimer.h>
 #include "log_util.h"
 #include "platform_lib_includes.h"
 
@@ -55,27 +62,44 @@ struct LocEngRequestXtraServer : public LocMsg {
     }
 };
 
+// where the XTRA payload of a LocEngInjectXtraData lives
+typedef enum {
+    // new[]'d buffer, delete[]'d after injection
+    XTRA_DATA_HEAP,
+    // private file mapping, munmap'd after injection
+    XTRA_DATA_MAPPED
+} XtraDataStorage;
+
 struct LocEngInjectXtraData : public LocMsg {
     LocEngAdapter* mAdapter;
-    char* mData;
+    // handed over to mCache once injected
+    mutable char* mData;
     const int mLen;
+    const XtraDataStorage mStorage;
+    // if set, the data is saved there once injected; heap data only
+    LocEngXtraCache* const mCache;
+    // takes over data as is, no copy
     inline LocEngInjectXtraData(LocEngAdapter* adapter,
-                                char* data, int len):
+                                char* data, int len,
+                                XtraDataStorage storage,
+                                LocEngXtraCache* cache = NULL):
         LocMsg(), mAdapter(adapter),
-        mData(new char[len]), mLen(len)
+        mData(data), mLen(len), mStorage(storage), mCache(cache)
     {
-        memcpy((void*)mData, (void*)data, len);
         locallog();
     }
     inline ~LocEngInjectXtraData()
     {
-        delete[] mData;
-    }
-    inline virtual void proc() const {
-        mAdapter->setXtraData(mData, mLen);
+        if (XTRA_DATA_MAPPED == mStorage) {
+            munmap(mData, mLen);
+        } else {
+            delete[] mData;
+        }
     }
+    virtual void proc() const;
     inline  void locallog() const {
-        LOC_LOGV("length: %d\n  data: %p", mLen, mData);
+        LOC_LOGV("length: %d\n  data: %p, %s", mLen, mData,
+                 XTRA_DATA_MAPPED == mStorage ? "mapped" : "heap");
     }
     inline virtual void log() const {
         locallog();
@@ -101,6 +125,401 @@ struct LocEngSetXtraVersionCheck : public LocMsg {
     }
 };
 
+// a download asked for within this long is taken to be still in
+// progress, and further requests are not passed on to the framework
+#define XTRA_DOWNLOAD_TIMEOUT_MSEC (5 * 60 * 1000)
+#define XTRA_CACHE_META_SUFFIX ".meta"
+#define XTRA_CACHE_TMP_SUFFIX ".tmp"
+
+// Keeps the last XTRA data on disk along with when it was downloaded,
+// so it can be injected again after the modem or the device restarts,
+// and asks for a new download ahead of its expiry.  load() runs once
+// at init and timeOutCallback() on the timer thread, which only posts
+// to the engine thread.  save() runs on the writer thread, so that the
+// file writes and their fsync() don't hold up the engine, and posts
+// its outcome back.  Everything else runs on the engine thread.
+class LocEngXtraCache : public LocTimer {
+    loc_eng_data_s_type* mLocEng;
+    // writes the cache files, one download after the other
+    const MsgTask* mWriter;
+    char mPath[LOC_MAX_PARAM_STRING];
+    const uint32_t mValiditySec;
+    const uint32_t mPrefetchSec;
+    // when the cached data was downloaded, UTC seconds, 0 if none
+    uint32_t mDownloadTime;
+    // some XTRA data went to the modem since it last came up
+    bool mInjectedSinceUp;
+    // cached data is about to expire
+    bool mPrefetchDue;
+    // when a download was last asked for, 0 if none is pending
+    int64_t mDownloadRequestMs;
+    uint32_t mCacheInjections;
+    uint32_t mDownloads;
+    uint32_t mDedupedRequests;
+
+    void arm();
+    void requestDownload(const char* reason);
+    bool isDataConnUp() const;
+public:
+    LocEngXtraCache(loc_eng_data_s_type* locEng, const char* path,
+                    uint32_t validitySec, uint32_t prefetchSec);
+
+    void load();
+    bool isValid() const;
+    bool injectCached();
+    // writes data downloaded at downloadTime into the cache files, and
+    // posts the outcome to onSaved(); touches nothing but the files
+    void save(const char* data, int length, uint32_t downloadTime);
+
+    void onXtraRequested();
+    // takes over data, a new[]'d buffer
+    void onInjected(char* data, int length);
+    void onInjectFailed();
+    void onSaved(bool saved, uint32_t downloadTime);
+    void onEngineUp();
+    void onDataConnUp();
+    void onPrefetchDue();
+    virtual void timeOutCallback();
+};
+
+typedef enum {
+    XTRA_CACHE_PREFETCH_DUE,
+    XTRA_CACHE_DATA_CONN_UP
+} XtraCacheEvent;
+
+struct LocEngXtraCacheEvent : public LocMsg {
+    LocEngXtraCache* mCache;
+    const XtraCacheEvent mEvent;
+    inline LocEngXtraCacheEvent(LocEngXtraCache* cache,
+                                XtraCacheEvent event) :
+        LocMsg(), mCache(cache), mEvent(event)
+    {
+        locallog();
+    }
+    inline virtual void proc() const {
+        switch (mEvent) {
+        case XTRA_CACHE_PREFETCH_DUE:
+            mCache->onPrefetchDue();
+            break;
+        case XTRA_CACHE_DATA_CONN_UP:
+            mCache->onDataConnUp();
+            break;
+        }
+    }
+    inline void locallog() const {
+        LOC_LOGV("LocEngXtraCacheEvent: event %d", mEvent);
+    }
+    inline virtual void log() const {
+        locallog();
+    }
+};
+
+// saves injected XTRA data, on the writer thread
+struct LocEngXtraSave : public LocMsg {
+    LocEngXtraCache* mCache;
+    char* mData;
+    const int mLen;
+    const uint32_t mDownloadTime;
+    inline LocEngXtraSave(LocEngXtraCache* cache, char* data,
+                          int len, uint32_t downloadTime) :
+        LocMsg(), mCache(cache), mData(data), mLen(len),
+        mDownloadTime(downloadTime)
+    {
+        locallog();
+    }
+    inline ~LocEngXtraSave()
+    {
+        delete[] mData;
+    }
+    inline virtual void proc() const {
+        mCache->save(mData, mLen, mDownloadTime);
+    }
+    inline void locallog() const {
+        LOC_LOGV("LocEngXtraSave: %d bytes downloaded at %u",
+                 mLen, mDownloadTime);
+    }
+    inline virtual void log() const {
+        locallog();
+    }
+};
+
+// the outcome of a LocEngXtraSave, back on the engine thread
+struct LocEngXtraSaved : public LocMsg {
+    LocEngXtraCache* mCache;
+    const bool mSaved;
+    const uint32_t mDownloadTime;
+    inline LocEngXtraSaved(LocEngXtraCache* cache, bool saved,
+                           uint32_t downloadTime) :
+        LocMsg(), mCache(cache), mSaved(saved), mDownloadTime(downloadTime)
+    {
+        locallog();
+    }
+    inline virtual void proc() const {
+        mCache->onSaved(mSaved, mDownloadTime);
+    }
+    inline void locallog() const {
+        LOC_LOGV("LocEngXtraSaved: %s, downloaded at %u",
+                 mSaved ? "saved" : "not saved", mDownloadTime);
+    }
+    inline virtual void log() const {
+        locallog();
+    }
+};
+
+// asks the framework for XTRA data
+static void xtraRequestDownload(loc_eng_xtra_data_s_type* locEngXtra)
+{
+    if (locEngXtra->download_request_cb != NULL) {
+        CALLBACK_LOG_CALLFLOW("download_request_cb", %p, locEngXtra);
+        locEngXtra->download_request_cb();
+    } else {
+        LOC_LOGE("Callback function for request xtra is NULL");
+    }
+}
+
+// writes data to path through a temporary file, so that readers see
+// either the old or the new content
+static bool xtraWriteFile(const char* path, const char* data, size_t length)
+{
+    char tmpPath[LOC_MAX_PARAM_STRING + sizeof(XTRA_CACHE_TMP_SUFFIX)];
+    snprintf(tmpPath, sizeof(tmpPath), "%s" XTRA_CACHE_TMP_SUFFIX, path);
+
+    int fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        LOC_LOGE("%s: cannot create %s, %s", __func__, tmpPath, strerror(errno));
+        return false;
+    }
+
+    bool ok = true;
+    while (ok && length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && EINTR != errno) {
+            LOC_LOGE("%s: cannot write %s, %s", __func__, tmpPath, strerror(errno));
+            ok = false;
+        } else if (written > 0) {
+            data += written;
+            length -= written;
+        }
+    }
+    ok = (0 == fsync(fd)) && ok;
+    close(fd);
+
+    if (ok && 0 != rename(tmpPath, path)) {
+        LOC_LOGE("%s: cannot rename %s, %s", __func__, tmpPath, strerror(errno));
+        ok = false;
+    }
+    if (!ok) {
+        unlink(tmpPath);
+    }
+    return ok;
+}
+
+LocEngXtraCache::LocEngXtraCache(loc_eng_data_s_type* locEng,
+                                 const char* path,
+                                 uint32_t validitySec,
+                                 uint32_t prefetchSec) :
+    LocTimer(), mLocEng(locEng), mWriter(new MsgTask("LocXtraWriter", false)),
+    mValiditySec(validitySec),
+    mPrefetchSec(prefetchSec < validitySec ? prefetchSec : validitySec),
+    mDownloadTime(0), mInjectedSinceUp(false), mPrefetchDue(false),
+    mDownloadRequestMs(0), mCacheInjections(0), mDownloads(0),
+    mDedupedRequests(0)
+{
+    strlcpy(mPath, path, sizeof(mPath));
+}
+
+void LocEngXtraCache::load()
+{
+    char metaPath[LOC_MAX_PARAM_STRING + sizeof(XTRA_CACHE_META_SUFFIX)];
+    uint32_t downloadTime = 0;
+    uint32_t size = 0;
+    loc_param_s_type metaTable[] =
+    {
+        {"XTRA_DOWNLOAD_TIME", &downloadTime, NULL, 'n'},
+        {"XTRA_SIZE",          &size,         NULL, 'n'},
+    };
+    struct stat st;
+
+    snprintf(metaPath, sizeof(metaPath), "%s" XTRA_CACHE_META_SUFFIX, mPath);
+    UTIL_READ_CONF(metaPath, metaTable);
+
+    if (0 != downloadTime && 0 == stat(mPath, &st) && st.st_size == size) {
+        mDownloadTime = downloadTime;
+        LOC_LOGD("%s: %s, %u bytes downloaded at %u, %s", __func__, mPath,
+                 size, downloadTime, isValid() ? "valid" : "expired");
+        arm();
+    } else {
+        LOC_LOGD("%s: no usable XTRA data in %s", __func__, mPath);
+    }
+}
+
+bool LocEngXtraCache::isValid() const
+{
+    uint32_t now = (uint32_t)time(NULL);
+    // until the system time is right, we cannot tell
+    return 0 != mDownloadTime && now >= mDownloadTime &&
+           now - mDownloadTime < mValiditySec;
+}
+
+// arms the timer for the prefetch point of the cached data
+void LocEngXtraCache::arm()
+{
+    uint32_t now = (uint32_t)time(NULL);
+    uint32_t prefetchTime = mDownloadTime + mValiditySec - mPrefetchSec;
+
+    stop();
+    if (now >= mDownloadTime && now < prefetchTime) {
+        // LocTimer counts in ms with 32 bits, a bit over 49 days
+        uint32_t delaySec = prefetchTime - now;
+        if (delaySec > UINT32_MAX / 1000) {
+            delaySec = UINT32_MAX / 1000;
+        }
+        mPrefetchDue = false;
+        start(delaySec * 1000, false);
+    } else {
+        onPrefetchDue();
+    }
+}
+
+void LocEngXtraCache::save(const char* data, int length,
+                           uint32_t downloadTime)
+{
+    // the data first, so that the meta file never describes data
+    // that isn't there
+    bool saved = xtraWriteFile(mPath, data, length);
+    if (saved) {
+        char metaPath[LOC_MAX_PARAM_STRING + sizeof(XTRA_CACHE_META_SUFFIX)];
+        char meta[64];
+        snprintf(metaPath, sizeof(metaPath), "%s" XTRA_CACHE_META_SUFFIX, mPath);
+        int len = snprintf(meta, sizeof(meta),
+                           "XTRA_DOWNLOAD_TIME=%u\nXTRA_SIZE=%d\n",
+                           downloadTime, length);
+        xtraWriteFile(metaPath, meta, len);
+    }
+    mLocEng->adapter->sendMsg(
+        new LocEngXtraSaved(this, saved, downloadTime));
+}
+
+bool LocEngXtraCache::injectCached()
+{
+    if (!isValid() || 0 != loc_eng_xtra_inject_file(*mLocEng, mPath)) {
+        return false;
+    }
+    mInjectedSinceUp = true;
+    mCacheInjections++;
+    LOC_LOGD("%s: injected %s downloaded at %u, %u times so far",
+             __func__, mPath, mDownloadTime, mCacheInjections);
+    return true;
+}
+
+bool LocEngXtraCache::isDataConnUp() const
+{
+    return (NULL != mLocEng->internet_nif &&
+            mLocEng->internet_nif->isRsrcAcquired()) ||
+           (NULL != mLocEng->agnss_nif &&
+            mLocEng->agnss_nif->isRsrcAcquired());
+}
+
+void LocEngXtraCache::requestDownload(const char* reason)
+{
+    int64_t nowMs = elapsedMillisSinceBoot();
+    if (0 != mDownloadRequestMs &&
+        nowMs - mDownloadRequestMs < XTRA_DOWNLOAD_TIMEOUT_MSEC) {
+        mDedupedRequests++;
+        LOC_LOGD("%s: %s, download already pending for %lld ms, "
+                 "%u requests deduplicated", __func__, reason,
+                 (long long)(nowMs - mDownloadRequestMs), mDedupedRequests);
+        return;
+    }
+
+    mDownloadRequestMs = nowMs;
+    mDownloads++;
+    LOC_LOGD("%s: %s, download %u", __func__, reason, mDownloads);
+    xtraRequestDownload(&mLocEng->xtra_module_data);
+}
+
+void LocEngXtraCache::onXtraRequested()
+{
+    // the modem lost its XTRA data, restarting, give it ours if still
+    // good.  If it already had it, it does want fresh data.
+    if (mInjectedSinceUp || !injectCached()) {
+        requestDownload("modem request");
+    }
+}
+
+void LocEngXtraCache::onInjected(char* data, int length)
+{
+    mDownloadRequestMs = 0;
+    mInjectedSinceUp = true;
+    mWriter->sendMsg(new LocEngXtraSave(this, data, length,
+                                        (uint32_t)time(NULL)));
+}
+
+void LocEngXtraCache::onInjectFailed()
+{
+    // the download is over, let the modem ask again right away
+    mDownloadRequestMs = 0;
+}
+
+void LocEngXtraCache::onSaved(bool saved, uint32_t downloadTime)
+{
+    if (!saved) {
+        // the cache file still has older data, leave it to the modem
+        // to ask again
+        stop();
+        mPrefetchDue = false;
+        return;
+    }
+
+    mDownloadTime = downloadTime;
+    arm();
+}
+
+void LocEngXtraCache::onEngineUp()
+{
+    mInjectedSinceUp = false;
+    injectCached();
+}
+
+void LocEngXtraCache::onDataConnUp()
+{
+    if (mPrefetchDue) {
+        requestDownload("prefetch");
+    }
+}
+
+void LocEngXtraCache::onPrefetchDue()
+{
+    mPrefetchDue = true;
+    if (isDataConnUp()) {
+        requestDownload("prefetch");
+    }
+}
+
+void LocEngXtraCache::timeOutCallback()
+{
+    mLocEng->adapter->sendMsg(
+        new LocEngXtraCacheEvent(this, XTRA_CACHE_PREFETCH_DUE));
+}
+
+void LocEngInjectXtraData::proc() const
+{
+    enum loc_api_adapter_err status = mAdapter->setXtraData(mData, mLen);
+    if (LOC_API_ADAPTER_ERR_SUCCESS != status) {
+        // not what the modem has, so not worth keeping either
+        LOC_LOGE("%s: injection of %d bytes failed, status %d",
+                 __func__, mLen, status);
+        if (NULL != mCache) {
+            mCache->onInjectFailed();
+        }
+    } else if (NULL != mCache) {
+        // the modem has the data already, the cache writes it out on
+        // its own thread
+        mCache->onInjected(mData, mLen);
+        mData = NULL;
+    }
+}
+
 /*===========================================================================
 FUNCTION    loc_eng_xtra_init
 
@@ -131,6 +550,16 @@ int loc_eng_xtra_init (loc_eng_data_s_type &loc_eng_data,
         xtra_module_data_ptr->download_request_cb = callbacks->download_request_cb;
         xtra_module_data_ptr->report_xtra_server_cb = callbacks->report_xtra_server_cb;
 
+        if (NULL == xtra_module_data_ptr->cache &&
+            '\0' != gps_conf.XTRA_CACHE_FILE[0] &&
+            0 != gps_conf.XTRA_CACHE_VALIDITY) {
+            xtra_module_data_ptr->cache =
+                new LocEngXtraCache(&loc_eng_data, gps_conf.XTRA_CACHE_FILE,
+                                    gps_conf.XTRA_CACHE_VALIDITY * 3600,
+                                    gps_conf.XTRA_PREFETCH_MARGIN * 3600);
+            xtra_module_data_ptr->cache->load();
+        }
+
         ret_val = 0;
     }
     EXIT_LOG(%d, ret_val);
@@ -142,6 +571,10 @@ FUNCTION    loc_eng_xtra_inject_data
 
 DESCRIPTION
    Injects XTRA file into the engine but buffers the data if engine is busy.
+   The caller keeps its buffer, so the data is copied once, as it always
+   has been, and the copy handed to loc_eng_xtra_inject_data_owned().
+   Only loc_eng_xtra_inject_fd() and loc_eng_xtra_inject_file(), which
+   map the file, do without the copy.
 
 DEPENDENCIES
    N/A
@@ -155,13 +588,132 @@ SIDE EFFECTS
 ===========================================================================*/
 int loc_eng_xtra_inject_data(loc_eng_data_s_type &loc_eng_data,
                              char* data, int length)
+{
+    ENTRY_LOG();
+    char* copy = new char[length];
+    memcpy(copy, data, length);
+    int ret_val = loc_eng_xtra_inject_data_owned(loc_eng_data, copy, length);
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_inject_data_owned
+
+DESCRIPTION
+   Injects XTRA data without copying it again. The engine takes over the
+   buffer, which must have been allocated with new char[], and frees it
+   once the data is injected. With XTRA_CACHE_FILE configured, the data
+   is saved there after it has been injected, on a thread of the cache's
+   own.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_xtra_inject_data_owned(loc_eng_data_s_type &loc_eng_data,
+                                   char* data, int length)
 {
     ENTRY_LOG();
     LocEngAdapter* adapter = loc_eng_data.adapter;
-    adapter->sendMsg(new LocEngInjectXtraData(adapter, data, length));
+    adapter->sendMsg(new LocEngInjectXtraData(adapter, data, length,
+                                              XTRA_DATA_HEAP,
+                                              loc_eng_data.xtra_module_data.cache));
     EXIT_LOG(%d, 0);
     return 0;
 }
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_inject_fd
+
+DESCRIPTION
+   Injects the XTRA file open on fd. The file is mapped rather than read,
+   so its pages are only brought in while the modem is being fed, and
+   stay reclaimable. fd can be closed once this returns.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0: success
+   -1: the file could not be mapped, or its size is out of range
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_xtra_inject_fd(loc_eng_data_s_type &loc_eng_data, int fd)
+{
+    ENTRY_LOG();
+    int ret_val = -1;
+    struct stat st;
+
+    if (0 != fstat(fd, &st)) {
+        LOC_LOGE("%s: fstat failed, %s", __func__, strerror(errno));
+    } else if (st.st_size <= 0 || st.st_size > XTRA_DATA_MAX_SIZE) {
+        LOC_LOGE("%s: bad XTRA file size %lld",
+                 __func__, (long long)st.st_size);
+    } else {
+        // private and writable, in case the LocApi scribbles on the
+        // data, which must not make it to the file.
+        void* data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == data) {
+            LOC_LOGE("%s: mmap failed, %s", __func__, strerror(errno));
+        } else {
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+            LocEngAdapter* adapter = loc_eng_data.adapter;
+            adapter->sendMsg(new LocEngInjectXtraData(adapter, (char*)data,
+                                                      (int)st.st_size,
+                                                      XTRA_DATA_MAPPED));
+            ret_val = 0;
+        }
+    }
+
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_inject_file
+
+DESCRIPTION
+   Injects the XTRA file at path, see loc_eng_xtra_inject_fd().
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0: success
+   -1: the file could not be opened or mapped
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_xtra_inject_file(loc_eng_data_s_type &loc_eng_data,
+                             const char* path)
+{
+    ENTRY_LOG();
+    int ret_val = -1;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        LOC_LOGE("%s: cannot open %s, %s", __func__, path, strerror(errno));
+    } else {
+        ret_val = loc_eng_xtra_inject_fd(loc_eng_data, fd);
+        close(fd);
+    }
+
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
 /*===========================================================================
 FUNCTION    loc_eng_xtra_request_server
 
@@ -211,3 +763,87 @@ void loc_eng_xtra_version_check(loc_eng_data_s_type &loc_eng_data,
     adapter->sendMsg(new LocEngSetXtraVersionCheck(adapter, check));
     EXIT_LOG(%d, 0);
 }
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_handle_request
+
+DESCRIPTION
+   Handles an XTRA data request from the modem, by injecting the cached
+   data if the modem may have lost it, or else asking the framework to
+   download new data, once.
+
+DEPENDENCIES
+   Runs on the engine thread
+
+RETURN VALUE
+   none
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_xtra_handle_request(loc_eng_data_s_type &loc_eng_data)
+{
+    ENTRY_LOG();
+    loc_eng_xtra_data_s_type* locEngXtra = &loc_eng_data.xtra_module_data;
+
+    if (NULL != locEngXtra->cache) {
+        locEngXtra->cache->onXtraRequested();
+    } else {
+        xtraRequestDownload(locEngXtra);
+    }
+    EXIT_LOG(%s, VOID_RET);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_handle_engine_up
+
+DESCRIPTION
+   Injects the cached XTRA data, if still valid, into the restarted modem.
+
+DEPENDENCIES
+   Runs on the engine thread
+
+RETURN VALUE
+   none
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_xtra_handle_engine_up(loc_eng_data_s_type &loc_eng_data)
+{
+    ENTRY_LOG();
+    if (NULL != loc_eng_data.xtra_module_data.cache) {
+        loc_eng_data.xtra_module_data.cache->onEngineUp();
+    }
+    EXIT_LOG(%s, VOID_RET);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_data_conn_up
+
+DESCRIPTION
+   Tells XTRA a data connection just came up, so a due prefetch can go
+   ahead.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   none
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_xtra_data_conn_up(loc_eng_data_s_type &loc_eng_data)
+{
+    ENTRY_LOG();
+    LocEngXtraCache* cache = loc_eng_data.xtra_module_data.cache;
+    if (NULL != cache) {
+        loc_eng_data.adapter->sendMsg(
+            new LocEngXtraCacheEvent(cache, XTRA_CACHE_DATA_CONN_UP));
+    }
+    EXIT_LOG(%s, VOID_RET);
+}
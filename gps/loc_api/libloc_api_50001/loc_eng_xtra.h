@@ -32,6 +32,8 @@
 
 #include <hardware/gps.h>
 
+class LocEngXtraCache;
+
 // Module data
 typedef struct
 {
@@ -42,6 +44,9 @@ typedef struct
    // XTRA data buffer
    char                          *xtra_data_for_injection;  // NULL if no pending data
    int                            xtra_data_len;
+
+   // on disk copy of the last XTRA data, NULL if not configured
+   LocEngXtraCache               *cache;
 } loc_eng_xtra_data_s_type;
 
 #endif // LOC_ENG_XTRA_H
@@ -0,0 +1,51 @@
+#
+# Copyright (C) 2016 The CyanogenMod Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+LOCAL_PATH := $(call my-dir)
+
+# AGPS subscriber bookkeeping
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    loc_eng_agps_test.cpp
+
+LOCAL_CFLAGS += \
+    -fno-short-enums \
+    -D_ANDROID_
+
+ifeq ($(QCPATH),)
+LOCAL_CFLAGS += -DOSS_BUILD
+endif
+
+LOCAL_C_INCLUDES := \
+    $(TARGET_OUT_HEADERS)/gps.utils \
+    $(TARGET_OUT_HEADERS)/libloc_core \
+    $(LOCAL_PATH)/.. \
+    $(TARGET_OUT_HEADERS)/libflp
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils \
+    liblog \
+    libloc_eng \
+    libloc_core \
+    libgps.utils
+
+LOCAL_MODULE := libloc_eng_agps_test
+LOCAL_MODULE_OWNER := qcom
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_NATIVE_TEST)
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2016, The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "loc_eng_agps_test"
+
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+#include <loc_eng_agps.h>
+
+// ATL handles and WIFI sender ids are numbered independently, so the
+// same id shows up under both types on a busy modem
+#define SUBSCRIBER_COUNT 64
+
+static int sNotified[SUBSCRIBER_DS + 1];
+static int sDeleted[SUBSCRIBER_DS + 1];
+static int sRequests;
+static int sReleases;
+
+/*
+ * Stands in for ATLSubscriber and WIFISubscriber, which report back to
+ * the modem and the daemons. Like WIFISubscriber, a subscriber that
+ * waits for close complete can go inactive.
+ */
+struct TestSubscriber : public Subscriber {
+    const bool mWaitForClose;
+    bool mIsInactive;
+
+    inline TestSubscriber(int id, SubscriberType type,
+                          const AgpsStateMachine* stateMachine = NULL) :
+        Subscriber(id, type, stateMachine),
+        mWaitForClose(SUBSCRIBER_WIFI == type), mIsInactive(false) {}
+    inline virtual ~TestSubscriber() { sDeleted[mType]++; }
+
+    inline virtual void setIPAddresses(uint32_t &v4, char* v6) {}
+    inline virtual void setIPAddresses(struct sockaddr_storage& addr) {}
+
+    virtual bool notifyRsrcStatus(Notification &notification)
+    {
+        bool notify = forMe(notification);
+        if (notify) {
+            switch (notification.rsrcStatus) {
+            case RSRC_UNSUBSCRIBE:
+            case RSRC_RELEASED:
+            case RSRC_DENIED:
+            case RSRC_GRANTED:
+                sNotified[mType]++;
+                break;
+            default:
+                notify = false;
+            }
+        }
+        return notify;
+    }
+
+    inline virtual bool waitForCloseComplete() { return mWaitForClose; }
+    inline virtual void setInactive() { mIsInactive = true; }
+    inline virtual bool isInactive() { return mIsInactive; }
+
+    inline virtual Subscriber* clone()
+    {
+        return new TestSubscriber(ID, mType, mStateMachine);
+    }
+};
+
+static void agpsStatusCb(AGpsStatus* status)
+{
+    if (GPS_REQUEST_AGPS_DATA_CONN == status->status) {
+        sRequests++;
+    } else if (GPS_RELEASE_AGPS_DATA_CONN == status->status) {
+        sReleases++;
+    }
+}
+
+class AgpsSubscriberListTest : public ::testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        memset(sNotified, 0, sizeof(sNotified));
+        memset(sDeleted, 0, sizeof(sDeleted));
+        sRequests = 0;
+        sReleases = 0;
+    }
+
+    // ATL and WIFI subscribers with ids 0 to SUBSCRIBER_COUNT - 1,
+    // interleaved
+    void addAll(AgpsSubscriberList& list)
+    {
+        for (int id = 0; id < SUBSCRIBER_COUNT; id++) {
+            list.add(new TestSubscriber(id, SUBSCRIBER_ATL));
+            list.add(new TestSubscriber(id, SUBSCRIBER_WIFI));
+        }
+    }
+};
+
+TEST_F(AgpsSubscriberListTest, SameIdDifferentType) {
+    AgpsSubscriberList list;
+    addAll(list);
+    EXPECT_EQ(2u * SUBSCRIBER_COUNT, list.size());
+
+    for (int id = 0; id < SUBSCRIBER_COUNT; id++) {
+        TestSubscriber atl(id, SUBSCRIBER_ATL), wifi(id, SUBSCRIBER_WIFI);
+        Subscriber* found = list.find(&atl);
+        ASSERT_TRUE(NULL != found);
+        EXPECT_EQ(SUBSCRIBER_ATL, found->mType);
+        EXPECT_EQ((uint32_t)id, found->ID);
+        found = list.find(&wifi);
+        ASSERT_TRUE(NULL != found);
+        EXPECT_EQ(SUBSCRIBER_WIFI, found->mType);
+        EXPECT_EQ((uint32_t)id, found->ID);
+    }
+
+    TestSubscriber missing(SUBSCRIBER_COUNT, SUBSCRIBER_ATL);
+    TestSubscriber otherType(0, SUBSCRIBER_DS);
+    EXPECT_TRUE(NULL == list.find(&missing));
+    EXPECT_TRUE(NULL == list.find(&otherType));
+}
+
+TEST_F(AgpsSubscriberListTest, NotifyTarget) {
+    AgpsSubscriberList list;
+    addAll(list);
+
+    // only the WIFI subscriber with that id hears of it, and goes
+    TestSubscriber wifi(7, SUBSCRIBER_WIFI);
+    Notification notification(&wifi, RSRC_RELEASED, true);
+    list.notify(notification);
+    EXPECT_EQ(0, sNotified[SUBSCRIBER_ATL]);
+    EXPECT_EQ(1, sNotified[SUBSCRIBER_WIFI]);
+    EXPECT_EQ(1, sDeleted[SUBSCRIBER_WIFI]);
+    EXPECT_TRUE(NULL == list.find(&wifi));
+
+    TestSubscriber atl(7, SUBSCRIBER_ATL);
+    EXPECT_TRUE(NULL != list.find(&atl));
+    EXPECT_EQ(2u * SUBSCRIBER_COUNT - 1, list.size());
+}
+
+TEST_F(AgpsSubscriberListTest, NotifyDeletesWhileIterating) {
+    AgpsSubscriberList list;
+    addAll(list);
+
+    // every subscriber is visited once, and deleted on the way
+    Notification notification(Notification::BROADCAST_ALL, RSRC_RELEASED, true);
+    list.notify(notification);
+    EXPECT_EQ(SUBSCRIBER_COUNT, sNotified[SUBSCRIBER_ATL]);
+    EXPECT_EQ(SUBSCRIBER_COUNT, sNotified[SUBSCRIBER_WIFI]);
+    EXPECT_EQ(SUBSCRIBER_COUNT, sDeleted[SUBSCRIBER_ATL]);
+    EXPECT_EQ(SUBSCRIBER_COUNT, sDeleted[SUBSCRIBER_WIFI]);
+    EXPECT_TRUE(list.empty());
+
+    // and the list is good for more
+    addAll(list);
+    EXPECT_EQ(2u * SUBSCRIBER_COUNT, list.size());
+}
+
+TEST_F(AgpsSubscriberListTest, Deactivate) {
+    AgpsSubscriberList list;
+    addAll(list);
+
+    for (int id = 0; id < SUBSCRIBER_COUNT; id++) {
+        TestSubscriber wifi(id, SUBSCRIBER_WIFI);
+        list.deactivate(list.find(&wifi));
+    }
+
+    // the active ones are all at the front now
+    Notification active(Notification::BROADCAST_ACTIVE);
+    Subscriber* first = list.findFirst(active);
+    ASSERT_TRUE(NULL != first);
+    EXPECT_EQ(SUBSCRIBER_ATL, first->mType);
+    EXPECT_EQ(0u, first->ID);
+
+    // deactivating the last one leaves it where it is
+    TestSubscriber last(SUBSCRIBER_COUNT - 1, SUBSCRIBER_WIFI);
+    list.deactivate(list.find(&last));
+    EXPECT_EQ(2u * SUBSCRIBER_COUNT, list.size());
+
+    memset(sDeleted, 0, sizeof(sDeleted));
+    Notification inactive(Notification::BROADCAST_INACTIVE, RSRC_RELEASED, true);
+    list.notify(inactive);
+    EXPECT_EQ(0, sNotified[SUBSCRIBER_ATL]);
+    EXPECT_EQ(SUBSCRIBER_COUNT, sDeleted[SUBSCRIBER_WIFI]);
+    EXPECT_EQ((unsigned int)SUBSCRIBER_COUNT, list.size());
+    EXPECT_TRUE(NULL != list.findFirst(active));
+}
+
+TEST_F(AgpsSubscriberListTest, StateMachine) {
+    AgpsStateMachine stateMachine(servicerTypeAgps, (void*)agpsStatusCb,
+                                  AGPS_TYPE_SUPL, false);
+
+    // duplicates are not added again, and one request covers them all
+    for (int id = 0; id < SUBSCRIBER_COUNT; id++) {
+        TestSubscriber atl(id, SUBSCRIBER_ATL, &stateMachine);
+        TestSubscriber wifi(id, SUBSCRIBER_WIFI, &stateMachine);
+        stateMachine.subscribeRsrc(&atl);
+        stateMachine.subscribeRsrc(&wifi);
+        stateMachine.subscribeRsrc(&atl);
+    }
+    EXPECT_EQ(1, sRequests);
+
+    memset(sNotified, 0, sizeof(sNotified));
+    stateMachine.onRsrcEvent(RSRC_GRANTED);
+    EXPECT_EQ(SUBSCRIBER_COUNT, sNotified[SUBSCRIBER_ATL]);
+    EXPECT_EQ(SUBSCRIBER_COUNT, sNotified[SUBSCRIBER_WIFI]);
+
+    // ATL subscribers go right away, WIFI ones wait for close complete
+    memset(sNotified, 0, sizeof(sNotified));
+    for (int id = 0; id < SUBSCRIBER_COUNT; id++) {
+        TestSubscriber atl(id, SUBSCRIBER_ATL, &stateMachine);
+        TestSubscriber wifi(id, SUBSCRIBER_WIFI, &stateMachine);
+        EXPECT_TRUE(stateMachine.unsubscribeRsrc(&atl));
+        EXPECT_FALSE(stateMachine.unsubscribeRsrc(&atl));
+        EXPECT_TRUE(stateMachine.unsubscribeRsrc(&wifi));
+    }
+    EXPECT_EQ(SUBSCRIBER_COUNT, sNotified[SUBSCRIBER_ATL]);
+    EXPECT_FALSE(stateMachine.hasActiveSubscribers());
+    EXPECT_TRUE(stateMachine.hasSubscribers());
+    EXPECT_EQ(1, sReleases);
+
+    // the release tells every inactive WIFI subscriber in one pass
+    stateMachine.onRsrcEvent(RSRC_RELEASED);
+    EXPECT_EQ(SUBSCRIBER_COUNT, sNotified[SUBSCRIBER_WIFI]);
+    EXPECT_FALSE(stateMachine.hasSubscribers());
+}
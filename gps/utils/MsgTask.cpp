@@ -100,3 +100,98 @@ bool MsgTask::run() {
 
     return true;
 }
+
+#ifdef __LOC_DEBUG__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/resource.h>
+
+// Compares serving a foreground and a background message stream on one
+// MsgTask thread with giving each stream a thread of its own, the two
+// LocDualContext threading models. Reports the send to proc() latency
+// of each stream and the context switches the process went through.
+
+static int64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct LatencyStats {
+    int64_t sum;
+    int64_t max;
+    int count;
+};
+
+struct LocMsgTest : public LocMsg {
+    const int64_t mSent;
+    LatencyStats* const mStats;
+    const int mWorkNs;
+    inline LocMsgTest(LatencyStats* stats, int workNs) :
+        LocMsg(), mSent(nowNs()), mStats(stats), mWorkNs(workNs) {}
+    virtual void proc() const {
+        int64_t latency = nowNs() - mSent;
+        mStats->sum += latency;
+        mStats->count++;
+        if (latency > mStats->max) {
+            mStats->max = latency;
+        }
+        // stands in for the handling of a report
+        for (int64_t end = nowNs() + mWorkNs; nowNs() < end;);
+    }
+};
+
+static long contextSwitches() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+// compile: g++ -D__LOC_HOST_DEBUG__ -D__LOC_DEBUG__ -g -O2 -std=c++0x -I. -I../../../../vendor/qcom/proprietary/gps-internal/unit-tests/fakes_for_host -I../../../../system/core/include -lpthread MsgTask.cpp LocThread.cpp msg_q.c linked_list.c
+// run: ./a.out [fg msgs per second] [bg msgs per burst] [seconds]
+int main(int argc, char** argv) {
+    int fgRate = argc > 1 ? atoi(argv[1]) : 10;
+    int bgBurst = argc > 2 ? atoi(argv[2]) : 20;
+    int seconds = argc > 3 ? atoi(argv[3]) : 5;
+
+    for (int threads = 1; threads <= 2; threads++) {
+        LatencyStats fg = {0, 0, 0};
+        LatencyStats bg = {0, 0, 0};
+        MsgTask* fgTask = new MsgTask("fg", false);
+        MsgTask* bgTask = threads > 1 ? new MsgTask("bg", false) : fgTask;
+        long switches = contextSwitches();
+
+        // fg: one position report every period; bg: a burst of batched
+        // results every second
+        for (int tick = 0; tick < fgRate * seconds; tick++) {
+            fgTask->sendMsg(new LocMsgTest(&fg, 50000));
+            if (0 == tick % fgRate) {
+                for (int i = 0; i < bgBurst; i++) {
+                    bgTask->sendMsg(new LocMsgTest(&bg, 200000));
+                }
+            }
+            usleep(1000000 / fgRate);
+        }
+        usleep(500000);
+
+        printf("%d thread(s): fg avg %lld us max %lld us, "
+               "bg avg %lld us max %lld us, %ld context switches\n",
+               threads,
+               (long long)(fg.sum / (fg.count ? fg.count : 1) / 1000),
+               (long long)(fg.max / 1000),
+               (long long)(bg.sum / (bg.count ? bg.count : 1) / 1000),
+               (long long)(bg.max / 1000),
+               contextSwitches() - switches);
+
+        if (bgTask != fgTask) {
+            bgTask->destroy();
+        }
+        fgTask->destroy();
+    }
+
+    return 0;
+}
+
+#endif
@@ -56,3 +56,5 @@ LOCAL_C_INCLUDES += \
 LOCAL_MODULE:= libshims_camera
 
 include $(BUILD_SHARED_LIBRARY)
+
+include $(LOCAL_PATH)/camera/tests/Android.mk
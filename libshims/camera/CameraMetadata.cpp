@@ -19,10 +19,14 @@
 #define LOG_TAG "Camera2-Metadata"
 #include <utils/Log.h>
 #include <utils/Errors.h>
+#include <utils/Mutex.h>
 
 #include <camera/CameraMetadata.h>
 #include <binder/Parcel.h>
 
+#include <stdlib.h>
+#include <string.h>
+
 namespace android {
 
 #define ALIGN_TO(val, alignment) \
@@ -31,6 +35,141 @@ namespace android {
 typedef Parcel::WritableBlob WritableBlob;
 typedef Parcel::ReadableBlob ReadableBlob;
 
+namespace {
+    /*
+     * Buffers released by clear() and by growing are parked here and
+     * reinitialized for the next allocation that fits, so the per-frame
+     * request and result copies stop going through malloc. The pool only
+     * holds buffers recent requests actually used: when full, a returned
+     * buffer displaces the smallest one, and anything larger than
+     * kPoolMaxBufferSize (static characteristics and the like) is freed.
+     */
+    const size_t              kPoolSize          = 4;
+    const size_t              kPoolMaxBufferSize = 64 * 1024;
+    // Don't hand out a pooled buffer more than this many times too big
+    const size_t              kPoolMaxWaste      = 4;
+
+    Mutex                     gPoolLock;
+    camera_metadata_t*        gPool[kPoolSize];
+    size_t                    gPoolCount;
+}; // namespace anonymous
+
+// The smallest pooled buffer of at least wanted bytes and with the given
+// capacities, or NULL
+static camera_metadata_t *takePooledBuffer(size_t wanted,
+        size_t entryCapacity, size_t dataCapacity) {
+    Mutex::Autolock _l(gPoolLock);
+    size_t best = kPoolSize;
+    for (size_t i = 0; i < gPoolCount; i++) {
+        size_t size = get_camera_metadata_size(gPool[i]);
+        if (get_camera_metadata_entry_capacity(gPool[i]) < entryCapacity ||
+                get_camera_metadata_data_capacity(gPool[i]) < dataCapacity ||
+                size < wanted || size > wanted * kPoolMaxWaste) {
+            continue;
+        }
+        if (best == kPoolSize || size < get_camera_metadata_size(gPool[best])) {
+            best = i;
+        }
+    }
+    if (best == kPoolSize) {
+        return NULL;
+    }
+    camera_metadata_t *buffer = gPool[best];
+    gPool[best] = gPool[--gPoolCount];
+    return buffer;
+}
+
+static camera_metadata_t *allocateBuffer(size_t entryCapacity,
+        size_t dataCapacity) {
+    size_t wanted = calculate_camera_metadata_size(entryCapacity, dataCapacity);
+    camera_metadata_t *buffer = takePooledBuffer(wanted, entryCapacity,
+            dataCapacity);
+    if (buffer == NULL) {
+        return allocate_camera_metadata(entryCapacity, dataCapacity);
+    }
+    return place_camera_metadata(buffer, get_camera_metadata_size(buffer),
+            get_camera_metadata_entry_capacity(buffer),
+            get_camera_metadata_data_capacity(buffer));
+}
+
+static void recycleBuffer(camera_metadata_t *buffer) {
+    if (buffer == NULL) {
+        return;
+    }
+    size_t size = get_camera_metadata_size(buffer);
+    if (size <= kPoolMaxBufferSize) {
+        Mutex::Autolock _l(gPoolLock);
+        if (gPoolCount < kPoolSize) {
+            gPool[gPoolCount++] = buffer;
+            return;
+        }
+        size_t smallest = 0;
+        for (size_t i = 1; i < gPoolCount; i++) {
+            if (get_camera_metadata_size(gPool[i]) <
+                    get_camera_metadata_size(gPool[smallest])) {
+                smallest = i;
+            }
+        }
+        if (get_camera_metadata_size(gPool[smallest]) < size) {
+            camera_metadata_t *evicted = gPool[smallest];
+            gPool[smallest] = buffer;
+            buffer = evicted;
+        }
+    }
+    free_camera_metadata(buffer);
+}
+
+static camera_metadata_t *cloneBuffer(const camera_metadata_t *src) {
+    if (src == NULL) {
+        return NULL;
+    }
+    camera_metadata_t *clone = allocateBuffer(
+            get_camera_metadata_entry_count(src),
+            get_camera_metadata_data_count(src));
+    if (clone != NULL && append_camera_metadata(clone, src) != OK) {
+        recycleBuffer(clone);
+        clone = NULL;
+    }
+    return clone;
+}
+
+/*
+ * Like allocate_copy_camera_metadata_checked(), but taking the memory from
+ * the pool when it can. The payload is validated after it has been copied,
+ * so the sender can't change it in between.
+ */
+static camera_metadata_t *copyBufferChecked(const camera_metadata_t *src,
+        size_t srcSize) {
+    void *buffer = takePooledBuffer(srcSize, 0, 0);
+    if (buffer == NULL) {
+        buffer = malloc(srcSize);
+        if (buffer == NULL) {
+            return NULL;
+        }
+    }
+    memcpy(buffer, src, srcSize);
+
+    camera_metadata_t *metadata = reinterpret_cast<camera_metadata_t*>(buffer);
+    if (validate_camera_metadata_structure(metadata, &srcSize) != OK) {
+        // Not a valid header any more, so it can't go back to the pool
+        free(buffer);
+        return NULL;
+    }
+    return metadata;
+}
+
+// Move the contents of buffer into a new one with the given capacities
+static camera_metadata_t *growBuffer(camera_metadata_t *buffer,
+        size_t entryCapacity, size_t dataCapacity) {
+    camera_metadata_t *newBuffer = allocateBuffer(entryCapacity, dataCapacity);
+    if (newBuffer == NULL) {
+        return NULL;
+    }
+    append_camera_metadata(newBuffer, buffer);
+    recycleBuffer(buffer);
+    return newBuffer;
+}
+
 CameraMetadata::CameraMetadata() :
         mBuffer(NULL), mLocked(false) {
 }
@@ -38,12 +177,12 @@ CameraMetadata::CameraMetadata() :
 CameraMetadata::CameraMetadata(size_t entryCapacity, size_t dataCapacity) :
         mLocked(false)
 {
-    mBuffer = allocate_camera_metadata(entryCapacity, dataCapacity);
+    mBuffer = allocateBuffer(entryCapacity, dataCapacity);
 }
 
 CameraMetadata::CameraMetadata(const CameraMetadata &other) :
         mLocked(false) {
-    mBuffer = clone_camera_metadata(other.mBuffer);
+    mBuffer = cloneBuffer(other.mBuffer);
 }
 
 CameraMetadata::CameraMetadata(camera_metadata_t *buffer) :
@@ -62,7 +201,7 @@ CameraMetadata &CameraMetadata::operator=(const camera_metadata_t *buffer) {
     }
 
     if (CC_LIKELY(buffer != mBuffer)) {
-        camera_metadata_t *newBuffer = clone_camera_metadata(buffer);
+        camera_metadata_t *newBuffer = cloneBuffer(buffer);
         clear();
         mBuffer = newBuffer;
     }
@@ -109,7 +248,7 @@ void CameraMetadata::clear() {
         return;
     }
     if (mBuffer) {
-        free_camera_metadata(mBuffer);
+        recycleBuffer(mBuffer);
         mBuffer = NULL;
     }
 }
@@ -303,15 +442,24 @@ status_t CameraMetadata::updateImpl(uint32_t tag, const void *data,
     size_t data_size = calculate_camera_metadata_entry_data_size(type,
             data_count);
 
-    res = resizeIfNeeded(1, data_size);
-
-    if (res == OK) {
-        camera_metadata_entry_t entry;
-        res = find_camera_metadata_entry(mBuffer, tag, &entry);
-        if (res == NAME_NOT_FOUND) {
+    camera_metadata_entry_t entry;
+    res = (mBuffer == NULL) ? NAME_NOT_FOUND :
+            find_camera_metadata_entry(mBuffer, tag, &entry);
+    if (res == NAME_NOT_FOUND) {
+        res = resizeIfNeeded(1, data_size);
+        if (res == OK) {
             res = add_camera_metadata_entry(mBuffer,
                     tag, data, data_count);
-        } else if (res == OK) {
+        }
+    } else if (res == OK) {
+        // Overwriting an entry reuses its data slot, so the buffer only
+        // needs room for however much the payload grows. Growing keeps the
+        // entry order, so entry.index is still valid afterwards.
+        size_t entry_size = calculate_camera_metadata_entry_data_size(type,
+                entry.count);
+        res = resizeIfNeeded(0,
+                data_size > entry_size ? data_size - entry_size : 0);
+        if (res == OK) {
             res = update_camera_metadata_entry(mBuffer,
                     entry.index, data, data_count, NULL);
         }
@@ -397,9 +545,40 @@ void CameraMetadata::dump(int fd, int verbosity, int indentation) const {
     dump_indented_camera_metadata(mBuffer, fd, verbosity, indentation);
 }
 
+status_t CameraMetadata::reserve(size_t entryCapacity, size_t dataCapacity) {
+    if (mLocked) {
+        ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
+        return INVALID_OPERATION;
+    }
+    if (mBuffer == NULL) {
+        mBuffer = allocateBuffer(entryCapacity, dataCapacity);
+        if (mBuffer == NULL) {
+            ALOGE("%s: Can't allocate metadata buffer", __FUNCTION__);
+            return NO_MEMORY;
+        }
+        return OK;
+    }
+
+    size_t currentEntryCap = get_camera_metadata_entry_capacity(mBuffer);
+    size_t currentDataCap = get_camera_metadata_data_capacity(mBuffer);
+    if (entryCapacity <= currentEntryCap && dataCapacity <= currentDataCap) {
+        return OK;
+    }
+
+    camera_metadata_t *newBuffer = growBuffer(mBuffer,
+            entryCapacity > currentEntryCap ? entryCapacity : currentEntryCap,
+            dataCapacity > currentDataCap ? dataCapacity : currentDataCap);
+    if (newBuffer == NULL) {
+        ALOGE("%s: Can't allocate larger metadata buffer", __FUNCTION__);
+        return NO_MEMORY;
+    }
+    mBuffer = newBuffer;
+    return OK;
+}
+
 status_t CameraMetadata::resizeIfNeeded(size_t extraEntries, size_t extraData) {
     if (mBuffer == NULL) {
-        mBuffer = allocate_camera_metadata(extraEntries * 2, extraData * 2);
+        mBuffer = allocateBuffer(extraEntries * 2, extraData * 2);
         if (mBuffer == NULL) {
             ALOGE("%s: Can't allocate larger metadata buffer", __FUNCTION__);
             return NO_MEMORY;
@@ -421,15 +600,13 @@ status_t CameraMetadata::resizeIfNeeded(size_t extraEntries, size_t extraData) {
 
         if (newEntryCount > currentEntryCap ||
                 newDataCount > currentDataCap) {
-            camera_metadata_t *oldBuffer = mBuffer;
-            mBuffer = allocate_camera_metadata(newEntryCount,
+            camera_metadata_t *newBuffer = growBuffer(mBuffer, newEntryCount,
                     newDataCount);
-            if (mBuffer == NULL) {
+            if (newBuffer == NULL) {
                 ALOGE("%s: Can't allocate larger metadata buffer", __FUNCTION__);
                 return NO_MEMORY;
             }
-            append_camera_metadata(mBuffer, oldBuffer);
-            free_camera_metadata(oldBuffer);
+            mBuffer = newBuffer;
         }
     }
     return OK;
@@ -505,7 +682,7 @@ status_t CameraMetadata::readFromParcel(const Parcel& data,
                        reinterpret_cast<const camera_metadata_t*>(metadataStart);
         ALOGV("%s: alignment is: %zu, metadata start: %p, offset: %zu",
                 __FUNCTION__, alignment, tmp, offset);
-        metadata = allocate_copy_camera_metadata_checked(tmp, metadataSize);
+        metadata = copyBufferChecked(tmp, metadataSize);
         if (metadata == NULL) {
             // We consider that allocation only fails if the validation
             // also failed, therefore the readFromParcel was a failure.
@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <camera/CameraParameters.h>
 #include <camera/CameraParametersExtra.h>
+#include "CameraParametersCache.h"
 #include <system/graphics.h>
 
 namespace android {
@@ -189,6 +190,41 @@ CameraParameters::~CameraParameters()
 {
 }
 
+// The vendor camera libraries are built against this class's inline
+// constructor, so mMap has to stay a DefaultKeyedVector. Its keys are kept
+// in strcmp() order, which lets the helpers below find a key in place
+// rather than building a temporary String8 for each lookup.
+static ssize_t findKey(const DefaultKeyedVector<String8,String8> &map,
+                       const char *key)
+{
+    ssize_t lo = 0;
+    ssize_t hi = (ssize_t)map.size() - 1;
+
+    while (lo <= hi) {
+        ssize_t mid = (lo + hi) / 2;
+        int cmp = strcmp(map.keyAt(mid).string(), key);
+        if (cmp == 0)
+            return mid;
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+    return NAME_NOT_FOUND;
+}
+
+// Only allocates for a new key or a value that actually changes.
+static void replaceValue(DefaultKeyedVector<String8,String8> &map,
+                         const char *key, const char *value)
+{
+    ssize_t idx = findKey(map, key);
+    if (idx < 0) {
+        map.add(String8(key), String8(value));
+    } else if (strcmp(map.valueAt(idx).string(), value)) {
+        map.replaceValueAt(idx, String8(value));
+    }
+}
+
 String8 CameraParameters::flatten() const
 {
     String8 flattened("");
@@ -216,6 +252,12 @@ void CameraParameters::unflatten(const String8 &params)
 
     mMap.clear();
 
+    // Size the map once up front instead of growing it key by key.
+    size_t count = 1;
+    for (b = strchr(a, ';'); b; b = strchr(b+1, ';'))
+        count++;
+    mMap.setCapacity(count);
+
     for (;;) {
         // Find the bounds of the key name.
         b = strchr(a, '=');
@@ -262,11 +304,11 @@ void CameraParameters::set(const char *key, const char *value)
     // The android SDK only wants one frame, so disable this unless the app
     // explicitly asks for it
     if (!get("hdr-need-1x")) {
-        mMap.replaceValueFor(String8("hdr-need-1x"), String8("false"));
+        replaceValue(mMap, "hdr-need-1x", "false");
     }
 #endif
 
-    mMap.replaceValueFor(String8(key), String8(value));
+    replaceValue(mMap, key, value);
 }
 
 void CameraParameters::set(const char *key, int value)
@@ -285,10 +327,10 @@ void CameraParameters::setFloat(const char *key, float value)
 
 const char *CameraParameters::get(const char *key) const
 {
-    String8 v = mMap.valueFor(String8(key));
-    if (v.length() == 0)
+    ssize_t idx = findKey(mMap, key);
+    if (idx < 0 || mMap.valueAt(idx).length() == 0)
         return 0;
-    return v.string();
+    return mMap.valueAt(idx).string();
 }
 
 int CameraParameters::getInt(const char *key) const
@@ -308,7 +350,9 @@ float CameraParameters::getFloat(const char *key) const
 
 void CameraParameters::remove(const char *key)
 {
-    mMap.removeItem(String8(key));
+    ssize_t idx = findKey(mMap, key);
+    if (idx >= 0)
+        mMap.removeItemsAt(idx);
 }
 
 // Parse string like "640x480" or "10000,20000"
@@ -362,6 +406,18 @@ static void parseSizesList(const char *sizesStr, Vector<Size> &sizes)
     }
 }
 
+static SizesListCache sSizesCache;
+
+// The value stored for key as get() sees it, NULL when unset or empty
+static const String8 *findValue(const DefaultKeyedVector<String8,String8> &map,
+                                const char *key)
+{
+    ssize_t idx = findKey(map, key);
+    if (idx < 0 || map.valueAt(idx).length() == 0)
+        return NULL;
+    return &map.valueAt(idx);
+}
+
 void CameraParameters::setPreviewSize(int width, int height)
 {
     char str[32];
@@ -388,8 +444,7 @@ void CameraParameters::getPreferredPreviewSizeForVideo(int *width, int *height)
 
 void CameraParameters::getSupportedPreviewSizes(Vector<Size> &sizes) const
 {
-    const char *previewSizesStr = get(KEY_SUPPORTED_PREVIEW_SIZES);
-    parseSizesList(previewSizesStr, sizes);
+    sSizesCache.get(findValue(mMap, KEY_SUPPORTED_PREVIEW_SIZES), parseSizesList, sizes);
 }
 
 void CameraParameters::setVideoSize(int width, int height)
@@ -409,8 +464,7 @@ void CameraParameters::getVideoSize(int *width, int *height) const
 
 void CameraParameters::getSupportedVideoSizes(Vector<Size> &sizes) const
 {
-    const char *videoSizesStr = get(KEY_SUPPORTED_VIDEO_SIZES);
-    parseSizesList(videoSizesStr, sizes);
+    sSizesCache.get(findValue(mMap, KEY_SUPPORTED_VIDEO_SIZES), parseSizesList, sizes);
 }
 
 void CameraParameters::setPreviewFrameRate(int fps)
@@ -459,8 +513,7 @@ void CameraParameters::getPictureSize(int *width, int *height) const
 
 void CameraParameters::getSupportedPictureSizes(Vector<Size> &sizes) const
 {
-    const char *pictureSizesStr = get(KEY_SUPPORTED_PICTURE_SIZES);
-    parseSizesList(pictureSizesStr, sizes);
+    sSizesCache.get(findValue(mMap, KEY_SUPPORTED_PICTURE_SIZES), parseSizesList, sizes);
 }
 
 void CameraParameters::setPictureFormat(const char *format)
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <camera/CameraParameters2.h>
+#include "CameraParametersCache.h"
 
 namespace android {
 
@@ -63,6 +64,12 @@ void CameraParameters2::unflatten(const String8 &params)
 
     mMap.clear();
 
+    // Size the map once up front instead of growing it key by key.
+    size_t count = 1;
+    for (b = strchr(a, ';'); b; b = strchr(b+1, ';'))
+        count++;
+    mMap.setCapacity(count);
+
     for (;;) {
         // Find the bounds of the key name.
         b = strchr(a, '=');
@@ -103,7 +110,7 @@ void CameraParameters2::set(const char *key, const char *value)
     }
 
     // Replacing a value updates the key's order to be the new largest order
-    ssize_t res = mMap.replaceValueFor(String8(key), String8(value));
+    ssize_t res = mMap.replaceValueFor(key, value);
     LOG_ALWAYS_FATAL_IF(res < 0, "replaceValueFor(%s,%s) failed", key, value);
 }
 
@@ -123,7 +130,7 @@ void CameraParameters2::setFloat(const char *key, float value)
 
 const char *CameraParameters2::get(const char *key) const
 {
-    ssize_t idx = mMap.indexOfKey(String8(key));
+    ssize_t idx = mMap.indexOfKey(key);
     if (idx < 0) {
         return NULL;
     } else {
@@ -159,8 +166,8 @@ status_t CameraParameters2::compareSetOrder(const char *key1, const char *key2,
         return BAD_VALUE;
     }
 
-    ssize_t index1 = mMap.indexOfKey(String8(key1));
-    ssize_t index2 = mMap.indexOfKey(String8(key2));
+    ssize_t index1 = mMap.indexOfKey(key1);
+    ssize_t index2 = mMap.indexOfKey(key2);
     if (index1 < 0) {
         ALOGW("%s: Key1 (%s) was not set", __FUNCTION__, key1);
         return NAME_NOT_FOUND;
@@ -178,7 +185,7 @@ status_t CameraParameters2::compareSetOrder(const char *key1, const char *key2,
 
 void CameraParameters2::remove(const char *key)
 {
-    mMap.removeItem(String8(key));
+    mMap.removeItem(key);
 }
 
 // Parse string like "640x480" or "10000,20000"
@@ -232,6 +239,8 @@ static void parseSizesList(const char *sizesStr, Vector<Size> &sizes)
     }
 }
 
+static SizesListCache sSizesCache;
+
 void CameraParameters2::setPreviewSize(int width, int height)
 {
     char str[32];
@@ -258,8 +267,8 @@ void CameraParameters2::getPreferredPreviewSizeForVideo(int *width, int *height)
 
 void CameraParameters2::getSupportedPreviewSizes(Vector<Size> &sizes) const
 {
-    const char *previewSizesStr = get(CameraParameters::KEY_SUPPORTED_PREVIEW_SIZES);
-    parseSizesList(previewSizesStr, sizes);
+    ssize_t idx = mMap.indexOfKey(CameraParameters::KEY_SUPPORTED_PREVIEW_SIZES);
+    sSizesCache.get(idx < 0 ? NULL : &mMap.valueAt(idx), parseSizesList, sizes);
 }
 
 void CameraParameters2::setVideoSize(int width, int height)
@@ -279,8 +288,8 @@ void CameraParameters2::getVideoSize(int *width, int *height) const
 
 void CameraParameters2::getSupportedVideoSizes(Vector<Size> &sizes) const
 {
-    const char *videoSizesStr = get(CameraParameters::KEY_SUPPORTED_VIDEO_SIZES);
-    parseSizesList(videoSizesStr, sizes);
+    ssize_t idx = mMap.indexOfKey(CameraParameters::KEY_SUPPORTED_VIDEO_SIZES);
+    sSizesCache.get(idx < 0 ? NULL : &mMap.valueAt(idx), parseSizesList, sizes);
 }
 
 void CameraParameters2::setPreviewFrameRate(int fps)
@@ -335,8 +344,8 @@ void CameraParameters2::getPictureSize(int *width, int *height) const
 
 void CameraParameters2::getSupportedPictureSizes(Vector<Size> &sizes) const
 {
-    const char *pictureSizesStr = get(CameraParameters::KEY_SUPPORTED_PICTURE_SIZES);
-    parseSizesList(pictureSizesStr, sizes);
+    ssize_t idx = mMap.indexOfKey(CameraParameters::KEY_SUPPORTED_PICTURE_SIZES);
+    sSizesCache.get(idx < 0 ? NULL : &mMap.valueAt(idx), parseSizesList, sizes);
 }
 
 void CameraParameters2::setPictureFormat(const char *format)
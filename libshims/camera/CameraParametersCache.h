@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2016, The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ANDROID_HARDWARE_CAMERA_PARAMETERS_CACHE_H
+#define ANDROID_HARDWARE_CAMERA_PARAMETERS_CACHE_H
+
+#include <utils/Mutex.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
+#include <camera/CameraParameters.h>
+
+namespace android {
+
+/*
+ * Parsed size lists, shared by CameraParameters and CameraParameters2.
+ *
+ * HALs ask for the supported preview, picture and video sizes over and
+ * over while configuring streams, and each call used to re-parse a list
+ * of twenty-odd "WxH" pairs into a freshly grown Vector. Entries are
+ * keyed on the String8 buffer the list was parsed from and hold a
+ * reference on it. String8 buffers are immutable and can't be recycled
+ * while referenced, so a matching buffer always means the same text, and
+ * set(), remove() and unflatten() invalidate entries simply by replacing
+ * the value. The objects themselves can't carry the cache, as vendor code
+ * is built against their layout.
+ */
+class SizesListCache {
+public:
+    typedef void (*parse_fn)(const char *str, Vector<Size> &sizes);
+
+    inline SizesListCache() : mNext(0) {}
+
+    // Append the sizes listed in value to sizes; value may be NULL.
+    void get(const String8 *value, parse_fn parse, Vector<Size> &sizes) {
+        if (value == NULL)
+            return;
+        if (value->isEmpty()) {
+            parse(value->string(), sizes);
+            return;
+        }
+
+        Mutex::Autolock lock(mLock);
+        size_t i;
+        for (i = 0; i < kEntries; i++) {
+            if (mSources[i].string() == value->string())
+                break;
+        }
+        if (i == kEntries) {
+            i = mNext;
+            mNext = (mNext + 1) % kEntries;
+            mSources[i] = *value;
+            mSizes[i].clear();
+            parse(value->string(), mSizes[i]);
+        }
+
+        // Vector shares its storage on assignment, so the common case of
+        // an empty destination costs no copy at all.
+        if (sizes.isEmpty())
+            sizes = mSizes[i];
+        else
+            sizes.appendVector(mSizes[i]);
+    }
+
+private:
+    enum { kEntries = 8 };
+
+    Mutex mLock;
+    String8 mSources[kEntries];
+    Vector<Size> mSizes[kEntries];
+    size_t mNext;
+};
+
+}; // namespace android
+
+#endif
@@ -28,6 +28,7 @@
 #include "camera/VendorTagDescriptor.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 namespace android {
@@ -46,15 +47,69 @@ static int vendor_tag_descriptor_get_tag_type(const vendor_tag_ops_t* v, uint32_
 static Mutex sLock;
 static sp<VendorTagDescriptor> sGlobalVendorTagDescriptor;
 
-VendorTagDescriptor::VendorTagDescriptor() {}
+namespace {
+    // Above this many distinct (tag >> 16) values, fall back to binary search
+    const uint32_t            kMaxTagRanges   = 256;
+    // Average number of names per bucket of the name hash
+    const size_t              kNameBucketSize = 4;
+    // Give up on the name hash once its table is this many times the names
+    const size_t              kMaxNameTableLoad = 64;
+    const uint32_t            kNoTagIndex     = UINT32_MAX;
+}; // namespace anonymous
+
+static uint32_t appendToPool(Vector<char>& pool, const char* str) {
+    uint32_t offset = pool.size();
+    pool.appendArray(str, strlen(str) + 1);
+    return offset;
+}
+
+static ssize_t indexOfSection(const SortedVector<String8>& sections, const char* name) {
+    size_t lo = 0, hi = sections.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(sections[mid].string(), name);
+        if (cmp == 0) {
+            return mid;
+        } else if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return -1;
+}
 
-VendorTagDescriptor::~VendorTagDescriptor() {
-    size_t len = mReverseMapping.size();
-    for (size_t i = 0; i < len; ++i)  {
-        delete mReverseMapping[i];
+static uint32_t hashTagName(uint32_t sectionIndex, const char* name) {
+    uint32_t hash = 2166136261u ^ sectionIndex;
+    for (; *name != '\0'; name++) {
+        hash ^= static_cast<uint8_t>(*name);
+        hash *= 16777619u;
     }
+    return hash;
 }
 
+// Hashes the name again from a seeded basis, so names whose hashTagName()
+// collide still land on different slots for most seeds
+static uint32_t nameSlot(uint32_t sectionIndex, const char* name, uint32_t seed,
+        size_t tableSize) {
+    uint32_t hash = hashTagName(sectionIndex ^ (seed * 0x9e3779b9u), name);
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    return hash & (tableSize - 1);
+}
+
+static int compareKeys(const void* a, const void* b) {
+    uint64_t lhs = *static_cast<const uint64_t*>(a);
+    uint64_t rhs = *static_cast<const uint64_t*>(b);
+    return (lhs < rhs) ? -1 : (lhs > rhs);
+}
+
+VendorTagDescriptor::VendorTagDescriptor() :
+        mFirstTagRange(0), mTagCount(0) {}
+
+VendorTagDescriptor::~VendorTagDescriptor() {}
+
 status_t VendorTagDescriptor::createDescriptorFromOps(const vendor_tag_ops_t* vOps,
             /*out*/
             sp<VendorTagDescriptor>& descriptor) {
@@ -77,9 +132,12 @@ status_t VendorTagDescriptor::createDescriptorFromOps(const vendor_tag_ops_t* vO
 
     sp<VendorTagDescriptor> desc = new VendorTagDescriptor();
     desc->mTagCount = tagCount;
+    desc->mTags.setCapacity(tagCount);
 
+    // Section indices can only be assigned once all sections are known
+    Vector<const char*> tagSections;
+    tagSections.setCapacity(tagCount);
     SortedVector<String8> sections;
-    KeyedVector<uint32_t, String8> tagToSectionMap;
 
     for (size_t i = 0; i < static_cast<size_t>(tagCount); ++i) {
         uint32_t tag = tagArray[i];
@@ -92,46 +150,48 @@ status_t VendorTagDescriptor::createDescriptorFromOps(const vendor_tag_ops_t* vO
             ALOGE("%s: no tag name defined for vendor tag %d.", __FUNCTION__, tag);
             return BAD_VALUE;
         }
-        desc->mTagToNameMap.add(tag, String8(tagName));
         const char *sectionName = vOps->get_section_name(vOps, tag);
         if (sectionName == NULL) {
             ALOGE("%s: no section name defined for vendor tag %d.", __FUNCTION__, tag);
             return BAD_VALUE;
         }
 
-        String8 sectionString(sectionName);
-
-        sections.add(sectionString);
-        tagToSectionMap.add(tag, sectionString);
+        // Tags of a section usually come together
+        if (i == 0 || strcmp(tagSections[i - 1], sectionName) != 0) {
+            sections.add(String8(sectionName));
+        }
+        tagSections.add(sectionName);
 
         int tagType = vOps->get_tag_type(vOps, tag);
         if (tagType < 0 || tagType >= NUM_TYPES) {
             ALOGE("%s: tag type %d from vendor ops does not exist.", __FUNCTION__, tagType);
             return BAD_VALUE;
         }
-        desc->mTagToTypeMap.add(tag, tagType);
+
+        TagInfo info;
+        info.tag = tag;
+        info.nameOffset = appendToPool(desc->mStringPool, tagName);
+        info.sectionIndex = 0;
+        info.type = tagType;
+        desc->mTags.add(info);
     }
 
     desc->mSections = sections;
 
     for (size_t i = 0; i < static_cast<size_t>(tagCount); ++i) {
-        uint32_t tag = tagArray[i];
-        String8 sectionString = tagToSectionMap.valueFor(tag);
-
-        // Set up tag to section index map
-        ssize_t index = sections.indexOf(sectionString);
+        ssize_t index = indexOfSection(sections, tagSections[i]);
         LOG_ALWAYS_FATAL_IF(index < 0, "index %zd must be non-negative", index);
-        desc->mTagToSectionMap.add(tag, static_cast<uint32_t>(index));
-
-        // Set up reverse mapping
-        ssize_t reverseIndex = -1;
-        if ((reverseIndex = desc->mReverseMapping.indexOfKey(sectionString)) < 0) {
-            KeyedVector<String8, uint32_t>* nameMapper = new KeyedVector<String8, uint32_t>();
-            reverseIndex = desc->mReverseMapping.add(sectionString, nameMapper);
-        }
-        desc->mReverseMapping[reverseIndex]->add(desc->mTagToNameMap.valueFor(tag), tag);
+        desc->mTags.editItemAt(i).sectionIndex = static_cast<uint32_t>(index);
     }
 
+    // The camera service hands out the same tags every time; reuse the
+    // global descriptor's tables rather than build them again
+    sp<VendorTagDescriptor> global = getGlobalVendorTagDescriptor();
+    if (global != NULL && global->isBuiltFrom(*desc)) {
+        desc = global;
+    } else {
+        desc->buildTables();
+    }
     descriptor = desc;
     return OK;
 }
@@ -158,11 +218,11 @@ status_t VendorTagDescriptor::createFromParcel(const Parcel* parcel,
 
     sp<VendorTagDescriptor> desc = new VendorTagDescriptor();
     desc->mTagCount = tagCount;
+    desc->mTags.setCapacity(tagCount);
 
     uint32_t tag, sectionIndex;
     uint32_t maxSectionIndex = 0;
     int32_t tagType;
-    Vector<uint32_t> allTags;
     for (int32_t i = 0; i < tagCount; ++i) {
         if ((res = parcel->readInt32(reinterpret_cast<int32_t*>(&tag))) != OK) {
             ALOGE("%s: could not read tag id from parcel for index %d", __FUNCTION__, i);
@@ -196,10 +256,12 @@ status_t VendorTagDescriptor::createFromParcel(const Parcel* parcel,
 
         maxSectionIndex = (maxSectionIndex >= sectionIndex) ? maxSectionIndex : sectionIndex;
 
-        allTags.add(tag);
-        desc->mTagToNameMap.add(tag, tagName);
-        desc->mTagToSectionMap.add(tag, sectionIndex);
-        desc->mTagToTypeMap.add(tag, tagType);
+        TagInfo info;
+        info.tag = tag;
+        info.nameOffset = appendToPool(desc->mStringPool, tagName.string());
+        info.sectionIndex = sectionIndex;
+        info.type = tagType;
+        desc->mTags.add(info);
     }
 
     if (res != OK) {
@@ -230,27 +292,292 @@ status_t VendorTagDescriptor::createFromParcel(const Parcel* parcel,
         }
     }
 
-    LOG_ALWAYS_FATAL_IF(static_cast<size_t>(tagCount) != allTags.size(),
+    LOG_ALWAYS_FATAL_IF(static_cast<size_t>(tagCount) != desc->mTags.size(),
                         "tagCount must be the same as allTags size");
-    // Set up reverse mapping
-    for (size_t i = 0; i < static_cast<size_t>(tagCount); ++i) {
-        uint32_t tag = allTags[i];
-        String8 sectionString = desc->mSections[desc->mTagToSectionMap.valueFor(tag)];
+    // The camera service hands out the same tags every time; reuse the
+    // global descriptor's tables rather than build them again
+    sp<VendorTagDescriptor> global = getGlobalVendorTagDescriptor();
+    if (global != NULL && global->isBuiltFrom(*desc)) {
+        desc = global;
+    } else {
+        desc->buildTables();
+    }
+    descriptor = desc;
+    return res;
+}
+
+void VendorTagDescriptor::buildTables() {
+    size_t definedCount = mTags.size();
+    Vector<TagInfo> defined(mTags);
+
+    // Sort by tag id and then definition order, and keep the last
+    // definition of each id
+    uint64_t* keys = new uint64_t[definedCount > 0 ? definedCount : 1];
+    for (size_t i = 0; i < definedCount; ++i) {
+        keys[i] = (static_cast<uint64_t>(defined[i].tag) << 32) | i;
+    }
+    qsort(keys, definedCount, sizeof(keys[0]), compareKeys);
 
-        ssize_t reverseIndex = -1;
-        if ((reverseIndex = desc->mReverseMapping.indexOfKey(sectionString)) < 0) {
-            KeyedVector<String8, uint32_t>* nameMapper = new KeyedVector<String8, uint32_t>();
-            reverseIndex = desc->mReverseMapping.add(sectionString, nameMapper);
+    // Position of each kept tag's last definition, for the name hash below
+    Vector<uint32_t> lastDefinition;
+    mTags.clear();
+    for (size_t i = 0; i < definedCount; ++i) {
+        if (i + 1 < definedCount && (keys[i + 1] >> 32) == (keys[i] >> 32)) {
+            continue;
+        }
+        uint32_t position = static_cast<uint32_t>(keys[i]);
+        mTags.add(defined[position]);
+        lastDefinition.add(position);
+    }
+    size_t count = mTags.size();
+
+    // Forward lookups index straight into mTags by the tag's offset in its
+    // range; vendor ranges are almost always filled in order.
+    mTagRanges.clear();
+    mFirstTagRange = 0;
+    if (count > 0) {
+        uint32_t first = mTags[0].tag >> 16;
+        uint32_t last = mTags[count - 1].tag >> 16;
+        if (last - first < kMaxTagRanges) {
+            TagRange empty = { 0, 0 };
+            mFirstTagRange = first;
+            mTagRanges.insertAt(empty, 0, last - first + 1);
+            for (size_t i = 0; i < count; ++i) {
+                TagRange& range = mTagRanges.editItemAt((mTags[i].tag >> 16) - first);
+                if (range.count++ == 0) {
+                    range.first = i;
+                }
+            }
         }
-        desc->mReverseMapping[reverseIndex]->add(desc->mTagToNameMap.valueFor(tag), tag);
     }
 
-    descriptor = desc;
-    return res;
+    // Hash every (section, name) pair. Should two tags share one, the tag
+    // defined last answers lookups for it.
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t hash = hashTagName(mTags[i].sectionIndex, nameAt(i));
+        keys[i] = (static_cast<uint64_t>(hash) << 32) | i;
+    }
+    qsort(keys, count, sizeof(keys[0]), compareKeys);
+    size_t keyCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t index = static_cast<uint32_t>(keys[i]);
+        bool replaced = false;
+        for (size_t j = keyCount; j > 0 && (keys[j - 1] >> 32) == (keys[i] >> 32); --j) {
+            uint32_t other = static_cast<uint32_t>(keys[j - 1]);
+            if (mTags[other].sectionIndex == mTags[index].sectionIndex &&
+                    strcmp(nameAt(other), nameAt(index)) == 0) {
+                if (lastDefinition[index] > lastDefinition[other]) {
+                    keys[j - 1] = keys[i];
+                }
+                replaced = true;
+                break;
+            }
+        }
+        if (!replaced) {
+            keys[keyCount++] = keys[i];
+        }
+    }
+
+    // Hash and displace: spread the names over buckets, then place the
+    // fullest buckets first, trying seeds until all of a bucket's names
+    // land on free slots. The table is kept at most half full, so this
+    // settles quickly; double it in the unlikely case a bucket can't fit,
+    // and should that keep failing, keep the names sorted instead.
+    mNameTable.clear();
+    mNameSeeds.clear();
+    bool placed = false;
+    if (keyCount > 0) {
+        size_t bucketCount = (keyCount + kNameBucketSize - 1) / kNameBucketSize;
+        size_t tableSize = 1;
+        while (tableSize < keyCount * 2) {
+            tableSize <<= 1;
+        }
+
+        Vector<uint32_t> bucketStart;
+        bucketStart.insertAt(0u, 0, bucketCount + 1);
+        for (size_t i = 0; i < keyCount; ++i) {
+            bucketStart.editItemAt((keys[i] >> 32) % bucketCount + 1)++;
+        }
+        uint64_t* bucketOrder = new uint64_t[bucketCount];
+        for (size_t b = 0; b < bucketCount; ++b) {
+            bucketOrder[b] = (static_cast<uint64_t>(bucketStart[b + 1]) << 32) | b;
+            bucketStart.editItemAt(b + 1) += bucketStart[b];
+        }
+        qsort(bucketOrder, bucketCount, sizeof(bucketOrder[0]), compareKeys);
+        Vector<uint32_t> fill(bucketStart);
+        uint64_t* members = new uint64_t[keyCount];
+        for (size_t i = 0; i < keyCount; ++i) {
+            members[fill.editItemAt((keys[i] >> 32) % bucketCount)++] = keys[i];
+        }
+
+        while (!placed && tableSize <= keyCount * kMaxNameTableLoad) {
+            mNameTable.clear();
+            mNameTable.insertAt(kNoTagIndex, 0, tableSize);
+            mNameSeeds.clear();
+            mNameSeeds.insertAt(static_cast<uint16_t>(0), 0, bucketCount);
+            placed = true;
+            for (size_t b = bucketCount; b > 0 && placed; --b) {
+                uint32_t bucket = static_cast<uint32_t>(bucketOrder[b - 1]);
+                size_t start = bucketStart[bucket], end = bucketStart[bucket + 1];
+                placed = false;
+                for (uint32_t seed = 0; seed <= UINT16_MAX && !placed; ++seed) {
+                    size_t i;
+                    for (i = start; i < end; ++i) {
+                        uint32_t index = static_cast<uint32_t>(members[i]);
+                        size_t slot = nameSlot(mTags[index].sectionIndex, nameAt(index),
+                                seed, tableSize);
+                        if (mNameTable[slot] != kNoTagIndex) {
+                            break;
+                        }
+                        mNameTable.editItemAt(slot) = index;
+                    }
+                    if (i == end) {
+                        mNameSeeds.editItemAt(bucket) = seed;
+                        placed = true;
+                    } else {
+                        while (i-- > start) {
+                            uint32_t index = static_cast<uint32_t>(members[i]);
+                            mNameTable.editItemAt(nameSlot(mTags[index].sectionIndex,
+                                    nameAt(index), seed, tableSize)) = kNoTagIndex;
+                        }
+                    }
+                }
+            }
+            if (!placed) {
+                tableSize <<= 1;
+            }
+        }
+
+        delete[] members;
+        delete[] bucketOrder;
+    }
+    if (!placed) {
+        // Without seeds, mNameTable lists the mTags indices sorted by
+        // section and name
+        mNameTable.clear();
+        mNameSeeds.clear();
+        for (size_t i = 0; i < keyCount; ++i) {
+            uint32_t index = static_cast<uint32_t>(keys[i]);
+            size_t lo = 0, hi = mNameTable.size();
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (compareNameAt(mNameTable[mid], mTags[index].sectionIndex,
+                        nameAt(index)) < 0) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            mNameTable.insertAt(index, lo);
+        }
+    }
+    delete[] keys;
+}
+
+bool VendorTagDescriptor::isBuiltFrom(const VendorTagDescriptor& defined) const {
+    if (mTagCount != defined.mTagCount || mSections.size() != defined.mSections.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < mSections.size(); ++i) {
+        if (mSections[i] != defined.mSections[i]) {
+            return false;
+        }
+    }
+
+    // Walk the definitions backwards, so the one that counts for each tag
+    // id comes first, and match it against our copy of that tag
+    Vector<uint8_t> matched;
+    matched.insertAt(static_cast<uint8_t>(0), 0, mTags.size());
+    size_t matchedCount = 0;
+    for (size_t i = defined.mTags.size(); i > 0; --i) {
+        const TagInfo& d = defined.mTags[i - 1];
+        ssize_t index = indexOfTag(d.tag);
+        if (index < 0) {
+            return false;
+        }
+        if (matched[index]) {
+            continue;
+        }
+        const TagInfo& t = mTags[index];
+        if (t.type != d.type || t.sectionIndex != d.sectionIndex ||
+                strcmp(nameAt(index), defined.nameAt(i - 1)) != 0) {
+            return false;
+        }
+        matched.editItemAt(index) = 1;
+        ++matchedCount;
+    }
+    return matchedCount == mTags.size();
+}
+
+ssize_t VendorTagDescriptor::indexOfTag(uint32_t tag) const {
+    size_t lo = 0, hi = mTags.size();
+    if (!mTagRanges.isEmpty()) {
+        uint32_t rangeIndex = (tag >> 16) - mFirstTagRange;
+        if (rangeIndex >= mTagRanges.size()) {
+            return -1;
+        }
+        const TagRange& range = mTagRanges[rangeIndex];
+        if (range.count == 0) {
+            return -1;
+        }
+        uint32_t offset = (tag & 0xFFFF) - (mTags[range.first].tag & 0xFFFF);
+        if (offset < range.count && mTags[range.first + offset].tag == tag) {
+            return range.first + offset;
+        }
+        lo = range.first;
+        hi = range.first + range.count;
+    }
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (mTags[mid].tag < tag) {
+            lo = mid + 1;
+        } else if (mTags[mid].tag > tag) {
+            hi = mid;
+        } else {
+            return mid;
+        }
+    }
+    return -1;
+}
+
+ssize_t VendorTagDescriptor::indexOfName(uint32_t sectionIndex, const char* name) const {
+    if (!mNameSeeds.isEmpty()) {
+        uint32_t seed = mNameSeeds[hashTagName(sectionIndex, name) % mNameSeeds.size()];
+        uint32_t index = mNameTable[nameSlot(sectionIndex, name, seed, mNameTable.size())];
+        if (index == kNoTagIndex || compareNameAt(index, sectionIndex, name) != 0) {
+            return -1;
+        }
+        return index;
+    }
+    size_t lo = 0, hi = mNameTable.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = compareNameAt(mNameTable[mid], sectionIndex, name);
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else if (cmp > 0) {
+            hi = mid;
+        } else {
+            return mNameTable[mid];
+        }
+    }
+    return -1;
+}
+
+int VendorTagDescriptor::compareNameAt(size_t index, uint32_t sectionIndex,
+        const char* name) const {
+    if (mTags[index].sectionIndex != sectionIndex) {
+        return (mTags[index].sectionIndex < sectionIndex) ? -1 : 1;
+    }
+    return strcmp(nameAt(index), name);
+}
+
+const char* VendorTagDescriptor::nameAt(size_t index) const {
+    return mStringPool.array() + mTags[index].nameOffset;
 }
 
 int VendorTagDescriptor::getTagCount() const {
-    size_t size = mTagToNameMap.size();
+    size_t size = mTags.size();
     if (size == 0) {
         return VENDOR_TAG_COUNT_ERR;
     }
@@ -258,34 +585,34 @@ int VendorTagDescriptor::getTagCount() const {
 }
 
 void VendorTagDescriptor::getTagArray(uint32_t* tagArray) const {
-    size_t size = mTagToNameMap.size();
+    size_t size = mTags.size();
     for (size_t i = 0; i < size; ++i) {
-        tagArray[i] = mTagToNameMap.keyAt(i);
+        tagArray[i] = mTags[i].tag;
     }
 }
 
 const char* VendorTagDescriptor::getSectionName(uint32_t tag) const {
-    ssize_t index = mTagToSectionMap.indexOfKey(tag);
+    ssize_t index = indexOfTag(tag);
     if (index < 0) {
         return VENDOR_SECTION_NAME_ERR;
     }
-    return mSections[mTagToSectionMap.valueAt(index)].string();
+    return mSections[mTags[index].sectionIndex].string();
 }
 
 const char* VendorTagDescriptor::getTagName(uint32_t tag) const {
-    ssize_t index = mTagToNameMap.indexOfKey(tag);
+    ssize_t index = indexOfTag(tag);
     if (index < 0) {
         return VENDOR_TAG_NAME_ERR;
     }
-    return mTagToNameMap.valueAt(index).string();
+    return nameAt(index);
 }
 
 int VendorTagDescriptor::getTagType(uint32_t tag) const {
-    ssize_t index = mTagToNameMap.indexOfKey(tag);
+    ssize_t index = indexOfTag(tag);
     if (index < 0) {
         return VENDOR_TAG_TYPE_ERR;
     }
-    return mTagToTypeMap.valueFor(tag);
+    return mTags[index].type;
 }
 
 status_t VendorTagDescriptor::writeToParcel(Parcel* parcel) const {
@@ -299,18 +626,13 @@ status_t VendorTagDescriptor::writeToParcel(Parcel* parcel) const {
         return res;
     }
 
-    size_t size = mTagToNameMap.size();
-    uint32_t tag, sectionIndex;
-    int32_t tagType;
+    size_t size = mTags.size();
     for (size_t i = 0; i < size; ++i) {
-        tag = mTagToNameMap.keyAt(i);
-        String8 tagName = mTagToNameMap[i];
-        sectionIndex = mTagToSectionMap.valueFor(tag);
-        tagType = mTagToTypeMap.valueFor(tag);
-        if ((res = parcel->writeInt32(tag)) != OK) break;
-        if ((res = parcel->writeInt32(tagType)) != OK) break;
-        if ((res = parcel->writeString8(tagName)) != OK) break;
-        if ((res = parcel->writeInt32(sectionIndex)) != OK) break;
+        const TagInfo& info = mTags[i];
+        if ((res = parcel->writeInt32(info.tag)) != OK) break;
+        if ((res = parcel->writeInt32(info.type)) != OK) break;
+        if ((res = parcel->writeString8(String8(nameAt(i)))) != OK) break;
+        if ((res = parcel->writeInt32(info.sectionIndex)) != OK) break;
     }
 
     size_t numSections = mSections.size();
@@ -329,27 +651,27 @@ SortedVector<String8> VendorTagDescriptor::getAllSectionNames() const {
 }
 
 status_t VendorTagDescriptor::lookupTag(String8 name, String8 section, /*out*/uint32_t* tag) const {
-    ssize_t index = mReverseMapping.indexOfKey(section);
-    if (index < 0) {
+    ssize_t sectionIndex = mSections.indexOf(section);
+    if (sectionIndex < 0) {
         ALOGE("%s: Section '%s' does not exist.", __FUNCTION__, section.string());
         return BAD_VALUE;
     }
 
-    ssize_t nameIndex = mReverseMapping[index]->indexOfKey(name);
-    if (nameIndex < 0) {
+    ssize_t index = indexOfName(sectionIndex, name.string());
+    if (index < 0) {
         ALOGE("%s: Tag name '%s' does not exist.", __FUNCTION__, name.string());
         return BAD_VALUE;
     }
 
     if (tag != NULL) {
-        *tag = mReverseMapping[index]->valueAt(nameIndex);
+        *tag = mTags[index].tag;
     }
     return OK;
 }
 
 void VendorTagDescriptor::dump(int fd, int verbosity, int indentation) const {
 
-    size_t size = mTagToNameMap.size();
+    size_t size = mTags.size();
     if (size == 0) {
         dprintf(fd, "%*sDumping configured vendor tag descriptors: None set\n",
                 indentation, "");
@@ -359,20 +681,20 @@ void VendorTagDescriptor::dump(int fd, int verbosity, int indentation) const {
     dprintf(fd, "%*sDumping configured vendor tag descriptors: %zu entries\n",
             indentation, "", size);
     for (size_t i = 0; i < size; ++i) {
-        uint32_t tag =  mTagToNameMap.keyAt(i);
+        uint32_t tag = mTags[i].tag;
 
         if (verbosity < 1) {
             dprintf(fd, "%*s0x%x\n", indentation + 2, "", tag);
             continue;
         }
-        String8 name = mTagToNameMap.valueAt(i);
-        uint32_t sectionId = mTagToSectionMap.valueFor(tag);
+        const char* name = nameAt(i);
+        uint32_t sectionId = mTags[i].sectionIndex;
         String8 sectionName = mSections[sectionId];
-        int type = mTagToTypeMap.valueFor(tag);
+        int type = mTags[i].type;
         const char* typeName = (type >= 0 && type < NUM_TYPES) ?
                 camera_metadata_type_names[type] : "UNKNOWN";
         dprintf(fd, "%*s0x%x (%s) with type %d (%s) defined in section %s\n", indentation + 2,
-            "", tag, name.string(), type, typeName, sectionName.string());
+            "", tag, name, type, typeName, sectionName.string());
     }
 
 }
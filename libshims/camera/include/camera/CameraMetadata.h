@@ -118,6 +118,13 @@ class CameraMetadata {
      */
     status_t sort();
 
+    /**
+     * Make sure there is room for at least entryCapacity entries and
+     * dataCapacity bytes of entry data, so that filling in a known set of
+     * tags doesn't reallocate the buffer along the way.
+     */
+    status_t reserve(size_t entryCapacity, size_t dataCapacity);
+
     /**
      * Update metadata entry. Will create entry if it doesn't exist already, and
      * will reallocate the buffer if insufficient space exists. Overloaded for
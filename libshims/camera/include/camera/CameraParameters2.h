@@ -17,6 +17,7 @@
 #ifndef ANDROID_HARDWARE_CAMERA_PARAMETERS2_H
 #define ANDROID_HARDWARE_CAMERA_PARAMETERS2_H
 
+#include <string.h>
 #include <utils/Vector.h>
 #include <utils/String8.h>
 #include "CameraParameters.h"
@@ -124,6 +125,10 @@ private:
             return mList.size();
         }
 
+        ssize_t setCapacity(size_t size) {
+            return mList.setCapacity(size);
+        }
+
         const KeyT& keyAt(size_t idx) const {
             return mList[idx].mKey;
         }
@@ -150,8 +155,30 @@ private:
                 return NAME_NOT_FOUND;
         }
 
+        // Same as above without building a temporary key
+        ssize_t indexOfKey(const char *key) const {
+                size_t vectorIdx = 0;
+                for (; vectorIdx < mList.size(); ++vectorIdx) {
+                    if (!strcmp(mList[vectorIdx].mKey.string(), key)) {
+                        return (ssize_t) vectorIdx;
+                    }
+                }
+
+                return NAME_NOT_FOUND;
+        }
+
         ssize_t removeItem(const KeyT& key) {
-            size_t vectorIdx = (size_t) indexOfKey(key);
+            ssize_t vectorIdx = indexOfKey(key);
+
+            if (vectorIdx < 0) {
+                return vectorIdx;
+            }
+
+            return mList.removeAt(vectorIdx);
+        }
+
+        ssize_t removeItem(const char *key) {
+            ssize_t vectorIdx = indexOfKey(key);
 
             if (vectorIdx < 0) {
                 return vectorIdx;
@@ -170,6 +197,26 @@ private:
             return add(key, value);
         }
 
+        // As above, but only allocates when the key or its value is new.
+        // The most recently set key is updated where it stands, since it
+        // already holds the max index.
+        ssize_t replaceValueFor(const char *key, const char *value) {
+            ssize_t vectorIdx = indexOfKey(key);
+            size_t last = mList.size() - 1;
+
+            if (vectorIdx >= 0 && (size_t) vectorIdx == last) {
+                if (strcmp(mList[last].mValue.string(), value)) {
+                    mList.editItemAt(last).mValue = ValueT(value);
+                }
+                return vectorIdx;
+            }
+
+            if (vectorIdx >= 0) {
+                mList.removeAt(vectorIdx);
+            }
+            return add(KeyT(key), ValueT(value));
+        }
+
     private:
 
         struct Pair {
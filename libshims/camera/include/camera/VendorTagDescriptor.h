@@ -128,13 +128,50 @@ class VendorTagDescriptor
         static sp<VendorTagDescriptor> getGlobalVendorTagDescriptor();
     protected:
         VendorTagDescriptor();
-        KeyedVector<String8, KeyedVector<String8, uint32_t>*> mReverseMapping;
-        KeyedVector<uint32_t, String8> mTagToNameMap;
-        KeyedVector<uint32_t, uint32_t> mTagToSectionMap; // Value is offset in mSections
-        KeyedVector<uint32_t, int32_t> mTagToTypeMap;
+
+        struct TagInfo {
+            uint32_t tag;
+            uint32_t nameOffset;   // Offset of the tag name in mStringPool
+            uint32_t sectionIndex; // Offset in mSections
+            int32_t type;
+        };
+
+        // The run of mTags sharing one value of (tag >> 16)
+        struct TagRange {
+            uint32_t first;
+            uint32_t count;
+        };
+
+        Vector<TagInfo> mTags;          // Sorted by tag id
+        Vector<TagRange> mTagRanges;    // Indexed by (tag >> 16) - mFirstTagRange
+        uint32_t mFirstTagRange;
+        Vector<char> mStringPool;       // NUL terminated tag names
+        Vector<uint32_t> mNameTable;    // Perfect hash of section and name to mTags index,
+                                        // or mTags indices sorted by them if no seeds
+        Vector<uint16_t> mNameSeeds;    // Per-bucket seed for mNameTable
         SortedVector<String8> mSections;
         // must be int32_t to be compatible with Parcel::writeInt32
         int32_t mTagCount;
+
+        // Index of tag in mTags, or -1
+        ssize_t indexOfTag(uint32_t tag) const;
+        // Index in mTags of the tag with this name, or -1
+        ssize_t indexOfName(uint32_t sectionIndex, const char* name) const;
+        // Order of mTags[index] relative to the given section and name
+        int compareNameAt(size_t index, uint32_t sectionIndex, const char* name) const;
+        const char* nameAt(size_t index) const;
+
+        /**
+         * Sort mTags, currently in the order the tags were defined in, and
+         * build the lookup tables. Later definitions of a tag id replace
+         * earlier ones.
+         */
+        void buildTables();
+        /**
+         * True if building the tables of defined, whose mTags are still in
+         * the order the tags were defined in, would give these tags.
+         */
+        bool isBuiltFrom(const VendorTagDescriptor& defined) const;
     private:
         vendor_tag_ops mVendorOps;
 };
@@ -0,0 +1,147 @@
+#
+# Copyright (C) 2016 The CyanogenMod Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+LOCAL_PATH := $(call my-dir)
+
+# The device's own CameraParametersExtra.h comes first, as it does for
+# target builds through TARGET_SPECIFIC_HEADER_PATH.
+camera_test_c_includes := \
+	$(LOCAL_PATH)/../../../include \
+	$(LOCAL_PATH)/../include
+
+camera_parameters_src_files := \
+	../CameraParameters.cpp \
+	../CameraParameters2.cpp
+
+# Parameter codec, on the device and on the host
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	CameraParameters_test.cpp \
+	$(camera_parameters_src_files)
+
+LOCAL_C_INCLUDES := $(camera_test_c_includes)
+LOCAL_CFLAGS := -DQCOM_HARDWARE
+
+LOCAL_SHARED_LIBRARIES := \
+	libcutils \
+	libutils \
+	liblog
+
+LOCAL_MODULE := libshims_camera_parameters_test
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	CameraParameters_test.cpp \
+	$(camera_parameters_src_files)
+
+LOCAL_C_INCLUDES := $(camera_test_c_includes)
+LOCAL_CFLAGS := -DQCOM_HARDWARE
+
+LOCAL_STATIC_LIBRARIES := \
+	libcutils \
+	libutils \
+	liblog
+
+LOCAL_MODULE := libshims_camera_parameters_test
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_HOST_NATIVE_TEST)
+
+# Camera HAL wrapper on top of a fake vendor module
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	CameraWrapper_test.cpp \
+	$(camera_parameters_src_files)
+
+LOCAL_C_INCLUDES := \
+	$(camera_test_c_includes) \
+	system/media/camera/include
+LOCAL_CFLAGS := -DQCOM_HARDWARE
+
+LOCAL_SHARED_LIBRARIES := \
+	libcutils \
+	libutils \
+	liblog
+
+LOCAL_MODULE := libshims_camera_wrapper_test
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_32_BIT_ONLY := true
+include $(BUILD_NATIVE_TEST)
+
+# Camera metadata buffers and vendor tags. The allocators are wrapped so
+# the test can count the buffers CameraMetadata.cpp asks for.
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	CameraMetadata_test.cpp \
+	VendorTagDescriptor_test.cpp \
+	../CameraMetadata.cpp \
+	../VendorTagDescriptor.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/../include \
+	system/media/camera/include \
+	system/media/private/camera/include
+
+LOCAL_SHARED_LIBRARIES := \
+	libcutils \
+	libutils \
+	liblog \
+	libbinder \
+	libcamera_metadata
+
+LOCAL_LDFLAGS := \
+	-Wl,--wrap=malloc \
+	-Wl,--wrap=allocate_camera_metadata \
+	-Wl,--wrap=allocate_copy_camera_metadata_checked \
+	-Wl,--wrap=clone_camera_metadata
+
+LOCAL_MODULE := libshims_camera_metadata_test
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_NATIVE_TEST)
+
+# Parameter codec fuzzer, on build systems that know about libFuzzer
+
+ifdef BUILD_FUZZ_TEST
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	CameraParameters_fuzzer.cpp \
+	$(camera_parameters_src_files)
+
+LOCAL_C_INCLUDES := $(camera_test_c_includes)
+LOCAL_CFLAGS := -DQCOM_HARDWARE
+
+LOCAL_STATIC_LIBRARIES := \
+	libcutils \
+	libutils \
+	liblog
+
+LOCAL_MODULE := libshims_camera_parameters_fuzzer
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_FUZZ_TEST)
+endif
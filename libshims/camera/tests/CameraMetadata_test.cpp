@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "CameraMetadata_test"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+#include <binder/Parcel.h>
+#include <camera/CameraMetadata.h>
+#include <system/camera_metadata.h>
+#include <utils/Timers.h>
+
+using namespace android;
+
+/*
+ * Counts the metadata buffers CameraMetadata allocates. The module links
+ * with --wrap for each of these, which only redirects the calls made from
+ * this test's own objects, CameraMetadata.cpp among them.
+ */
+static bool sCounting;
+static size_t sAllocations;
+
+extern "C" {
+void *__real_malloc(size_t size);
+camera_metadata_t *__real_allocate_camera_metadata(size_t entry_capacity,
+        size_t data_capacity);
+camera_metadata_t *__real_allocate_copy_camera_metadata_checked(
+        const camera_metadata_t *src, size_t src_size);
+camera_metadata_t *__real_clone_camera_metadata(const camera_metadata_t *src);
+
+void *__wrap_malloc(size_t size)
+{
+    if (sCounting)
+        sAllocations++;
+    return __real_malloc(size);
+}
+
+camera_metadata_t *__wrap_allocate_camera_metadata(size_t entry_capacity,
+        size_t data_capacity)
+{
+    if (sCounting)
+        sAllocations++;
+    return __real_allocate_camera_metadata(entry_capacity, data_capacity);
+}
+
+camera_metadata_t *__wrap_allocate_copy_camera_metadata_checked(
+        const camera_metadata_t *src, size_t src_size)
+{
+    if (sCounting)
+        sAllocations++;
+    return __real_allocate_copy_camera_metadata_checked(src, src_size);
+}
+
+camera_metadata_t *__wrap_clone_camera_metadata(const camera_metadata_t *src)
+{
+    if (sCounting)
+        sAllocations++;
+    return __real_clone_camera_metadata(src);
+}
+}
+
+static void startCounting()
+{
+    sAllocations = 0;
+    sCounting = true;
+}
+
+static size_t stopCounting()
+{
+    sCounting = false;
+    return sAllocations;
+}
+
+/*
+ * A preview result shaped like the ones the msm8916 HAL sends at 30 fps.
+ * The face rectangles come and go, so the result changes size over time.
+ */
+static void fillResult(CameraMetadata &result, int frame)
+{
+    int32_t requestId = frame;
+    int64_t timestamp = 1000000000LL + frame * 33333333LL;
+    int64_t exposureTime = 16666666 + (frame % 7) * 1000;
+    int64_t frameDuration = 33333333;
+    int32_t sensitivity = 100 + frame % 300;
+    int32_t cropRegion[4] = { 0, 0, 4160, 3120 };
+    int32_t faces[3 * 4];
+    int32_t faceCount = frame % 4;
+    uint8_t aeState = ANDROID_CONTROL_AE_STATE_CONVERGED;
+    uint8_t afState = (frame & 8) ? ANDROID_CONTROL_AF_STATE_PASSIVE_FOCUSED :
+            ANDROID_CONTROL_AF_STATE_PASSIVE_SCAN;
+    uint8_t awbState = ANDROID_CONTROL_AWB_STATE_CONVERGED;
+    uint8_t flashState = ANDROID_FLASH_STATE_READY;
+    float focusDistance = 0.1f * (frame % 10);
+    float colorGains[4] = { 1.8f, 1.0f, 1.0f, 2.1f };
+    camera_metadata_rational_t transform[9];
+
+    for (int i = 0; i < 12; i++) {
+        faces[i] = 100 * i + frame % 50;
+    }
+    for (int i = 0; i < 9; i++) {
+        transform[i].numerator = (i % 4 == 0) ? 128 : frame % 16;
+        transform[i].denominator = 128;
+    }
+
+    result.update(ANDROID_REQUEST_ID, &requestId, 1);
+    result.update(ANDROID_SENSOR_TIMESTAMP, &timestamp, 1);
+    result.update(ANDROID_SENSOR_EXPOSURE_TIME, &exposureTime, 1);
+    result.update(ANDROID_SENSOR_FRAME_DURATION, &frameDuration, 1);
+    result.update(ANDROID_SENSOR_SENSITIVITY, &sensitivity, 1);
+    result.update(ANDROID_SCALER_CROP_REGION, cropRegion, 4);
+    result.update(ANDROID_CONTROL_AE_STATE, &aeState, 1);
+    result.update(ANDROID_CONTROL_AF_STATE, &afState, 1);
+    result.update(ANDROID_CONTROL_AWB_STATE, &awbState, 1);
+    result.update(ANDROID_FLASH_STATE, &flashState, 1);
+    result.update(ANDROID_LENS_FOCUS_DISTANCE, &focusDistance, 1);
+    result.update(ANDROID_COLOR_CORRECTION_GAINS, colorGains, 4);
+    result.update(ANDROID_COLOR_CORRECTION_TRANSFORM, transform, 9);
+    if (faceCount) {
+        result.update(ANDROID_STATISTICS_FACE_RECTANGLES, faces, faceCount * 4);
+    } else {
+        result.erase(ANDROID_STATISTICS_FACE_RECTANGLES);
+    }
+}
+
+static bool sameMetadata(CameraMetadata &a, const CameraMetadata &b)
+{
+    const camera_metadata_t *buffer = a.getAndLock();
+    bool same = a.entryCount() == b.entryCount();
+    for (size_t i = 0; same && i < a.entryCount(); i++) {
+        camera_metadata_ro_entry_t e;
+        get_camera_metadata_ro_entry(buffer, i, &e);
+        camera_metadata_ro_entry_t f = b.find(e.tag);
+        same = e.type == f.type && e.count == f.count &&
+                !memcmp(e.data.u8, f.data.u8,
+                        e.count * camera_metadata_type_size[e.type]);
+    }
+    a.unlock(buffer);
+    return same;
+}
+
+TEST(CameraMetadataTest, UpdateInPlace) {
+    CameraMetadata result;
+    fillResult(result, 4);
+    fillResult(result, 5);
+
+    // same sized payloads are overwritten without touching the buffer
+    const camera_metadata_t *before = result.getAndLock();
+    result.unlock(before);
+    startCounting();
+    for (int frame = 8; frame < 100; frame += 4) {
+        fillResult(result, frame);
+    }
+    EXPECT_EQ(0u, stopCounting());
+    const camera_metadata_t *after = result.getAndLock();
+    EXPECT_EQ(before, after);
+    result.unlock(after);
+
+    int64_t timestamp = 0;
+    camera_metadata_entry_t e = result.find(ANDROID_SENSOR_TIMESTAMP);
+    ASSERT_EQ(1u, e.count);
+    timestamp = e.data.i64[0];
+    EXPECT_EQ(1000000000LL + 96 * 33333333LL, timestamp);
+    EXPECT_EQ(0u, result.find(ANDROID_STATISTICS_FACE_RECTANGLES).count);
+
+    // a larger payload moves the entry and keeps every other one
+    CameraMetadata copy(result);
+    int32_t faces[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    EXPECT_EQ(OK, result.update(ANDROID_STATISTICS_FACE_RECTANGLES, faces, 8));
+    EXPECT_EQ(OK, result.erase(ANDROID_STATISTICS_FACE_RECTANGLES));
+    EXPECT_TRUE(sameMetadata(copy, result));
+}
+
+TEST(CameraMetadataTest, Reserve) {
+    CameraMetadata result;
+    ASSERT_EQ(OK, result.reserve(32, 512));
+
+    startCounting();
+    fillResult(result, 3);
+    EXPECT_EQ(0u, stopCounting());
+    EXPECT_EQ(14u, result.entryCount());
+
+    // reserving less than what is held changes nothing
+    const camera_metadata_t *before = result.getAndLock();
+    result.unlock(before);
+    EXPECT_EQ(OK, result.reserve(1, 1));
+    const camera_metadata_t *after = result.getAndLock();
+    EXPECT_EQ(before, after);
+    result.unlock(after);
+}
+
+TEST(CameraMetadataTest, ParcelRoundTrip) {
+    CameraMetadata result;
+    fillResult(result, 7);
+
+    Parcel parcel;
+    ASSERT_EQ(OK, result.writeToParcel(&parcel));
+    parcel.setDataPosition(0);
+
+    CameraMetadata received;
+    ASSERT_EQ(OK, received.readFromParcel(&parcel));
+    EXPECT_TRUE(sameMetadata(result, received));
+
+    // an empty parcel leaves the target empty
+    Parcel empty;
+    CameraMetadata nothing;
+    EXPECT_NE(OK, nothing.readFromParcel(&empty));
+    EXPECT_TRUE(nothing.isEmpty());
+}
+
+TEST(CameraMetadataTest, BuffersAreReused) {
+    {
+        CameraMetadata warm(32, 512);
+        fillResult(warm, 3);
+    }
+
+    // the buffer of a result that went away serves the next one
+    startCounting();
+    for (int frame = 0; frame < 30; frame++) {
+        CameraMetadata result(32, 512);
+        fillResult(result, frame);
+    }
+    EXPECT_EQ(0u, stopCounting());
+
+    // static characteristics are too large to be kept around
+    CameraMetadata large(16, 256 * 1024);
+    large.clear();
+    startCounting();
+    CameraMetadata again(16, 256 * 1024);
+    EXPECT_EQ(1u, stopCounting());
+}
+
+/*
+ * One frame of a capture result on its way from the HAL to the app: the
+ * service copies the HAL's result, parcels the copy, and the app reads
+ * it into a result of its own, which it drops once the next one comes.
+ * Prints the metadata buffer allocations and the time per frame; only
+ * runs with --gtest_also_run_disabled_tests.
+ */
+TEST(CameraMetadataBenchmark, DISABLED_ResultPath) {
+    const int frames = 30 * 10;
+    CameraMetadata hal;
+    CameraMetadata *previous = NULL;
+
+    for (int warmup = 0; warmup < 2; warmup++) {
+        startCounting();
+        nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+        for (int frame = 0; frame < frames; frame++) {
+            fillResult(hal, frame);
+
+            CameraMetadata service(hal);
+            Parcel parcel;
+            service.writeToParcel(&parcel);
+            parcel.setDataPosition(0);
+
+            CameraMetadata *app = new CameraMetadata();
+            app->readFromParcel(&parcel);
+            delete previous;
+            previous = app;
+        }
+        nsecs_t elapsed = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+        size_t allocations = stopCounting();
+
+        if (warmup) {
+            printf("%-44s %8.2f allocations, %.2f us per frame, %.0f allocations/s at 30 fps\n",
+                    "result path", (double)allocations / frames,
+                    elapsed / 1000.0 / frames, 30.0 * allocations / frames);
+        }
+    }
+    delete previous;
+}
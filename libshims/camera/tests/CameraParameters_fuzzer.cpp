@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Feeds arbitrary strings through both parameter codecs. A flattened set
+ * has to come out of another unflatten/flatten pass unchanged.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <camera/CameraParameters.h>
+#include <camera/CameraParameters2.h>
+#include <utils/String8.h>
+
+using namespace android;
+
+template <class Params>
+static void checkCodec(const String8 &in)
+{
+    Params params;
+    params.unflatten(in);
+    String8 flattened = params.flatten();
+
+    Params again;
+    again.unflatten(flattened);
+    if (again.flatten() != flattened)
+        abort();
+
+    Vector<Size> sizes;
+    params.getSupportedPreviewSizes(sizes);
+    params.getSupportedPictureSizes(sizes);
+    params.getSupportedVideoSizes(sizes);
+    params.set("hdr-need-1x", "true");
+    params.remove(CameraParameters::KEY_ZOOM);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    // the codecs only ever see NUL terminated strings
+    String8 in(reinterpret_cast<const char *>(data), size);
+
+    checkCodec<CameraParameters>(in);
+    checkCodec<CameraParameters2>(in);
+    return 0;
+}
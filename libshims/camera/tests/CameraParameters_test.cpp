@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "CameraParameters_test"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+#include <camera/CameraParameters.h>
+#include <camera/CameraParameters2.h>
+#include <utils/String8.h>
+#include <utils/Timers.h>
+
+#include "ParametersCorpus.h"
+
+using namespace android;
+
+static String8 sizesString(const Vector<Size> &sizes)
+{
+    String8 s;
+    for (size_t i = 0; i < sizes.size(); i++) {
+        s.appendFormat(i ? ",%dx%d" : "%dx%d", sizes[i].width, sizes[i].height);
+    }
+    return s;
+}
+
+TEST(CameraParametersTest, RoundTrip) {
+    for (size_t i = 0; i < PARAMETERS_CORPUS_SIZE; i++) {
+        SCOPED_TRACE(kParametersCorpus[i].name);
+        String8 in(kParametersCorpus[i].params);
+
+        CameraParameters params;
+        params.unflatten(in);
+        EXPECT_STREQ(in.string(), params.flatten().string());
+
+        CameraParameters2 params2;
+        params2.unflatten(in);
+        EXPECT_STREQ(in.string(), params2.flatten().string());
+
+        // a second pass over the output must not change it either
+        CameraParameters again;
+        again.unflatten(params.flatten());
+        EXPECT_STREQ(in.string(), again.flatten().string());
+    }
+}
+
+TEST(CameraParametersTest, FlattenOrder) {
+    String8 in("zoom=1;effect=none;antibanding=auto");
+
+    // CameraParameters keeps its keys sorted, CameraParameters2 in the
+    // order they were set
+    CameraParameters params;
+    params.unflatten(in);
+    EXPECT_STREQ("antibanding=auto;effect=none;zoom=1", params.flatten().string());
+
+    CameraParameters2 params2;
+    params2.unflatten(in);
+    EXPECT_STREQ(in.string(), params2.flatten().string());
+    params2.set("zoom", "2");
+    EXPECT_STREQ("effect=none;antibanding=auto;zoom=2", params2.flatten().string());
+
+    int order = 0;
+    EXPECT_EQ(OK, params2.compareSetOrder("effect", "zoom", &order));
+    EXPECT_EQ(-1, order);
+    EXPECT_EQ(NAME_NOT_FOUND, params2.compareSetOrder("effect", "flash-mode", &order));
+}
+
+TEST(CameraParametersTest, GetSetRemove) {
+    CameraParameters params;
+    params.unflatten(String8(kParametersCorpus[0].params));
+
+    EXPECT_STREQ("continuous-picture", params.get(CameraParameters::KEY_FOCUS_MODE));
+    EXPECT_EQ(79, params.getInt(CameraParameters::KEY_MAX_ZOOM));
+    EXPECT_FLOAT_EQ(0.166667f, params.getFloat(CameraParameters::KEY_EXPOSURE_COMPENSATION_STEP));
+    EXPECT_EQ(NULL, params.get("no-such-key"));
+    EXPECT_EQ(-1, params.getInt("no-such-key"));
+
+    params.set(CameraParameters::KEY_ZOOM, 12);
+    EXPECT_EQ(12, params.getInt(CameraParameters::KEY_ZOOM));
+    params.set("new-key", "value");
+    EXPECT_STREQ("value", params.get("new-key"));
+
+    // keys and values that would break the flattened form are dropped
+    params.set("bad=key", "value");
+    params.set("bad;key", "value");
+    params.set(CameraParameters::KEY_EFFECT, "a;b");
+    params.set(CameraParameters::KEY_EFFECT, "a=b");
+    EXPECT_EQ(NULL, params.get("bad=key"));
+    EXPECT_EQ(NULL, params.get("bad;key"));
+    EXPECT_STREQ("none", params.get(CameraParameters::KEY_EFFECT));
+
+    params.remove(CameraParameters::KEY_ZOOM);
+    params.remove("no-such-key");
+    EXPECT_EQ(NULL, params.get(CameraParameters::KEY_ZOOM));
+    EXPECT_EQ(NULL, strstr(params.flatten().string(), ";zoom="));
+}
+
+TEST(CameraParametersTest, EmptyValues) {
+    String8 in(kParametersCorpus[3].params);
+    CameraParameters params;
+    params.unflatten(in);
+
+    // an empty value reads as unset but is kept when flattening
+    EXPECT_EQ(NULL, params.get(CameraParameters::KEY_FLASH_MODE));
+    EXPECT_EQ(NULL, params.get(CameraParameters::KEY_SCENE_MODE));
+    EXPECT_STREQ(in.string(), params.flatten().string());
+
+    Vector<Size> sizes;
+    params.getSupportedPreviewSizes(sizes);
+    EXPECT_EQ(0u, sizes.size());
+
+    CameraParameters2 params2;
+    params2.unflatten(in);
+    EXPECT_STREQ("", params2.get(CameraParameters::KEY_FLASH_MODE));
+}
+
+#ifdef QCOM_HARDWARE
+TEST(CameraParametersTest, HdrNeed1x) {
+    // any set() on a set without hdr-need-1x turns the extra frame off
+    CameraParameters front;
+    front.unflatten(String8(kParametersCorpus[2].params));
+    EXPECT_EQ(NULL, front.get("hdr-need-1x"));
+    front.set(CameraParameters::KEY_SCENE_MODE, CameraParameters::SCENE_MODE_HDR);
+    EXPECT_STREQ("false", front.get("hdr-need-1x"));
+
+    // but leaves a value the HAL or the app set alone
+    CameraParameters rear;
+    rear.unflatten(String8(kParametersCorpus[0].params));
+    rear.set(CameraParameters::KEY_SCENE_MODE, CameraParameters::SCENE_MODE_HDR);
+    EXPECT_STREQ("true", rear.get("hdr-need-1x"));
+    rear.set("hdr-need-1x", "false");
+    rear.set(CameraParameters::KEY_SCENE_MODE, CameraParameters::SCENE_MODE_AUTO);
+    EXPECT_STREQ("false", rear.get("hdr-need-1x"));
+
+    // nor does unflattening add it
+    CameraParameters plain;
+    plain.unflatten(String8(kParametersCorpus[2].params));
+    EXPECT_STREQ(kParametersCorpus[2].params, plain.flatten().string());
+}
+#endif
+
+TEST(CameraParametersTest, SupportedSizes) {
+    CameraParameters params;
+    CameraParameters2 params2;
+    params.unflatten(String8(kParametersCorpus[0].params));
+    params2.unflatten(String8(kParametersCorpus[0].params));
+
+    Vector<Size> sizes, sizes2;
+    params.getSupportedPreviewSizes(sizes);
+    params2.getSupportedPreviewSizes(sizes2);
+    EXPECT_STREQ(params.get(CameraParameters::KEY_SUPPORTED_PREVIEW_SIZES),
+            sizesString(sizes).string());
+    EXPECT_STREQ(sizesString(sizes).string(), sizesString(sizes2).string());
+
+    sizes.clear();
+    params.getSupportedPictureSizes(sizes);
+    EXPECT_STREQ(params.get(CameraParameters::KEY_SUPPORTED_PICTURE_SIZES),
+            sizesString(sizes).string());
+    sizes.clear();
+    params.getSupportedVideoSizes(sizes);
+    EXPECT_STREQ(params.get(CameraParameters::KEY_SUPPORTED_VIDEO_SIZES),
+            sizesString(sizes).string());
+
+    // sizes are appended to what the vector already holds, and a changed
+    // list is parsed again
+    sizes.clear();
+    sizes.push(Size(1, 1));
+    params.set(CameraParameters::KEY_SUPPORTED_PREVIEW_SIZES, "640x480,320x240");
+    params.getSupportedPreviewSizes(sizes);
+    EXPECT_STREQ("1x1,640x480,320x240", sizesString(sizes).string());
+
+    // parsing stops at the first malformed entry, a missing height
+    // reads as 0 like it always has
+    sizes.clear();
+    params.set(CameraParameters::KEY_SUPPORTED_PREVIEW_SIZES, "640x480,12x,bad");
+    params.getSupportedPreviewSizes(sizes);
+    EXPECT_STREQ("640x480,12x0", sizesString(sizes).string());
+
+    sizes.clear();
+    params.remove(CameraParameters::KEY_SUPPORTED_PREVIEW_SIZES);
+    params.getSupportedPreviewSizes(sizes);
+    EXPECT_EQ(0u, sizes.size());
+}
+
+/*
+ * Throughput of each codec operation on the stock rear camera set. These
+ * only print their numbers, to compare before and after a change to the
+ * parameter path on the same device, so they are left out of normal runs;
+ * pass --gtest_also_run_disabled_tests to run them.
+ */
+
+static void report(const char *what, nsecs_t start, int iterations)
+{
+    printf("%-44s %8.3f us\n", what,
+            (systemTime(SYSTEM_TIME_MONOTONIC) - start) / 1000.0 / iterations);
+}
+
+TEST(CameraParametersBenchmark, DISABLED_Codec) {
+    String8 in(kParametersCorpus[0].params);
+    const int iterations = 2000;
+    CameraParameters params;
+    CameraParameters2 params2;
+    nsecs_t start;
+
+    start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int i = 0; i < iterations; i++) {
+        params.unflatten(in);
+    }
+    report("CameraParameters::unflatten", start, iterations);
+
+    start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int i = 0; i < iterations; i++) {
+        params.flatten();
+    }
+    report("CameraParameters::flatten", start, iterations);
+
+    start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int i = 0; i < iterations; i++) {
+        params2.unflatten(in);
+    }
+    report("CameraParameters2::unflatten", start, iterations);
+
+    start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int i = 0; i < iterations; i++) {
+        params2.flatten();
+    }
+    report("CameraParameters2::flatten", start, iterations);
+}
+
+TEST(CameraParametersBenchmark, DISABLED_Access) {
+    static const char *keys[] = {
+        CameraParameters::KEY_ZOOM, CameraParameters::KEY_PREVIEW_SIZE,
+        CameraParameters::KEY_PICTURE_SIZE, CameraParameters::KEY_FLASH_MODE,
+        CameraParameters::KEY_EFFECT, CameraParameters::KEY_SCENE_MODE,
+        CameraParameters::KEY_FOCUS_MODE, "no-such-key",
+    };
+    const int count = sizeof(keys) / sizeof(keys[0]);
+    const int iterations = 100000;
+    CameraParameters params;
+    CameraParameters2 params2;
+    params.unflatten(String8(kParametersCorpus[0].params));
+    params2.unflatten(String8(kParametersCorpus[0].params));
+    nsecs_t start;
+
+    start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int i = 0; i < iterations; i++) {
+        params.get(keys[i % count]);
+    }
+    report("CameraParameters::get", start, iterations);
+
+    start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int i = 0; i < iterations; i++) {
+        params.set(keys[i % count], (i & 1) ? "1" : "2");
+    }
+    report("CameraParameters::set", start, iterations);
+
+    start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int i = 0; i < iterations; i++) {
+        params2.get(keys[i % count]);
+    }
+    report("CameraParameters2::get", start, iterations);
+
+    start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int i = 0; i < iterations; i++) {
+        Vector<Size> sizes;
+        params.getSupportedPreviewSizes(sizes);
+    }
+    report("CameraParameters::getSupportedPreviewSizes", start, iterations);
+}
@@ -0,0 +1,418 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Runs the camera wrapper on top of a fake vendor HAL. The wrapper is
+ * built into the test as is, so its static fixup helpers can be checked
+ * directly as well as through the device ops.
+ */
+
+#include "../../../camera/CameraWrapper.cpp"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include <utils/String8.h>
+
+#include "ParametersCorpus.h"
+
+/* fake vendor HAL */
+
+static String8 sVendorParams;
+static String8 sVendorLastSet;
+static int sVendorGetCalls;
+static int sVendorSetCalls;
+
+static char *vendor_get_parameters(struct camera_device *)
+{
+    sVendorGetCalls++;
+    return strdup(sVendorParams.string());
+}
+
+static void vendor_put_parameters(struct camera_device *, char *params)
+{
+    free(params);
+}
+
+static int vendor_set_parameters(struct camera_device *, const char *params)
+{
+    sVendorSetCalls++;
+    sVendorLastSet = params;
+    return 0;
+}
+
+static int vendor_start_preview(struct camera_device *)
+{
+    return 0;
+}
+
+static int vendor_send_command(struct camera_device *, int32_t, int32_t, int32_t)
+{
+    return 0;
+}
+
+static int vendor_auto_focus(struct camera_device *)
+{
+    return 0;
+}
+
+static int vendor_cancel_auto_focus(struct camera_device *)
+{
+    return 0;
+}
+
+static int vendor_dump(struct camera_device *, int)
+{
+    return 0;
+}
+
+static int vendor_close(hw_device_t *)
+{
+    return 0;
+}
+
+static camera_device_ops_t sVendorOps;
+static camera_device_t sVendorDevice;
+
+static int vendor_open(const hw_module_t *, const char *, hw_device_t **device)
+{
+    sVendorOps.get_parameters = vendor_get_parameters;
+    sVendorOps.put_parameters = vendor_put_parameters;
+    sVendorOps.set_parameters = vendor_set_parameters;
+    sVendorOps.start_preview = vendor_start_preview;
+    sVendorOps.auto_focus = vendor_auto_focus;
+    sVendorOps.cancel_auto_focus = vendor_cancel_auto_focus;
+    sVendorOps.send_command = vendor_send_command;
+    sVendorOps.dump = vendor_dump;
+    sVendorDevice.ops = &sVendorOps;
+    sVendorDevice.common.close = vendor_close;
+    *device = &sVendorDevice.common;
+    return 0;
+}
+
+static int vendor_get_number_of_cameras(void)
+{
+    return 2;
+}
+
+static hw_module_methods_t sVendorMethods = {
+    .open = vendor_open
+};
+
+static camera_module_t sVendorModule;
+
+/* stands in for libhardware, which would load the real vendor module */
+int hw_get_module_by_class(const char *, const char *, const hw_module_t **module)
+{
+    sVendorModule.common.methods = &sVendorMethods;
+    sVendorModule.get_number_of_cameras = vendor_get_number_of_cameras;
+    *module = &sVendorModule.common;
+    return 0;
+}
+
+/*
+ * What get_parameters hands to apps for each corpus entry. Unsupported
+ * keys are dropped, the scene modes cut down, the manual focus position
+ * reported in the unit the position type names, and as parsing goes
+ * through CameraParameters::set(), hdr-need-1x=false added where the
+ * HAL left it out.
+ */
+static const struct {
+    const char *name;
+    const char *params;
+} kGetParamsGolden[] = {
+    { "rear",
+      "antibanding=auto;antibanding-values=off,60hz,50hz,auto;"
+      "auto-exposure-lock=false;auto-exposure-lock-supported=true;"
+      "auto-whitebalance-lock=false;cur-focus-scale=40;effect=none;"
+      "effect-values=none,mono,negative,solarize,sepia,posterize,whiteboard,"
+      "blackboard,aqua,emboss,sketch,neon;exposure-compensation=0;"
+      "exposure-compensation-step=0.166667;flash-mode=off;"
+      "flash-mode-values=off,auto,on,torch;focus-mode=continuous-picture;"
+      "focus-mode-values=auto,infinity,macro,continuous-video,"
+      "continuous-picture,manual;hdr-need-1x=true;jpeg-quality=85;"
+      "manual-focus-pos-type=2;manual-focus-position=40;"
+      "max-exposure-compensation=12;max-zoom=79;"
+      "min-exposure-compensation=-12;picture-format=jpeg;"
+      "picture-size=4160x3120;"
+      "picture-size-values=4160x3120,4000x3000,4160x2340,4000x2250,3264x2448,"
+      "3200x2400,2976x2976,2592x1944,2048x1536,1920x1080,1600x1200,1280x768,"
+      "1280x720,1024x768,800x600,800x480,720x480,640x480,352x288,320x240,"
+      "176x144;preview-format=yuv420sp;"
+      "preview-format-values=yuv420sp,yuv420sp-adreno,yuv420p,yuv420p,nv12,"
+      "yv12;preview-fps-range=7500,30000;"
+      "preview-fps-range-values=(7500,30000),(8000,30000),(30000,30000);"
+      "preview-frame-rate=30;preview-size=1920x1080;"
+      "preview-size-values=1920x1080,1440x1080,1280x960,1280x720,1024x768,"
+      "864x480,800x480,768x432,720x480,640x480,576x432,480x320,384x288,"
+      "352x288,320x240,240x160,176x144;scene-mode=auto;"
+      "scene-mode-values=auto,hdr;video-size=1920x1080;"
+      "video-size-values=1920x1080,1280x720,864x480,800x480,720x480,640x480,"
+      "480x320,352x288,320x240,176x144;whitebalance=auto;"
+      "whitebalance-values=auto,incandescent,fluorescent,warm-fluorescent,"
+      "daylight,cloudy-daylight,twilight,shade,manual-cct;zoom=0" },
+    { "rear-diopter-hdr",
+      "antibanding=auto;antibanding-values=off,60hz,50hz,auto;"
+      "auto-exposure-lock=false;auto-exposure-lock-supported=true;"
+      "auto-whitebalance-lock=false;cur-focus-diopter=2.5;effect=none;"
+      "effect-values=none,mono,negative,solarize,sepia,posterize,whiteboard,"
+      "blackboard,aqua,emboss,sketch,neon;exposure-compensation=0;"
+      "exposure-compensation-step=0.166667;flash-mode=off;"
+      "flash-mode-values=off,auto,on,torch;focus-mode=continuous-picture;"
+      "focus-mode-values=auto,infinity,macro,continuous-video,"
+      "continuous-picture,manual;hdr-need-1x=true;jpeg-quality=85;"
+      "manual-focus-pos-type=3;manual-focus-position=2.5;"
+      "max-exposure-compensation=12;max-zoom=79;"
+      "min-exposure-compensation=-12;picture-format=jpeg;"
+      "picture-size=4160x3120;"
+      "picture-size-values=4160x3120,4000x3000,4160x2340,4000x2250,3264x2448,"
+      "3200x2400,2976x2976,2592x1944,2048x1536,1920x1080,1600x1200,1280x768,"
+      "1280x720,1024x768,800x600,800x480,720x480,640x480,352x288,320x240,"
+      "176x144;preview-format=yuv420sp;"
+      "preview-format-values=yuv420sp,yuv420sp-adreno,yuv420p,yuv420p,nv12,"
+      "yv12;preview-fps-range=7500,30000;"
+      "preview-fps-range-values=(7500,30000),(8000,30000),(30000,30000);"
+      "preview-frame-rate=30;preview-size=1920x1080;"
+      "preview-size-values=1920x1080,1440x1080,1280x960,1280x720,1024x768,"
+      "864x480,800x480,768x432,720x480,640x480,576x432,480x320,384x288,"
+      "352x288,320x240,240x160,176x144;scene-mode=hdr;"
+      "scene-mode-values=auto,hdr;video-size=1920x1080;"
+      "video-size-values=1920x1080,1280x720,864x480,800x480,720x480,640x480,"
+      "480x320,352x288,320x240,176x144;whitebalance=auto;"
+      "whitebalance-values=auto,incandescent,fluorescent,warm-fluorescent,"
+      "daylight,cloudy-daylight,twilight,shade,manual-cct;zoom=0" },
+    { "front",
+      "antibanding=auto;antibanding-values=off,60hz,50hz,auto;"
+      "auto-exposure-lock=false;auto-exposure-lock-supported=true;"
+      "effect=none;effect-values=none,mono,negative,solarize,sepia;"
+      "exposure-compensation=0;exposure-compensation-step=0.166667;"
+      "focus-mode=fixed;focus-mode-values=fixed;hdr-need-1x=false;"
+      "jpeg-quality=85;max-exposure-compensation=12;max-zoom=79;"
+      "min-exposure-compensation=-12;picture-format=jpeg;"
+      "picture-size=2560x1920;"
+      "picture-size-values=2560x1920,2592x1458,2048x1536,1920x1080,1600x1200,"
+      "1280x720,1024x768,800x600,640x480,320x240;preview-format=yuv420sp;"
+      "preview-format-values=yuv420sp,yuv420p,nv12,yv12;"
+      "preview-fps-range=7500,30000;"
+      "preview-fps-range-values=(7500,30000),(30000,30000);"
+      "preview-frame-rate=30;preview-size=1280x720;"
+      "preview-size-values=1280x720,1024x768,864x480,800x480,720x480,640x480,"
+      "352x288,320x240,176x144;scene-mode=auto;scene-mode-values=auto,hdr;"
+      "video-size=1280x720;"
+      "video-size-values=1280x720,720x480,640x480,352x288,320x240;"
+      "whitebalance=auto;"
+      "whitebalance-values=auto,incandescent,fluorescent,daylight,"
+      "cloudy-daylight;zoom=0" },
+    { "empty-values",
+      "antibanding=;cur-focus-scale=0;effect=none;flash-mode=;"
+      "focus-mode=auto;hdr-need-1x=false;manual-focus-pos-type=2;"
+      "manual-focus-position=;picture-size=4160x3120;preview-size=1920x1080;"
+      "preview-size-values=;scene-mode=;scene-mode-values=auto,hdr;zoom=0" },
+};
+
+class CameraWrapperTest : public ::testing::Test {
+protected:
+    camera_device_t *mDevice;
+
+    virtual void SetUp() {
+        sVendorParams = kParametersCorpus[0].params;
+        sVendorLastSet = "";
+        sVendorGetCalls = 0;
+        sVendorSetCalls = 0;
+
+        hw_device_t *device = NULL;
+        ASSERT_EQ(0, HAL_MODULE_INFO_SYM.common.methods->open(
+                &HAL_MODULE_INFO_SYM.common, "0", &device));
+        mDevice = (camera_device_t *)device;
+    }
+
+    virtual void TearDown() {
+        mDevice->common.close(&mDevice->common);
+    }
+
+    String8 getParameters() {
+        char *params = mDevice->ops->get_parameters(mDevice);
+        String8 ret(params);
+        mDevice->ops->put_parameters(mDevice, params);
+        return ret;
+    }
+
+    wrapper_camera_device_t *wrapper() {
+        return (wrapper_camera_device_t *)mDevice;
+    }
+};
+
+#ifdef QCOM_HARDWARE
+TEST(CameraWrapperFixupTest, GetParamsGolden) {
+    ASSERT_EQ(PARAMETERS_CORPUS_SIZE, sizeof(kGetParamsGolden) / sizeof(kGetParamsGolden[0]));
+    for (size_t i = 0; i < PARAMETERS_CORPUS_SIZE; i++) {
+        SCOPED_TRACE(kParametersCorpus[i].name);
+        ASSERT_STREQ(kParametersCorpus[i].name, kGetParamsGolden[i].name);
+        char *fixed = camera_fixup_getparams(0, kParametersCorpus[i].params);
+        EXPECT_STREQ(kGetParamsGolden[i].params, fixed);
+        free(fixed);
+    }
+}
+#endif
+
+TEST(CameraWrapperFixupTest, SetParamsGolden) {
+    // only an HDR scene drops hdr-need-1x, everything else passes through
+    for (size_t i = 0; i < PARAMETERS_CORPUS_SIZE; i++) {
+        SCOPED_TRACE(kParametersCorpus[i].name);
+        String8 expected(kParametersCorpus[i].params);
+        if (strstr(expected.string(), ";scene-mode=hdr;")) {
+            std::string s(expected.string());
+            s.erase(s.find("hdr-need-1x=true;"), strlen("hdr-need-1x=true;"));
+            expected = s.c_str();
+        }
+        char *fixed = camera_fixup_setparams(0, kParametersCorpus[i].params);
+        EXPECT_STREQ(expected.string(), fixed);
+        free(fixed);
+    }
+}
+
+TEST(CameraWrapperFixupTest, DiffParams) {
+    // b changed, c removed, d and f added
+    EXPECT_EQ(4, camera_diff_params("a=1;b=2;c=3;e=5", "a=1;b=9;d=4;e=5;f=6"));
+    EXPECT_EQ(0, camera_diff_params("a=1;bb=2", "a=1;bb=2"));
+    EXPECT_EQ(2, camera_diff_params("", "a=1;b=2"));
+    EXPECT_EQ(1, camera_diff_params("a=1;b=2", "a=1;b=3"));
+}
+
+TEST_F(CameraWrapperTest, GetParametersCache) {
+    String8 first = getParameters();
+    String8 second = getParameters();
+    EXPECT_STREQ(first.string(), second.string());
+    EXPECT_EQ(2, sVendorGetCalls);
+    EXPECT_EQ(1u, wrapper()->get_params_misses);
+    EXPECT_EQ(1u, wrapper()->get_params_hits);
+
+    // a new vendor string is parsed again
+    sVendorParams = kParametersCorpus[1].params;
+    String8 third = getParameters();
+    EXPECT_EQ(2u, wrapper()->get_params_misses);
+    EXPECT_TRUE(strstr(third.string(), "cur-focus-diopter=2.5") != NULL);
+
+    // and so is a string of the same length that differs
+    std::string s(kParametersCorpus[1].params);
+    s.replace(s.find("zoom=0"), 6, "zoom=7");
+    sVendorParams = s.c_str();
+    EXPECT_TRUE(strstr(getParameters().string(), ";zoom=7") != NULL);
+    EXPECT_EQ(3u, wrapper()->get_params_misses);
+}
+
+TEST_F(CameraWrapperTest, SetParametersForwarding) {
+    String8 params(kParametersCorpus[0].params);
+    EXPECT_EQ(0, mDevice->ops->set_parameters(mDevice, params.string()));
+    EXPECT_EQ(0, mDevice->ops->set_parameters(mDevice, params.string()));
+    EXPECT_EQ(1, sVendorSetCalls);
+    EXPECT_EQ(1u, wrapper()->set_params_skipped);
+
+    String8 hdr(kParametersCorpus[1].params);
+    mDevice->ops->set_parameters(mDevice, hdr.string());
+    EXPECT_EQ(2, sVendorSetCalls);
+    EXPECT_EQ(NULL, strstr(sVendorLastSet.string(), "hdr-need-1x"));
+
+    // the vendor may change its own state while previewing, so the same
+    // set has to reach it again afterwards
+    mDevice->ops->start_preview(mDevice);
+    mDevice->ops->set_parameters(mDevice, hdr.string());
+    EXPECT_EQ(3, sVendorSetCalls);
+    mDevice->ops->send_command(mDevice, 0, 0, 0);
+    mDevice->ops->set_parameters(mDevice, hdr.string());
+    EXPECT_EQ(4, sVendorSetCalls);
+    mDevice->ops->auto_focus(mDevice);
+    mDevice->ops->set_parameters(mDevice, hdr.string());
+    EXPECT_EQ(5, sVendorSetCalls);
+    EXPECT_EQ(5u, wrapper()->set_params_forwarded);
+    // only the switch to the hdr set changed anything
+    EXPECT_LT(0u, wrapper()->set_params_keys_changed);
+    uint32_t changed = wrapper()->set_params_keys_changed;
+    mDevice->ops->cancel_auto_focus(mDevice);
+    mDevice->ops->set_parameters(mDevice, hdr.string());
+    EXPECT_EQ(6, sVendorSetCalls);
+    EXPECT_EQ(changed, wrapper()->set_params_keys_changed);
+}
+
+TEST_F(CameraWrapperTest, Dump) {
+    getParameters();
+    getParameters();
+    mDevice->ops->set_parameters(mDevice, kParametersCorpus[0].params);
+
+    FILE *file = tmpfile();
+    ASSERT_TRUE(file != NULL);
+    EXPECT_EQ(0, mDevice->ops->dump(mDevice, fileno(file)));
+
+    char buf[4096];
+    rewind(file);
+    size_t length = fread(buf, 1, sizeof(buf) - 1, file);
+    buf[length] = '\0';
+    fclose(file);
+
+    EXPECT_TRUE(strstr(buf, "camera 0 get_parameters fixups cached 1, parsed 1") != NULL) << buf;
+    EXPECT_TRUE(strstr(buf, "camera 0 set_parameters forwarded 1, unchanged 0, "
+            "keys changed 0") != NULL) << buf;
+    EXPECT_TRUE(strstr(buf, "  get_parameters ") != NULL) << buf;
+    EXPECT_TRUE(strstr(buf, "  get_parameters fixup ") != NULL) << buf;
+    EXPECT_TRUE(strstr(buf, "  set_parameters fixup ") != NULL) << buf;
+    EXPECT_EQ(NULL, strstr(buf, "  take_picture ")) << buf;
+}
+
+/*
+ * Cost of get_parameters and set_parameters on the stock rear set, with
+ * and without the wrapper's caches. Printed only, and like the codec
+ * benchmarks only run with --gtest_also_run_disabled_tests.
+ */
+
+static void report(const char *what, nsecs_t start, int iterations)
+{
+    printf("%-44s %8.3f us\n", what,
+            (systemTime(SYSTEM_TIME_MONOTONIC) - start) / 1000.0 / iterations);
+}
+
+TEST_F(CameraWrapperTest, DISABLED_Benchmark) {
+    const int iterations = 2000;
+    String8 params(kParametersCorpus[0].params);
+    String8 hdr(kParametersCorpus[1].params);
+    nsecs_t start;
+
+    start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int i = 0; i < iterations; i++) {
+        free(camera_fixup_getparams(0, params.string()));
+    }
+    report("get_parameters fixup", start, iterations);
+
+    start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int i = 0; i < iterations; i++) {
+        getParameters();
+    }
+    report("get_parameters, vendor string unchanged", start, iterations);
+
+    start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int i = 0; i < iterations; i++) {
+        mDevice->ops->set_parameters(mDevice, params.string());
+    }
+    report("set_parameters, unchanged", start, iterations);
+
+    start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int i = 0; i < iterations; i++) {
+        mDevice->ops->set_parameters(mDevice, (i & 1) ? params.string() : hdr.string());
+    }
+    report("set_parameters, alternating", start, iterations);
+}
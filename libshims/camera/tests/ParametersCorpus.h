@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAMERA_TESTS_PARAMETERS_CORPUS_H
+#define CAMERA_TESTS_PARAMETERS_CORPUS_H
+
+/*
+ * Synthetic parameter strings shaped like what the msm8916 QCamera2 HAL
+ * hands out from get_parameters. The rear set is the stock one of the
+ * 13MP sensor, the others are variations of it covering the cases the
+ * wrapper fixups and CameraParameters treat specially. Like the vendor's
+ * own, every string is flattened in key order.
+ *
+ * None of them is a capture from a Z00L, Z00T or Z00M; replace them with
+ * real get_parameters dumps of each device once those are at hand.
+ */
+
+#define CORPUS_REAR_COMMON \
+    "antibanding=auto;antibanding-values=off,60hz,50hz,auto;" \
+    "auto-exposure-lock=false;auto-exposure-lock-supported=true;" \
+    "auto-whitebalance-lock=false;auto-whitebalance-lock-supported=true;" \
+    "effect=none;effect-values=none,mono,negative,solarize,sepia,posterize," \
+        "whiteboard,blackboard,aqua,emboss,sketch,neon;" \
+    "exposure-compensation=0;exposure-compensation-step=0.166667;" \
+    "flash-mode=off;flash-mode-values=off,auto,on,torch;" \
+    "focus-mode=continuous-picture;" \
+    "focus-mode-values=auto,infinity,macro,continuous-video,continuous-picture,manual;" \
+    "hdr-need-1x=true;jpeg-quality=85;longshot-supported=true;"
+
+#define CORPUS_REAR_SIZES \
+    "max-exposure-compensation=12;max-zoom=79;min-exposure-compensation=-12;" \
+    "picture-format=jpeg;picture-size=4160x3120;" \
+    "picture-size-values=4160x3120,4000x3000,4160x2340,4000x2250,3264x2448," \
+        "3200x2400,2976x2976,2592x1944,2048x1536,1920x1080,1600x1200,1280x768," \
+        "1280x720,1024x768,800x600,800x480,720x480,640x480,352x288,320x240,176x144;" \
+    "preview-format=yuv420sp;" \
+    "preview-format-values=yuv420sp,yuv420sp-adreno,yuv420p,yuv420p,nv12,yv12;" \
+    "preview-fps-range=7500,30000;" \
+    "preview-fps-range-values=(7500,30000),(8000,30000),(30000,30000);" \
+    "preview-frame-rate=30;preview-size=1920x1080;" \
+    "preview-size-values=1920x1080,1440x1080,1280x960,1280x720,1024x768,864x480," \
+        "800x480,768x432,720x480,640x480,576x432,480x320,384x288,352x288,320x240," \
+        "240x160,176x144;"
+
+#define CORPUS_SCENES_AND_VIDEO \
+    "scene-mode-values=auto,asd,landscape,snow,beach,sunset,night,portrait," \
+        "backlight,sports,steadyphoto,flowers,candlelight,fireworks,party," \
+        "night-portrait,theatre,action,AR,hdr;" \
+    "video-size=1920x1080;" \
+    "video-size-values=1920x1080,1280x720,864x480,800x480,720x480,640x480," \
+        "480x320,352x288,320x240,176x144;" \
+    "whitebalance=auto;" \
+    "whitebalance-values=auto,incandescent,fluorescent,warm-fluorescent," \
+        "daylight,cloudy-daylight,twilight,shade,manual-cct;" \
+    "zoom=0"
+
+static const struct {
+    const char *name;
+    const char *params;
+} kParametersCorpus[] = {
+    // stock rear camera, manual focus reported as a scale position
+    { "rear",
+      CORPUS_REAR_COMMON
+      "manual-focus-pos-type=2;manual-focus-position=40;"
+      CORPUS_REAR_SIZES
+      "scene-mode=auto;"
+      CORPUS_SCENES_AND_VIDEO },
+    // rear camera with manual focus reported in diopters, in HDR
+    { "rear-diopter-hdr",
+      CORPUS_REAR_COMMON
+      "manual-focus-pos-type=3;manual-focus-position=2.5;"
+      CORPUS_REAR_SIZES
+      "scene-mode=hdr;"
+      CORPUS_SCENES_AND_VIDEO },
+    // 5MP fixed focus front camera, no flash and no hdr-need-1x
+    { "front",
+      "antibanding=auto;antibanding-values=off,60hz,50hz,auto;"
+      "auto-exposure-lock=false;auto-exposure-lock-supported=true;"
+      "effect=none;effect-values=none,mono,negative,solarize,sepia;"
+      "exposure-compensation=0;exposure-compensation-step=0.166667;"
+      "focus-mode=fixed;focus-mode-values=fixed;jpeg-quality=85;"
+      "max-exposure-compensation=12;max-zoom=79;min-exposure-compensation=-12;"
+      "picture-format=jpeg;picture-size=2560x1920;"
+      "picture-size-values=2560x1920,2592x1458,2048x1536,1920x1080,1600x1200,"
+          "1280x720,1024x768,800x600,640x480,320x240;"
+      "preview-format=yuv420sp;preview-format-values=yuv420sp,yuv420p,nv12,yv12;"
+      "preview-fps-range=7500,30000;preview-fps-range-values=(7500,30000),(30000,30000);"
+      "preview-frame-rate=30;preview-size=1280x720;"
+      "preview-size-values=1280x720,1024x768,864x480,800x480,720x480,640x480,"
+          "352x288,320x240,176x144;"
+      "scene-mode=auto;scene-mode-values=auto,night,portrait,hdr;"
+      "video-size=1280x720;video-size-values=1280x720,720x480,640x480,352x288,320x240;"
+      "whitebalance=auto;whitebalance-values=auto,incandescent,fluorescent,daylight,"
+          "cloudy-daylight;"
+      "zoom=0" },
+    // keys the HAL reports without a value, which get() treats as unset
+    { "empty-values",
+      "antibanding=;effect=none;flash-mode=;focus-mode=auto;"
+      "manual-focus-pos-type=2;manual-focus-position=;"
+      "picture-size=4160x3120;preview-size=1920x1080;"
+      "preview-size-values=;scene-mode=;zoom=0" },
+};
+
+#define PARAMETERS_CORPUS_SIZE (sizeof(kParametersCorpus) / sizeof(kParametersCorpus[0]))
+
+#endif /* CAMERA_TESTS_PARAMETERS_CORPUS_H */
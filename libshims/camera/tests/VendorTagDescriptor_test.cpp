@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "VendorTagDescriptor_test"
+
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+#include <camera/VendorTagDescriptor.h>
+#include <system/camera_metadata.h>
+#include <system/camera_vendor_tags.h>
+
+using namespace android;
+
+/* fake vendor tag ops, serving whatever sTags holds */
+
+static const struct FakeTag {
+    uint32_t tag;
+    const char *section;
+    const char *name;
+    int type;
+} *sTags;
+static size_t sTagCount;
+
+static const FakeTag *findFakeTag(uint32_t tag)
+{
+    // the last definition of a tag wins, as with the vendor's own tables
+    const FakeTag *found = NULL;
+    for (size_t i = 0; i < sTagCount; i++) {
+        if (sTags[i].tag == tag)
+            found = &sTags[i];
+    }
+    return found;
+}
+
+static int fake_get_tag_count(const vendor_tag_ops_t *)
+{
+    return sTagCount;
+}
+
+static void fake_get_all_tags(const vendor_tag_ops_t *, uint32_t *tags)
+{
+    for (size_t i = 0; i < sTagCount; i++) {
+        tags[i] = sTags[i].tag;
+    }
+}
+
+static const char *fake_get_section_name(const vendor_tag_ops_t *, uint32_t tag)
+{
+    return findFakeTag(tag)->section;
+}
+
+static const char *fake_get_tag_name(const vendor_tag_ops_t *, uint32_t tag)
+{
+    return findFakeTag(tag)->name;
+}
+
+static int fake_get_tag_type(const vendor_tag_ops_t *, uint32_t tag)
+{
+    return findFakeTag(tag)->type;
+}
+
+template <size_t N>
+static sp<VendorTagDescriptor> createDescriptor(const FakeTag (&tags)[N])
+{
+    vendor_tag_ops_t ops;
+    memset(&ops, 0, sizeof(ops));
+    ops.get_tag_count = fake_get_tag_count;
+    ops.get_all_tags = fake_get_all_tags;
+    ops.get_section_name = fake_get_section_name;
+    ops.get_tag_name = fake_get_tag_name;
+    ops.get_tag_type = fake_get_tag_type;
+
+    sTags = tags;
+    sTagCount = N;
+    sp<VendorTagDescriptor> desc;
+    EXPECT_EQ(OK, VendorTagDescriptor::createDescriptorFromOps(&ops, desc));
+    return desc;
+}
+
+static uint32_t lookup(const sp<VendorTagDescriptor> &desc, const char *section,
+        const char *name)
+{
+    uint32_t tag = 0;
+    if (desc->lookupTag(String8(name), String8(section), &tag) != OK)
+        return 0;
+    return tag;
+}
+
+TEST(VendorTagDescriptorTest, Lookup) {
+    static const FakeTag tags[] = {
+        { 0x80000000, "org.codeaurora.qcamera3.exposure_metering", "exposure_metering_mode", TYPE_INT32 },
+        { 0x80010000, "org.codeaurora.qcamera3.av_timer", "use_av_timer", TYPE_BYTE },
+        { 0x80020000, "org.codeaurora.qcamera3.sensor_meta_data", "dynamic_black_level_pattern", TYPE_FLOAT },
+        { 0x80020001, "org.codeaurora.qcamera3.sensor_meta_data", "is_mono_only", TYPE_BYTE },
+        // redefined later on under another name
+        { 0x80030000, "org.codeaurora.qcamera3.temporal_denoise", "enable", TYPE_BYTE },
+        { 0x80030001, "org.codeaurora.qcamera3.temporal_denoise", "process_type", TYPE_INT32 },
+        { 0x80030000, "org.codeaurora.qcamera3.temporal_denoise", "enabled", TYPE_BYTE },
+    };
+    sp<VendorTagDescriptor> desc = createDescriptor(tags);
+
+    EXPECT_EQ(6, desc->getTagCount());
+    EXPECT_EQ(0x80000000u, lookup(desc, "org.codeaurora.qcamera3.exposure_metering",
+            "exposure_metering_mode"));
+    EXPECT_EQ(0x80020001u, lookup(desc, "org.codeaurora.qcamera3.sensor_meta_data",
+            "is_mono_only"));
+    EXPECT_EQ(0x80030000u, lookup(desc, "org.codeaurora.qcamera3.temporal_denoise", "enabled"));
+    EXPECT_EQ(0u, lookup(desc, "org.codeaurora.qcamera3.temporal_denoise", "enable"));
+    EXPECT_EQ(0u, lookup(desc, "org.codeaurora.qcamera3.av_timer", "is_mono_only"));
+    EXPECT_EQ(0u, lookup(desc, "org.codeaurora.qcamera3.no_such_section", "enabled"));
+
+    EXPECT_STREQ("use_av_timer", desc->getTagName(0x80010000));
+    EXPECT_STREQ("org.codeaurora.qcamera3.temporal_denoise", desc->getSectionName(0x80030001));
+    EXPECT_EQ(TYPE_FLOAT, desc->getTagType(0x80020000));
+    EXPECT_EQ(NULL, desc->getTagName(0x80020002));
+}
+
+TEST(VendorTagDescriptorTest, HashCollision) {
+    // Two names of the same section with the same FNV-1a hash, which the
+    // name table has to tell apart rather than loop on
+    static const FakeTag tags[] = {
+        { 0x80000000, "org.codeaurora.qcamera3.collision", "tag73809", TYPE_INT32 },
+        { 0x80000001, "org.codeaurora.qcamera3.collision", "tag1120216", TYPE_BYTE },
+        { 0x80000002, "org.codeaurora.qcamera3.collision", "tag73810", TYPE_BYTE },
+    };
+    sp<VendorTagDescriptor> desc = createDescriptor(tags);
+
+    EXPECT_EQ(0x80000000u, lookup(desc, "org.codeaurora.qcamera3.collision", "tag73809"));
+    EXPECT_EQ(0x80000001u, lookup(desc, "org.codeaurora.qcamera3.collision", "tag1120216"));
+    EXPECT_EQ(0x80000002u, lookup(desc, "org.codeaurora.qcamera3.collision", "tag73810"));
+    EXPECT_EQ(0u, lookup(desc, "org.codeaurora.qcamera3.collision", "tag1120217"));
+}
+
+TEST(VendorTagDescriptorTest, ReuseGlobal) {
+    static const FakeTag tags[] = {
+        { 0x80000000, "org.codeaurora.qcamera3.exposure_metering", "exposure_metering_mode", TYPE_INT32 },
+        { 0x80010000, "org.codeaurora.qcamera3.av_timer", "use_av_timer", TYPE_BYTE },
+        { 0x80010000, "org.codeaurora.qcamera3.av_timer", "use_av_timer", TYPE_INT32 },
+    };
+    // the same definitions, in another order
+    static const FakeTag reordered[] = {
+        { 0x80010000, "org.codeaurora.qcamera3.av_timer", "use_av_timer", TYPE_BYTE },
+        { 0x80010000, "org.codeaurora.qcamera3.av_timer", "use_av_timer", TYPE_INT32 },
+        { 0x80000000, "org.codeaurora.qcamera3.exposure_metering", "exposure_metering_mode", TYPE_INT32 },
+    };
+    // the first definition of use_av_timer winning instead of the last
+    static const FakeTag overridden[] = {
+        { 0x80000000, "org.codeaurora.qcamera3.exposure_metering", "exposure_metering_mode", TYPE_INT32 },
+        { 0x80010000, "org.codeaurora.qcamera3.av_timer", "use_av_timer", TYPE_INT32 },
+        { 0x80010000, "org.codeaurora.qcamera3.av_timer", "use_av_timer", TYPE_BYTE },
+    };
+    sp<VendorTagDescriptor> global = createDescriptor(tags);
+    ASSERT_EQ(OK, VendorTagDescriptor::setAsGlobalVendorTagDescriptor(global));
+
+    EXPECT_EQ(global, createDescriptor(tags));
+    EXPECT_EQ(global, createDescriptor(reordered));
+    sp<VendorTagDescriptor> desc = createDescriptor(overridden);
+    EXPECT_NE(global, desc);
+    EXPECT_EQ(TYPE_BYTE, desc->getTagType(0x80010000));
+
+    VendorTagDescriptor::clearGlobalVendorTagDescriptor();
+}